@@ -0,0 +1,44 @@
+#ifndef __BENCH_H
+#define __BENCH_H
+
+#include <stdio.h>
+
+#include "common.h"
+
+/* Small helpers shared by the benchmarks in this directory, they time with monotonic_now */
+
+/* Tiny xorshift so generated inputs are the same on every run */
+static inline u64 bench_rand(u64* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/* Roughly what our generated data files look like */
+static inline struct slice(char) bench_generate_records(usize megabytes) {
+    usize capacity = MEGABYTES(megabytes) + KILOBYTES(1);
+    char* buffer = malloc(capacity);
+    usize length = 0;
+    u64 seed = 0x9e3779b97f4a7c15ull;
+    u64 n;
+
+    assert(buffer);
+
+    while (length + 512 < capacity - KILOBYTES(1)) {
+        n = bench_rand(&seed);
+
+        if (n % 7 == 0) {
+            length += sprintf(buffer + length, ";; record %lu of the generated data set\n", (unsigned long)(n % 100000));
+        }
+
+        length += sprintf(buffer + length,
+                          "(defvar record-%lu\n    (cons %lu\n          (cons %lu (cons sensor-reading-%lu nil))))\n\n",
+                          (unsigned long)(n % 1000000), (unsigned long)(n >> 40),
+                          (unsigned long)(n % 65536), (unsigned long)(n % 97));
+    }
+
+    return (struct slice(char)){buffer, length};
+}
+
+#endif  /*__BENCH_H*/
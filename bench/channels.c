@@ -0,0 +1,107 @@
+/*
+ * Messages per second through one channel from a growing number of producer
+ * threads to a single consumer, each thread with a heap of its own, once for
+ * integers and once for small lists that have to be copied between heaps.
+ *
+ * Usage: bin/bench/channels [messages]
+ * */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "channel.h"
+#include "isolate.h"
+
+#define CAPACITY 1024
+
+struct producer {
+    pthread_t thread;
+    struct channel* channel;
+    usize messages;
+    bool lists;
+};
+
+static void* produce(void* arg) {
+    struct producer* producer = arg;
+    struct isolate isolate = {0};
+    struct expr value;
+    usize i;
+    u32 list;
+
+    isolate_enter(&isolate);
+
+    list = expr_new_cons(expr_new_integer(1), expr_new_cons(expr_new_integer(2), expr_new_cons(expr_new_integer(3), 0)));
+
+    for (i = 0; i < producer->messages; ++i) {
+        value = producer->lists ? EXPR(list) : expr_create_integer(i);
+        channel_send(producer->channel, value);
+    }
+
+    isolate_leave(&isolate);
+    isolate_destroy(&isolate);
+
+    return NULL;
+}
+
+static f64 run(usize producers, usize messages, bool lists) {
+    struct producer* threads = calloc(producers, sizeof(struct producer));
+    struct channel* channel = channel_create(CAPACITY);
+    struct isolate isolate = {0};
+    struct expr value;
+    f64 start, elapsed;
+    usize i;
+
+    assert(threads);
+
+    isolate_enter(&isolate);
+
+    start = monotonic_now();
+
+    for (i = 0; i < producers; ++i) {
+        threads[i] = (struct producer){ .channel = channel, .messages = messages / producers, .lists = lists };
+        assert(pthread_create(&threads[i].thread, NULL, produce, &threads[i]) == 0);
+    }
+
+    for (i = 0; i < messages / producers * producers; ++i) {
+        value = channel_recv(channel);
+        assert(lists ? consp(value) : integerp(value));
+
+        /* received lists are garbage right away */
+        exprs.length = 1;
+    }
+
+    elapsed = monotonic_now() - start;
+
+    for (i = 0; i < producers; ++i) {
+        pthread_join(threads[i].thread, NULL);
+    }
+
+    isolate_leave(&isolate);
+    isolate_destroy(&isolate);
+    free(threads);
+
+    return elapsed;
+}
+
+i32 main(i32 argc, char** argv) {
+    static const usize producer_counts[] = {1, 2, 4, 8};
+    usize messages = 1000000;
+    usize i;
+
+    if (argc > 1) messages = atoi(argv[1]);
+
+    printf("%lu messages through a channel of %d to one consumer (%ld cpus online)\n",
+           (unsigned long)messages, CAPACITY, sysconf(_SC_NPROCESSORS_ONLN));
+
+    for (i = 0; i < sizeof(producer_counts) / sizeof(producer_counts[0]); ++i) {
+        printf("  %lu producers %12.0f integers/s %12.0f lists/s\n", (unsigned long)producer_counts[i],
+               messages / run(producer_counts[i], messages, false),
+               messages / run(producer_counts[i], messages, true));
+    }
+
+    return 0;
+}
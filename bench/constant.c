@@ -0,0 +1,87 @@
+/*
+ * What inlining globals that are never reassigned saves on calls through them,
+ * the way app.hoax calls #+ through add: compiled with the vm's constant
+ * registry, the call turns into the instruction #+ stands for, and without it
+ * every call looks add up by name.
+ *
+ * Usage: bin/bench/constant [calls]
+ * */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "compiler.h"
+#include "reader.h"
+#include "vm.h"
+
+#define CALLS_PER_MODULE 50
+
+static void run(struct vm* vm, const char* src) {
+    struct compiler compiler = {0};
+    struct module module = {0};
+
+    compiler_init(&compiler, reader_create_borrowed(STRING((char*)src)), &module);
+    compiler.constants = &vm->constants;
+    assert(compile(&compiler) == COMPILE_OK);
+    vm_run(vm, &module);
+
+    module_destroy(&module);
+    compiler_destroy(&compiler);
+}
+
+/* Modules top out at 256 constants, so a short one gets run over and over */
+static f64 time_calls(struct vm* vm, const char* form, usize calls, bool inline_globals) {
+    char src[KILOBYTES(2)];
+    struct compiler compiler = {0};
+    struct module module = {0};
+    usize length = strlen(form);
+    usize i;
+    f64 start, elapsed;
+
+    assert(length * CALLS_PER_MODULE <= sizeof(src));
+
+    for (i = 0; i < CALLS_PER_MODULE; ++i) memcpy(src + i * length, form, length);
+
+    compiler_init(&compiler, reader_create_borrowed((struct slice(char)){src, length * CALLS_PER_MODULE}), &module);
+    if (inline_globals) compiler.constants = &vm->constants;
+    assert(compile(&compiler) == COMPILE_OK);
+
+    start = monotonic_now();
+    for (i = 0; i < calls / CALLS_PER_MODULE; ++i) vm_run(vm, &module);
+    elapsed = monotonic_now() - start;
+
+    module_destroy(&module);
+    compiler_destroy(&compiler);
+
+    return elapsed / (calls - calls % CALLS_PER_MODULE);
+}
+
+i32 main(i32 argc, char** argv) {
+    struct vm vm = {0};
+    usize calls = 1000000;
+
+    if (argc > 1) calls = atoi(argv[1]);
+
+    vm_init(&vm);
+    isolate_enter(&vm.isolate);
+
+    run(&vm, "(defvar add #+)\n(defvar ten 10)\n");
+
+    /* the first run pays for growing the heap */
+    time_calls(&vm, "(add 3 4)\n", calls, false);
+
+    printf("%lu calls, in ns per call\n", (unsigned long)calls);
+    printf("  (add 3 4)    looked up   %8.1f\n", time_calls(&vm, "(add 3 4)\n", calls, false) * 1e9);
+    printf("  (add 3 4)    inlined     %8.1f\n", time_calls(&vm, "(add 3 4)\n", calls, true) * 1e9);
+    printf("  (+ ten 1)    looked up   %8.1f\n", time_calls(&vm, "(+ ten 1)\n", calls, false) * 1e9);
+    printf("  (+ ten 1)    inlined     %8.1f\n", time_calls(&vm, "(+ ten 1)\n", calls, true) * 1e9);
+    printf("  (#+ ten 1)   looked up   %8.1f\n", time_calls(&vm, "(#+ ten 1)\n", calls, false) * 1e9);
+    printf("  (#+ ten 1)   inlined     %8.1f\n", time_calls(&vm, "(#+ ten 1)\n", calls, true) * 1e9);
+
+    isolate_leave(&vm.isolate);
+    vm_destroy(&vm);
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ * What calling C through defextern costs next to calling the same function
+ * directly from C, with a builtin native as the baseline for any call out of
+ * the vm.
+ *
+ * Usage: bin/bench/extern [calls]
+ * */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "compiler.h"
+#include "reader.h"
+#include "vm.h"
+
+#define CALLS_PER_MODULE 50
+
+static const char* externs =
+    "(defextern strlen (ptr) long)\n"
+    "(defextern getpid () int)\n";
+
+static void define_externs(struct vm* vm) {
+    struct compiler compiler = {0};
+    struct module module = {0};
+
+    compiler_init(&compiler, reader_create_borrowed(STRING((char*)externs)), &module);
+    assert(compile(&compiler) == COMPILE_OK);
+    vm_run(vm, &module);
+
+    module_destroy(&module);
+    compiler_destroy(&compiler);
+}
+
+/* Modules top out at 256 constants, so a short one gets run over and over */
+static f64 time_calls(struct vm* vm, const char* form, usize calls) {
+    char src[KILOBYTES(2)];
+    struct compiler compiler = {0};
+    struct module module = {0};
+    usize length = strlen(form);
+    usize i;
+    f64 start, elapsed;
+
+    assert(length * CALLS_PER_MODULE <= sizeof(src));
+
+    for (i = 0; i < CALLS_PER_MODULE; ++i) memcpy(src + i * length, form, length);
+
+    compiler_init(&compiler, reader_create_borrowed((struct slice(char)){src, length * CALLS_PER_MODULE}), &module);
+    assert(compile(&compiler) == COMPILE_OK);
+
+    start = monotonic_now();
+    for (i = 0; i < calls / CALLS_PER_MODULE; ++i) vm_run(vm, &module);
+    elapsed = monotonic_now() - start;
+
+    module_destroy(&module);
+    compiler_destroy(&compiler);
+
+    return elapsed / (calls - calls % CALLS_PER_MODULE);
+}
+
+/* Through a volatile pointer so the compiler can't fold or hoist the calls away */
+static f64 time_direct_strlen(usize calls) {
+    size_t (*volatile fn)(const char*) = strlen;
+    volatile size_t sink = 0;
+    f64 start;
+    usize i;
+
+    start = monotonic_now();
+    for (i = 0; i < calls; ++i) sink += fn("hello");
+
+    return (monotonic_now() - start) / calls;
+}
+
+static f64 time_direct_getpid(usize calls) {
+    pid_t (*volatile fn)(void) = getpid;
+    volatile pid_t sink = 0;
+    f64 start;
+    usize i;
+
+    start = monotonic_now();
+    for (i = 0; i < calls; ++i) sink += fn();
+
+    return (monotonic_now() - start) / calls;
+}
+
+i32 main(i32 argc, char** argv) {
+    struct vm vm = {0};
+    usize calls = 1000000;
+    f64 builtin, direct, hoax;
+
+    if (argc > 1) calls = atoi(argv[1]);
+
+    vm_init(&vm);
+    isolate_enter(&vm.isolate);
+
+    define_externs(&vm);
+
+    /* the first run pays for growing the heap */
+    time_calls(&vm, "(#+ 7 1)\n", calls);
+    builtin = time_calls(&vm, "(#+ 7 1)\n", calls);
+
+    printf("%lu calls, in ns per call\n", (unsigned long)calls);
+    printf("  builtin #+            %8.1f\n", builtin * 1e9);
+
+    direct = time_direct_strlen(calls);
+    hoax = time_calls(&vm, "(strlen (quote hello))\n", calls);
+    printf("  strlen  direct        %8.1f\n", direct * 1e9);
+    printf("  strlen  defextern     %8.1f  (+%.1f)\n", hoax * 1e9, (hoax - direct) * 1e9);
+
+    direct = time_direct_getpid(calls);
+    hoax = time_calls(&vm, "(getpid)\n", calls);
+    printf("  getpid  direct        %8.1f\n", direct * 1e9);
+    printf("  getpid  defextern     %8.1f  (+%.1f)\n", hoax * 1e9, (hoax - direct) * 1e9);
+
+    isolate_leave(&vm.isolate);
+    vm_destroy(&vm);
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * Throughput of independent interpreters, one per thread, each compiling a
+ * small program once and running it over and over through the embedding API.
+ * With nothing shared between isolates the runs per second should grow with
+ * the thread count, up to the number of cores.
+ *
+ * Usage: bin/bench/isolates [runs per thread]
+ * */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "hoax.h"
+
+static const char program_src[] =
+    "(defvar base (* 3 14))\n"
+    "(defvar offset (- base 2))\n"
+    "(if (#scale offset) (#+ base offset) 0)\n";
+
+struct worker {
+    pthread_t thread;
+    usize runs;
+    i64 result;
+};
+
+/* A native registered through the API, so calls cross back into C */
+static struct expr native_scale(struct expr args) {
+    return expr_create_integer(CAR(args).integer * 2);
+}
+
+static void* worker_run(void* arg) {
+    struct worker* worker = arg;
+    struct hoax* hoax = hoax_create();
+    struct hoax_program* program;
+    struct expr result = {0};
+    usize i;
+
+    hoax_register_native(hoax, "#scale", native_scale, 1);
+
+    program = hoax_compile(hoax, program_src, sizeof(program_src) - 1);
+    assert(program);
+
+    for (i = 0; i < worker->runs; ++i) {
+        result = hoax_run(hoax, program);
+    }
+
+    worker->result = result.integer;
+
+    hoax_program_destroy(program);
+    hoax_destroy(hoax);
+
+    return NULL;
+}
+
+static f64 run(usize threads, usize runs) {
+    struct worker* workers = calloc(threads, sizeof(struct worker));
+    f64 start, elapsed;
+    usize i;
+
+    assert(workers);
+
+    start = monotonic_now();
+
+    for (i = 0; i < threads; ++i) {
+        workers[i].runs = runs;
+        assert(pthread_create(&workers[i].thread, NULL, worker_run, &workers[i]) == 0);
+    }
+
+    for (i = 0; i < threads; ++i) {
+        pthread_join(workers[i].thread, NULL);
+        assert(workers[i].result == 82);
+    }
+
+    elapsed = monotonic_now() - start;
+
+    free(workers);
+
+    return elapsed;
+}
+
+i32 main(i32 argc, char** argv) {
+    static const usize thread_counts[] = {1, 2, 4, 8};
+    usize runs = 200000;
+    f64 elapsed, single = 0;
+    usize i;
+
+    if (argc > 1) runs = atoi(argv[1]);
+
+    printf("isolates running %lu programs each (%ld cpus online)\n",
+           (unsigned long)runs, sysconf(_SC_NPROCESSORS_ONLN));
+
+    for (i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); ++i) {
+        elapsed = run(thread_counts[i], runs);
+        if (i == 0) single = thread_counts[0] * runs / elapsed;
+
+        printf("  %lu threads %12.0f runs/s %6.2fx\n", (unsigned long)thread_counts[i],
+               thread_counts[i] * runs / elapsed, thread_counts[i] * runs / elapsed / single);
+    }
+
+    return 0;
+}
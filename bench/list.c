@@ -0,0 +1,102 @@
+/*
+ * The list natives from 10^3 to 10^7 elements, in nanoseconds per element so
+ * the linear ones show up as flat columns. Sorting is timed on random 64 bit
+ * integers, which take the radix sort with all eight passes, on integers
+ * below 1000, which only need two, and on floats, which take the merge sort.
+ *
+ * Usage: bin/bench/list [max elements]
+ * */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "list.h"
+
+static struct expr odd(struct expr args) {
+    return expr_create_boolean(CAR(args).integer & 1);
+}
+
+/* Built back to front like the reader would have, one box and one cell each */
+static u32 build_list(usize length, u64 modulo, bool reals) {
+    u64 state = 0x9e3779b97f4a7c15ull;
+    u32 list = 0;
+    u32 element;
+    u64 n;
+    usize i;
+
+    for (i = 0; i < length; ++i) {
+        n = bench_rand(&state);
+        if (modulo) n %= modulo;
+
+        element = reals ? expr_new_float((f64)(n >> 11) / (f64)(1ull << 53)) : expr_new_integer((i64)n);
+        list = expr_new_cons(element, list);
+    }
+
+    return list;
+}
+
+/* ns per element, the heap gets rolled back after so runs don't pile up */
+#define TIME(name, length, expression) do {                         \
+    u32 mark_ = exprs.length;                                       \
+    f64 start_ = monotonic_now();                                       \
+    sink += (u64)(expression);                                      \
+    times[name] = (monotonic_now() - start_) / (length) * 1e9;          \
+    exprs.length = mark_;                                           \
+} while (0)
+
+enum {
+    LENGTH, REVERSE, APPEND, NTH, FILTER, TO_VECTOR, SORT_I64, SORT_SMALL, SORT_F64, COLUMNS
+};
+
+i32 main(i32 argc, char** argv) {
+    const char* names[COLUMNS] = {
+        "length", "reverse", "append", "nth", "filter", "->vector", "sort i64", "sort <1000", "sort f64"
+    };
+    struct expr pred = expr_create_native(odd, 1);
+    volatile u64 sink = 0;
+    f64 times[COLUMNS];
+    usize max_length = 10000000;
+    usize length, base;
+    u32 list, column;
+
+    if (argc > 1) max_length = atoi(argv[1]);
+
+    expr_new_nil();
+
+    printf("%10s", "elements");
+    for (column = 0; column < COLUMNS; ++column) printf(" %10s", names[column]);
+    printf("\n");
+
+    for (length = 1000; length <= max_length; length *= 10) {
+        base = exprs.length;
+        list = build_list(length, 0, false);
+
+        TIME(LENGTH,    length, list_length(list));
+        TIME(REVERSE,   length, list_reverse(list));
+        TIME(APPEND,    length, list_append(list, list));
+        TIME(NTH,       length, list_nth(list, length - 1).integer);
+        TIME(FILTER,    length, list_filter(list, pred));
+        TIME(TO_VECTOR, length, list_to_vector(list)->length);
+        TIME(SORT_I64,  length, list_sort(list));
+
+        exprs.length = base;
+        list = build_list(length, 1000, false);
+        TIME(SORT_SMALL, length, list_sort(list));
+
+        exprs.length = base;
+        list = build_list(length, 0, true);
+        TIME(SORT_F64, length, list_sort(list));
+
+        exprs.length = base;
+
+        printf("%10lu", (unsigned long)length);
+        for (column = 0; column < COLUMNS; ++column) printf(" %10.1f", times[column]);
+        printf("\n");
+    }
+
+    DYNARRAY_FREE(&exprs);
+
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * What #load-native costs: loading and binding an extension the first time,
+ * loading it again once it is already mapped, and calling one of its natives
+ * next to calling a native compiled into the interpreter.
+ *
+ * Usage: bin/bench/load_native [calls] [path/to/libfib.so]
+ * */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "extension.h"
+#include "compiler.h"
+#include "reader.h"
+#include "vm.h"
+
+#define EXTENSION_PATH "bin/ext/libfib.so"
+#define RELOADS 1000
+#define CALLS_PER_MODULE 50
+
+/*
+ * Modules top out at 256 constants, so a short one gets run over and over.
+ * Every call conses its arguments onto the heap, which is why the first run
+ * pays for growing it and gets thrown away.
+ * */
+static f64 time_calls(struct vm* vm, const char* form, usize calls) {
+    char src[KILOBYTES(1)];
+    struct compiler compiler = {0};
+    struct module module = {0};
+    usize length = strlen(form);
+    usize i;
+    f64 start, elapsed;
+
+    for (i = 0; i < CALLS_PER_MODULE; ++i) memcpy(src + i * length, form, length);
+
+    compiler_init(&compiler, reader_create_borrowed((struct slice(char)){src, length * CALLS_PER_MODULE}), &module);
+    assert(compile(&compiler) == COMPILE_OK);
+
+    start = monotonic_now();
+    for (i = 0; i < calls / CALLS_PER_MODULE; ++i) vm_run(vm, &module);
+    elapsed = monotonic_now() - start;
+
+    module_destroy(&module);
+    compiler_destroy(&compiler);
+
+    return elapsed;
+}
+
+i32 main(i32 argc, char** argv) {
+    struct slice(char) path = STRING(EXTENSION_PATH);
+    struct vm vm = {0};
+    struct expr bound;
+    usize calls = 200000;
+    f64 start, first, again, builtin, extension;
+    usize i;
+
+    if (argc > 1) calls = atoi(argv[1]);
+    if (argc > 2) path = STRING(argv[2]);
+
+    vm_init(&vm);
+    isolate_enter(&vm.isolate);
+
+    start = monotonic_now();
+    bound = extension_load(&vm, path);
+    first = monotonic_now() - start;
+
+    if (!integerp(bound)) {
+        fprintf(stderr, "build the extensions with 'make ext' first\n");
+        return 1;
+    }
+
+    start = monotonic_now();
+    for (i = 0; i < RELOADS; ++i) extension_load(&vm, path);
+    again = (monotonic_now() - start) / RELOADS;
+
+    printf("%.*s, %ld natives\n", STRINGF(path), (long)bound.integer);
+    printf("  first load       %9.3f us\n", first * 1e6);
+    printf("  loading again    %9.3f us\n", again * 1e6);
+
+    /* both run the same bytecode, so the difference is in the call itself */
+    time_calls(&vm, "(#+ 7 1)\n", calls);
+    builtin = time_calls(&vm, "(#+ 7 1)\n", calls);
+    extension = time_calls(&vm, "(#times 7 1)\n", calls);
+
+    printf("%lu calls\n", (unsigned long)calls);
+    calls -= calls % CALLS_PER_MODULE;
+    printf("  builtin #+       %9.3f ns per call\n", builtin / calls * 1e9);
+    printf("  extension #times %9.3f ns per call\n", extension / calls * 1e9);
+
+    isolate_leave(&vm.isolate);
+    vm_destroy(&vm);
+
+    return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Ten thousand fibers each reading a small file of their own on one vm, with
+ * every read batched through io_uring and with the epoll backend reading each
+ * file on the spot, next to running the same scripts one after another. The
+ * system calls column counts the ones made on the fibers' behalf.
+ *
+ * Usage: bin/bench/loop [files] [bytes per file]
+ * */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "loop.h"
+#include "run.h"
+
+#define RUNS 3
+
+struct files {
+    char dir[32];
+    char** scripts;
+    usize count;
+    usize size;
+};
+
+static void files_create(struct files* files, usize count, usize size) {
+    char path[64];
+    char* contents = malloc(size);
+    usize i;
+    i32 fd;
+
+    assert(contents);
+    memset(contents, 'x', size);
+
+    strcpy(files->dir, "/tmp/hoax-bench-loop-XXXXXX");
+    assert(mkdtemp(files->dir));
+
+    files->scripts = malloc(sizeof(char*) * count);
+    files->count = count;
+    files->size = size;
+    assert(files->scripts);
+
+    for (i = 0; i < count; ++i) {
+        snprintf(path, sizeof(path), "%s/%lu", files->dir, (unsigned long)i);
+
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        assert(fd >= 0);
+        assert(write(fd, contents, size) == (isize)size);
+        close(fd);
+
+        files->scripts[i] = malloc(128);
+        assert(files->scripts[i]);
+        snprintf(files->scripts[i], 128, "(#read-file \"%s\")", path);
+    }
+
+    free(contents);
+}
+
+static void files_destroy(struct files* files) {
+    char path[64];
+    usize i;
+
+    for (i = 0; i < files->count; ++i) {
+        snprintf(path, sizeof(path), "%s/%lu", files->dir, (unsigned long)i);
+        unlink(path);
+        free(files->scripts[i]);
+    }
+
+    rmdir(files->dir);
+    free(files->scripts);
+}
+
+static struct slice(char) script(struct files* files, usize i) {
+    return (struct slice(char)){files->scripts[i], strlen(files->scripts[i])};
+}
+
+static f64 run_loop(struct files* files, enum loop_backend backend, enum loop_backend* used, u64* syscalls) {
+    struct fiber* fibers = calloc(files->count, sizeof(struct fiber));
+    struct loop loop;
+    struct vm vm = {0};
+    f64 start, elapsed;
+    usize i;
+
+    assert(fibers);
+
+    vm_init(&vm);
+    isolate_enter(&vm.isolate);
+    loop_init(&loop, &vm, backend);
+
+    start = monotonic_now();
+
+    for (i = 0; i < files->count; ++i) {
+        fiber_init(&fibers[i], script(files, i));
+        loop_spawn(&loop, &fibers[i]);
+    }
+
+    loop_run(&loop);
+
+    elapsed = monotonic_now() - start;
+
+    for (i = 0; i < files->count; ++i) {
+        assert(fibers[i].status == VM_OK && stringp(fibers[i].result));
+        assert(expr_string(&fibers[i].result).length == files->size);
+        fiber_destroy(&fibers[i]);
+    }
+
+    *used = loop.backend;
+    *syscalls = loop.syscalls;
+
+    loop_destroy(&loop);
+    isolate_leave(&vm.isolate);
+    vm_destroy(&vm);
+    free(fibers);
+
+    return elapsed;
+}
+
+/* Without a loop the natives just block */
+static f64 run_serial(struct files* files) {
+    struct vm vm = {0};
+    f64 start, elapsed;
+    usize i;
+
+    vm_init(&vm);
+    isolate_enter(&vm.isolate);
+
+    start = monotonic_now();
+
+    for (i = 0; i < files->count; ++i) {
+        run_source(&vm, script(files, i), 1, RUN_WHOLE);
+        assert(stringp(vm.result) && expr_string(&vm.result).length == files->size);
+    }
+
+    elapsed = monotonic_now() - start;
+
+    isolate_leave(&vm.isolate);
+    vm_destroy(&vm);
+
+    return elapsed;
+}
+
+static void report_loop(struct files* files, const char* label, enum loop_backend backend) {
+    enum loop_backend used = backend;
+    f64 best = 1e9, elapsed;
+    u64 syscalls = 0;
+    i32 i;
+
+    for (i = 0; i < RUNS; ++i) {
+        elapsed = run_loop(files, backend, &used, &syscalls);
+        if (elapsed < best) best = elapsed;
+    }
+
+    if (used != backend) {
+        printf("  %-10s not available here\n", label);
+        return;
+    }
+
+    printf("  %-10s %9.3f ms  %8lu syscalls  %6.2f per file\n", label, best * 1e3,
+           (unsigned long)syscalls, syscalls / (f64)files->count);
+}
+
+i32 main(i32 argc, char** argv) {
+    struct files files = {0};
+    usize count = 10000;
+    usize size = 1024;
+    f64 best = 1e9, elapsed;
+    i32 i;
+
+    if (argc > 1) count = atoi(argv[1]);
+    if (argc > 2) size = atoi(argv[2]);
+
+    files_create(&files, count, size);
+
+    printf("%lu fibers reading a %lu byte file each\n", (unsigned long)count, (unsigned long)size);
+
+    report_loop(&files, "io_uring", LOOP_BACKEND_URING);
+    report_loop(&files, "epoll", LOOP_BACKEND_EPOLL);
+
+    for (i = 0; i < RUNS; ++i) {
+        elapsed = run_serial(&files);
+        if (elapsed < best) best = elapsed;
+    }
+
+    printf("  %-10s %9.3f ms\n", "serial", best * 1e3);
+
+    files_destroy(&files);
+
+    return 0;
+}
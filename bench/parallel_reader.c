@@ -0,0 +1,85 @@
+/*
+ * Wall clock time to read a generated data file serially and with a growing
+ * number of threads through parallel_read_forms, including the pre-scan and
+ * stitching the heaps back together.
+ *
+ * Usage: bin/bench/parallel_reader [megabytes]
+ * */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "expr.h"
+#include "parallel.h"
+
+#define RUNS 5
+
+static f64 run(struct slice(char) src, usize threads, usize* count) {
+    struct dynarray(u32) forms = {0};
+    f64 start, elapsed;
+    u32 error_code;
+
+    DYNARRAY_CLEAR(&exprs);
+    expr_new_nil();
+
+    start = monotonic_now();
+    error_code = parallel_read_forms(src, threads, &forms);
+    elapsed = monotonic_now() - start;
+
+    assert(error_code == 0);
+
+    *count = forms.length;
+    DYNARRAY_FREE(&forms);
+
+    return elapsed;
+}
+
+static f64 fastest(struct slice(char) src, usize threads, usize* count) {
+    f64 best = 1e9;
+    f64 elapsed;
+    i32 i;
+
+    for (i = 0; i < RUNS; ++i) {
+        elapsed = run(src, threads, count);
+        if (elapsed < best) best = elapsed;
+    }
+
+    return best;
+}
+
+i32 main(i32 argc, char** argv) {
+    static const usize thread_counts[] = {2, 4, 8};
+    struct slice(char) src;
+    usize megabytes = 64;
+    usize serial_count, count;
+    f64 serial, elapsed;
+    usize i;
+
+    if (argc > 1) megabytes = atoi(argv[1]);
+
+    src = bench_generate_records(megabytes);
+
+    printf("parallel reader over %.1f MB of generated data (%lu cpus online)\n",
+           src.length / (f64)MEGABYTES(1),
+           (unsigned long)parallel_default_threads(PARALLEL_READ_MIN_SIZE));
+
+    serial = fastest(src, 1, &serial_count);
+    printf("  serial     %9.3f ms %8.1f MB/s\n", serial * 1e3, src.length / (f64)MEGABYTES(1) / serial);
+
+    for (i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); ++i) {
+        elapsed = fastest(src, thread_counts[i], &count);
+
+        /* the stitched result has to match what the serial reader saw */
+        assert(count == serial_count);
+
+        printf("  %lu threads  %9.3f ms %8.1f MB/s %6.2fx\n", (unsigned long)thread_counts[i],
+               elapsed * 1e3, src.length / (f64)MEGABYTES(1) / elapsed, serial / elapsed);
+    }
+
+    free(src.ptr);
+    DYNARRAY_FREE(&exprs);
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * End to end time to read, compile, and run a generated data loading script,
+ * once with every form read up front before any of them run, and once through
+ * the pipeline where a reader thread feeds the vm while it runs.
+ *
+ * Usage: bin/bench/pipeline [megabytes]
+ * */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "compiler.h"
+#include "expr.h"
+#include "parallel.h"
+#include "pipeline.h"
+#include "vm.h"
+
+#define RUNS 5
+
+/* Globals are reused so the global map never fills up */
+#define GLOBALS 512
+
+static struct slice(char) generate(usize megabytes) {
+    usize capacity = MEGABYTES(megabytes) + KILOBYTES(1);
+    char* buffer = malloc(capacity);
+    usize length = 0;
+    u64 seed = 0x2545f4914f6cdd1dull;
+    u64 n;
+
+    assert(buffer);
+
+    while (length + 256 < capacity - KILOBYTES(1)) {
+        n = bench_rand(&seed);
+        length += sprintf(buffer + length, "(defvar slot-%lu\n    (cons %lu (cons %lu (cons (+ %lu 1) nil))))\n",
+                          (unsigned long)(n % GLOBALS), (unsigned long)(n >> 40),
+                          (unsigned long)(n % 65536), (unsigned long)(n % 97));
+    }
+
+    return (struct slice(char)){buffer, length};
+}
+
+static f64 run_phased(struct slice(char) src) {
+    struct dynarray(u32) forms = {0};
+    struct module module = {0};
+    struct compiler compiler = {0};
+    struct vm vm = {0};
+    f64 start, elapsed;
+    u32 i;
+
+    DYNARRAY_CLEAR(&exprs);
+    expr_new_nil();
+    vm_init(&vm);
+
+    start = monotonic_now();
+
+    assert(parallel_read_forms(src, 1, &forms) == 0);
+
+    compiler_init(&compiler, reader_create_borrowed(src), &module);
+    for (i = 0; i < forms.length; ++i) {
+        DYNARRAY_CLEAR(&module.code);
+        DYNARRAY_CLEAR(&module.constants);
+
+        assert(compile_form(&compiler, EXPR(forms.at[i])) == COMPILE_OK);
+        vm_run(&vm, &module);
+    }
+
+    elapsed = monotonic_now() - start;
+
+    compiler_destroy(&compiler);
+    module_destroy(&module);
+    DYNARRAY_FREE(&forms);
+    vm_destroy(&vm);
+
+    return elapsed;
+}
+
+static f64 run_pipelined(struct slice(char) src) {
+    struct vm vm = {0};
+    f64 start, elapsed;
+
+    DYNARRAY_CLEAR(&exprs);
+    expr_new_nil();
+    vm_init(&vm);
+
+    start = monotonic_now();
+    assert(pipeline_run(&vm, src) == COMPILE_OK);
+    elapsed = monotonic_now() - start;
+
+    vm_destroy(&vm);
+
+    return elapsed;
+}
+
+static f64 fastest(f64 (*run)(struct slice(char)), struct slice(char) src) {
+    f64 best = 1e9;
+    f64 elapsed;
+    i32 i;
+
+    for (i = 0; i < RUNS; ++i) {
+        elapsed = run(src);
+        if (elapsed < best) best = elapsed;
+    }
+
+    return best;
+}
+
+i32 main(i32 argc, char** argv) {
+    struct slice(char) src;
+    usize megabytes = 32;
+    f64 phased, pipelined;
+
+    if (argc > 1) megabytes = atoi(argv[1]);
+
+    src = generate(megabytes);
+
+    printf("read, compile, and run %.1f MB of generated data\n", src.length / (f64)MEGABYTES(1));
+
+    phased = fastest(run_phased, src);
+    printf("  read then run %9.3f ms\n", phased * 1e3);
+
+    pipelined = fastest(run_pipelined, src);
+    printf("  pipelined     %9.3f ms %6.2fx\n", pipelined * 1e3, phased / pipelined);
+
+    free(src.ptr);
+    DYNARRAY_FREE(&exprs);
+
+    return 0;
+}
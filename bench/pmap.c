@@ -0,0 +1,91 @@
+/*
+ * Time to map an arithmetic heavy native over a long list of integers on the
+ * calling thread alone and with pools of a growing number of workers. Speedup
+ * should be close to linear up to the number of cores.
+ *
+ * Usage: bin/bench/pmap [elements]
+ * */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "isolate.h"
+#include "pmap.h"
+
+#define ROUNDS 2000
+
+/* Stands in for whatever number crunching a real element function does */
+static struct expr native_churn(struct expr args) {
+    u64 x = (u64)CAR(args).integer + 1;
+    i32 i;
+
+    for (i = 0; i < ROUNDS; ++i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+    }
+
+    return expr_create_integer((i64)(x & 0xFFFF));
+}
+
+static f64 run(usize threads, struct expr fn, struct expr list, i64* checksum) {
+    struct pmap_pool pool;
+    struct expr result;
+    f64 start, elapsed;
+
+    pmap_pool_init(&pool, threads);
+
+    start = monotonic_now();
+    result = pmap_pool_run(&pool, fn, list);
+    elapsed = monotonic_now() - start;
+
+    for (*checksum = 0; consp(result); result = CDR(result)) {
+        *checksum += CAR(result).integer;
+    }
+
+    pmap_pool_destroy(&pool);
+
+    return elapsed;
+}
+
+i32 main(i32 argc, char** argv) {
+    static const usize thread_counts[] = {1, 2, 4, 8, 16, 32};
+    struct expr fn = expr_create_native(native_churn, 1);
+    struct isolate isolate = {0};
+    usize elements = 200000;
+    i64 serial_sum, sum;
+    f64 serial, elapsed;
+    u32 list = 0;
+    usize i;
+
+    if (argc > 1) elements = atoi(argv[1]);
+
+    isolate_enter(&isolate);
+
+    for (i = elements; i > 0; --i) {
+        list = expr_new_cons(expr_new_integer(i), list);
+    }
+
+    printf("pmap over %lu integers, %d rounds each (%ld cpus online)\n",
+           (unsigned long)elements, ROUNDS, sysconf(_SC_NPROCESSORS_ONLN));
+
+    /* a pool without threads maps on the caller */
+    serial = run(0, fn, EXPR(list), &serial_sum);
+    printf("  sequential   %9.3f ms\n", serial * 1e3);
+
+    for (i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); ++i) {
+        /* the caller is a worker too */
+        elapsed = run(thread_counts[i] - 1, fn, EXPR(list), &sum);
+        assert(sum == serial_sum);
+
+        printf("  %2lu workers   %9.3f ms %6.2fx\n", (unsigned long)thread_counts[i], elapsed * 1e3, serial / elapsed);
+    }
+
+    isolate_leave(&isolate);
+    isolate_destroy(&isolate);
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * Reader throughput in MB/s over a generated data file, once per scanning
+ * level the CPU supports, followed by the time it takes to read single list
+ * literals of growing length, which should grow linearly.
+ *
+ * Usage: bin/bench/reader [megabytes]
+ * */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "expr.h"
+#include "reader.h"
+#include "scan.h"
+
+#define RUNS 5
+
+static const char* level_names[] = {"scalar", "sse2", "avx2"};
+
+static f64 run(struct slice(char) src) {
+    struct reader reader;
+    f64 start;
+    u32 ptr;
+
+    DYNARRAY_CLEAR(&exprs);
+    expr_new_nil();
+
+    reader = reader_create_borrowed(src);
+
+    start = monotonic_now();
+    while ((ptr = read_expr(&reader)) != 0) {
+        assert(ptr != READER_ERROR);
+    }
+
+    return monotonic_now() - start;
+}
+
+/* (list 0 1 2 ... n-1) */
+static struct slice(char) generate_list(usize n) {
+    char* buffer = malloc(n * 12 + 16);
+    usize length = 0;
+    usize i;
+
+    assert(buffer);
+
+    length += sprintf(buffer, "(list");
+    for (i = 0; i < n; ++i) {
+        length += sprintf(buffer + length, " %lu", (unsigned long)i);
+    }
+    length += sprintf(buffer + length, ")");
+
+    return (struct slice(char)){buffer, length};
+}
+
+static void run_lists(void) {
+    struct slice(char) src;
+    struct reader reader;
+    usize n;
+    f64 start, elapsed;
+    u32 ptr;
+
+    printf("single list literal of n elements\n");
+
+    for (n = 1000; n <= 10000000; n *= 10) {
+        src = generate_list(n);
+
+        DYNARRAY_CLEAR(&exprs);
+        expr_new_nil();
+        reader = reader_create_borrowed(src);
+
+        start = monotonic_now();
+        ptr = read_expr(&reader);
+        elapsed = monotonic_now() - start;
+
+        assert(ptr != READER_ERROR && EXPR(ptr).length == n + 1);
+
+        printf("  n = %-9lu %10.3f ms %8.1f ns/element\n", (unsigned long)n,
+               elapsed * 1e3, elapsed * 1e9 / n);
+
+        free(src.ptr);
+    }
+}
+
+i32 main(i32 argc, char** argv) {
+    struct slice(char) src;
+    enum scan_level level, best;
+    f64 elapsed, fastest;
+    usize megabytes = 64;
+    i32 i;
+
+    if (argc > 1) megabytes = atoi(argv[1]);
+
+    src = bench_generate_records(megabytes);
+    best = scan_best_level();
+
+    printf("reader throughput over %.1f MB of generated data\n", src.length / (f64)MEGABYTES(1));
+
+    for (level = best; (i32)level >= SCAN_LEVEL_SCALAR; --level) {
+        scan_set_level(level);
+
+        fastest = 1e9;
+        for (i = 0; i < RUNS; ++i) {
+            elapsed = run(src);
+            if (elapsed < fastest) fastest = elapsed;
+        }
+
+        printf("  %-8s %8.1f MB/s\n", level_names[scan_get_level()],
+               src.length / (f64)MEGABYTES(1) / fastest);
+    }
+
+    free(src.ptr);
+
+    run_lists();
+
+    DYNARRAY_FREE(&exprs);
+
+    return 0;
+}
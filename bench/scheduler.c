@@ -0,0 +1,130 @@
+/*
+ * Latency of short scripts arriving while heavy ones are running, with every
+ * task run to the end in one go and with tasks round-robined a quantum at a
+ * time. Run to the end, a short script waits for whichever heavy scripts got
+ * the threads first. With quanta its latency should barely move.
+ *
+ * Usage: bin/bench/scheduler [threads]
+ * */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <time.h>
+
+#include "bench.h"
+#include "scheduler.h"
+
+#define HEAVY_TASKS 8
+#define HEAVY_INSTRUCTIONS 4000000
+#define SHORT_TASKS 2000
+#define SHORT_GAP_NS 50000
+
+static const char short_src[] =
+    "(defvar base (* 3 14))\n"
+    "(+ base 1)\n";
+
+struct bench_task {
+    struct scheduler_task task; /* first, so the done callback can cast back */
+    f64 submitted;
+    f64 latency;
+};
+
+static void task_done(struct scheduler_task* task, void* data) {
+    struct bench_task* bench_task = (struct bench_task*)task;
+    UNUSED(data);
+
+    bench_task->latency = monotonic_now() - bench_task->submitted;
+}
+
+/* There are no loops to write a long script with yet, so assemble one */
+static void heavy_task_init(struct scheduler_task* task) {
+    u8 one;
+    usize i;
+
+    scheduler_task_init(task, (struct slice(char)){0});
+
+    one = module_write_const(&task->module, expr_create_integer(1));
+
+    for (i = 0; i < HEAVY_INSTRUCTIONS / 4; ++i) {
+        module_write_byte(&task->module, OP_CONSTANT);
+        module_write_byte(&task->module, one);
+        module_write_byte(&task->module, OP_CONSTANT);
+        module_write_byte(&task->module, one);
+        module_write_byte(&task->module, OP_ADD);
+        module_write_byte(&task->module, OP_POP);
+    }
+
+    module_write_byte(&task->module, OP_NIL);
+    module_write_byte(&task->module, OP_RETURN);
+
+    task->compiled = true;
+}
+
+static int compare_f64(const void* a, const void* b) {
+    f64 x = *(const f64*)a, y = *(const f64*)b;
+    return (x > y) - (x < y);
+}
+
+static void run(const char* label, usize threads, u64 quantum) {
+    struct bench_task heavy[HEAVY_TASKS] = {0};
+    struct bench_task* shorts = calloc(SHORT_TASKS, sizeof(struct bench_task));
+    f64* latencies = malloc(sizeof(f64) * SHORT_TASKS);
+    struct timespec gap = {0, SHORT_GAP_NS};
+    struct scheduler scheduler;
+    f64 start, elapsed;
+    usize i;
+
+    assert(shorts && latencies);
+
+    scheduler_init(&scheduler, threads, quantum);
+    scheduler.done = task_done;
+
+    for (i = 0; i < HEAVY_TASKS; ++i) heavy_task_init(&heavy[i].task);
+
+    start = monotonic_now();
+    for (i = 0; i < HEAVY_TASKS; ++i) scheduler_submit(&scheduler, &heavy[i].task);
+
+    for (i = 0; i < SHORT_TASKS; ++i) {
+        scheduler_task_init(&shorts[i].task, (struct slice(char)){(char*)short_src, sizeof(short_src) - 1});
+        shorts[i].submitted = monotonic_now();
+        scheduler_submit(&scheduler, &shorts[i].task);
+        nanosleep(&gap, NULL);
+    }
+
+    scheduler_wait(&scheduler);
+    elapsed = monotonic_now() - start;
+
+    for (i = 0; i < SHORT_TASKS; ++i) {
+        assert(shorts[i].task.status == VM_OK && shorts[i].task.vm.result.integer == 43);
+        latencies[i] = shorts[i].latency;
+    }
+
+    qsort(latencies, SHORT_TASKS, sizeof(f64), compare_f64);
+
+    printf("  %-12s p50 %9.3f ms  p99 %9.3f ms  max %9.3f ms  total %8.1f ms\n", label,
+           latencies[SHORT_TASKS / 2] * 1e3, latencies[SHORT_TASKS * 99 / 100] * 1e3,
+           latencies[SHORT_TASKS - 1] * 1e3, elapsed * 1e3);
+
+    scheduler_destroy(&scheduler);
+
+    for (i = 0; i < HEAVY_TASKS; ++i) scheduler_task_destroy(&heavy[i].task);
+    for (i = 0; i < SHORT_TASKS; ++i) scheduler_task_destroy(&shorts[i].task);
+
+    free(shorts);
+    free(latencies);
+}
+
+i32 main(i32 argc, char** argv) {
+    usize threads = 2;
+
+    if (argc > 1) threads = atoi(argv[1]);
+
+    printf("%d short scripts arriving behind %d heavy ones of %d instructions on %lu threads\n",
+           SHORT_TASKS, HEAVY_TASKS, HEAVY_INSTRUCTIONS, (unsigned long)threads);
+
+    run("to the end", threads, VM_BUDGET_UNLIMITED);
+    run("quantum", threads, SCHEDULER_QUANTUM);
+
+    return 0;
+}
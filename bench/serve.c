@@ -0,0 +1,165 @@
+/*
+ * Per request latency of a small script sent to a warm server, reusing one
+ * connection and opening a new one for every request, next to starting a
+ * fresh bin/hoax for every run of the same script when it has been built.
+ *
+ * Usage: bin/bench/serve [requests] [workers]
+ * */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "bench.h"
+#include "serve.h"
+
+#define SOCKET_PATH "/tmp/hoax-bench-serve.sock"
+#define HOAX_PATH "bin/hoax"
+
+static const char script[] =
+    "(defvar base (* 3 14))\n"
+    "(#display base)\n"
+    "(+ base 1)\n";
+
+static int compare_f64(const void* a, const void* b) {
+    f64 x = *(const f64*)a, y = *(const f64*)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char* label, f64* latencies, usize count) {
+    qsort(latencies, count, sizeof(f64), compare_f64);
+
+    printf("  %-16s p50 %9.3f ms  p99 %9.3f ms  max %9.3f ms\n", label,
+           latencies[count / 2] * 1e3, latencies[count * 99 / 100] * 1e3, latencies[count - 1] * 1e3);
+}
+
+static void check(struct serve_response* response) {
+    assert(response->status == SERVE_OK);
+    assert(response->output.length == 3 && memcmp(response->output.ptr, "42\n", 3) == 0);
+    assert(response->result.length == 2 && memcmp(response->result.ptr, "43", 2) == 0);
+}
+
+static void run_warm(f64* latencies, usize count, bool reconnect) {
+    struct slice(char) text = {(char*)script, sizeof(script) - 1};
+    struct serve_response response;
+    i32 fd = -1;
+    f64 start;
+    usize i;
+
+    for (i = 0; i < count; ++i) {
+        start = monotonic_now();
+
+        if (fd < 0) fd = serve_connect(SOCKET_PATH);
+        assert(fd >= 0);
+
+        if (!serve_request(fd, text, &response)) assert(false && "the server dropped a request");
+
+        if (reconnect) {
+            close(fd);
+            fd = -1;
+        }
+
+        latencies[i] = monotonic_now() - start;
+
+        check(&response);
+        serve_response_free(&response);
+    }
+
+    if (fd >= 0) close(fd);
+}
+
+/* What every request costs without a server, a whole new process per script */
+static void run_cold(const char* path, f64* latencies, usize count) {
+    i32 status, null;
+    pid_t pid;
+    f64 start;
+    usize i;
+
+    for (i = 0; i < count; ++i) {
+        start = monotonic_now();
+
+        pid = fork();
+        if (pid == 0) {
+            null = open("/dev/null", O_WRONLY);
+            dup2(null, STDOUT_FILENO);
+            execl(HOAX_PATH, HOAX_PATH, path, (char*)NULL);
+            _exit(127);
+        }
+
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+        latencies[i] = monotonic_now() - start;
+
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+}
+
+i32 main(i32 argc, char** argv) {
+    struct serve_options options = {0};
+    struct timespec pause = {0, 1000000};
+    char path[] = "/tmp/hoax-bench-serve-XXXXXX";
+    usize requests = 2000;
+    f64* latencies;
+    pid_t server;
+    FILE* file;
+    i32 fd;
+
+    if (argc > 1) requests = atoi(argv[1]);
+
+    options.path = SOCKET_PATH;
+    options.workers = argc > 2 ? (usize)atoi(argv[2]) : 1;
+    options.timeout_ms = SERVE_TIMEOUT_DEFAULT_MS;
+
+    latencies = malloc(sizeof(f64) * requests);
+    assert(latencies && requests > 0);
+
+    unlink(SOCKET_PATH);
+
+    server = fork();
+    if (server == 0) _exit(serve_run(&options));
+    assert(server > 0);
+
+    /* the socket is listening as soon as it exists, workers or not */
+    while ((fd = serve_connect(SOCKET_PATH)) < 0) nanosleep(&pause, NULL);
+    close(fd);
+
+    printf("%lu requests of a %lu byte script on %lu workers\n", (unsigned long)requests,
+           (unsigned long)(sizeof(script) - 1), (unsigned long)options.workers);
+
+    run_warm(latencies, requests, false);
+    report("one connection", latencies, requests);
+
+    run_warm(latencies, requests, true);
+    report("new connections", latencies, requests);
+
+    kill(server, SIGTERM);
+    while (waitpid(server, NULL, 0) < 0 && errno == EINTR);
+
+    if (access(HOAX_PATH, X_OK) == 0) {
+        fd = mkstemp(path);
+        assert(fd >= 0);
+
+        file = fdopen(fd, "w");
+        fwrite(script, 1, sizeof(script) - 1, file);
+        fclose(file);
+
+        /* a process per request is slow enough that a tenth of the runs will do */
+        if (requests >= 10) requests /= 10;
+
+        run_cold(path, latencies, requests);
+        report("new process", latencies, requests);
+
+        unlink(path);
+    } else {
+        printf("  build %s to compare against a new process per script\n", HOAX_PATH);
+    }
+
+    free(latencies);
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * What reading a shared global costs as its value grows, from one cell up to
+ * a list of a million. Reads hand back the value where it sits in the shared
+ * heap, so they should stay flat; copying the value into the reader's heap,
+ * which is what reads used to do, is timed next to them for comparison.
+ *
+ * Usage: bin/bench/shared_env [max cells]
+ * */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "pack.h"
+#include "shared.h"
+
+#define READS 1000000
+#define COPIES_CELLS 1000000
+
+/* A list of length symbols, so the text gets copied along with the cells */
+static struct expr build_list(usize length) {
+    u32 list = 0;
+    usize i;
+
+    for (i = 0; i < length; ++i) list = expr_new_cons(expr_new_symbol("config-value", 12), list);
+
+    return EXPR(list);
+}
+
+i32 main(i32 argc, char** argv) {
+    struct slice(char) name = {"config", 6};
+    struct shared_env env;
+    struct packed_expr* packed;
+    volatile u32 sink = 0;
+    usize max_cells = 1000000;
+    usize cells, copies, i;
+    u32 mark;
+    f64 start, read, copy;
+
+    if (argc > 1) max_cells = atoi(argv[1]);
+
+    expr_new_nil();
+    shared_env_init(&env);
+
+    printf("%10s %12s %12s\n", "cells", "read ns", "copy ns");
+
+    for (cells = 1; cells <= max_cells; cells *= 10) {
+        mark = exprs.length;
+        shared_env_set(&env, name, build_list(cells));
+        packed = expr_pack(build_list(cells));
+        exprs.length = mark;
+
+        start = monotonic_now();
+        for (i = 0; i < READS; ++i) sink += shared_env_get(&env, name).item.car;
+        read = (monotonic_now() - start) / READS;
+
+        /* enough copies to time, without copying more than a million cells a row */
+        copies = COPIES_CELLS / cells < 10 ? 10 : COPIES_CELLS / cells;
+
+        start = monotonic_now();
+        for (i = 0; i < copies; ++i) {
+            sink += expr_unpack(packed).car;
+            exprs.length = mark;
+        }
+        copy = (monotonic_now() - start) / copies;
+
+        free(packed);
+
+        /* the copies' text went in the arena */
+        arena_destroy(&expr_arena);
+        expr_arena = (struct arena){0};
+
+        printf("%10lu %12.1f %12.1f\n", (unsigned long)cells, read * 1e9, copy * 1e9);
+    }
+
+    shared_env_destroy(&env);
+    arena_destroy(&expr_arena);
+    DYNARRAY_FREE(&exprs);
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * Lookups per second and memory for a configuration of globals that every
+ * thread reads, once with each thread holding a private copy in its own vm and
+ * once with all of them reading one shared environment.
+ *
+ * Usage: bin/bench/shared_globals [threads]
+ * */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include "bench.h"
+#include "compiler.h"
+#include "run.h"
+#include "shared.h"
+#include "vm.h"
+
+/* Kept well under what the private global map can hold */
+#define CONFIG_INTEGERS 640
+#define CONFIG_LISTS 64
+#define CONFIG_LIST_LENGTH 8
+#define RUNS 200000
+
+static const char scalar_src[] = "(+ key-17 key-503)\n";
+static const char list_src[] = "(car (cdr list-5))\n";
+
+struct worker {
+    pthread_t thread;
+    struct slice(char) config;
+    struct shared_env* shared; /* NULL to load the config privately */
+    const char* src;
+    usize src_length;
+    usize bytes;
+    i64 result;
+};
+
+static struct slice(char) generate_config(void) {
+    usize capacity = KILOBYTES(128);
+    char* buffer = malloc(capacity);
+    usize length = 0;
+    usize i, j;
+
+    assert(buffer);
+
+    for (i = 0; i < CONFIG_INTEGERS; ++i) {
+        length += sprintf(buffer + length, "(defvar key-%lu %lu)\n", (unsigned long)i, (unsigned long)i * 3);
+    }
+
+    for (i = 0; i < CONFIG_LISTS; ++i) {
+        length += sprintf(buffer + length, "(defvar list-%lu ", (unsigned long)i);
+        for (j = 0; j < CONFIG_LIST_LENGTH; ++j) length += sprintf(buffer + length, "(cons %lu ", (unsigned long)j);
+        length += sprintf(buffer + length, "nil");
+        for (j = 0; j < CONFIG_LIST_LENGTH; ++j) length += sprintf(buffer + length, ")");
+        length += sprintf(buffer + length, ")\n");
+    }
+
+    assert(length < capacity);
+
+    return (struct slice(char)){buffer, length};
+}
+
+static void* worker_run(void* arg) {
+    struct worker* worker = arg;
+    struct compiler compiler = {0};
+    struct module module = {0};
+    struct vm vm = {0};
+    usize mark, i;
+
+    vm_init(&vm);
+    isolate_enter(&vm.isolate);
+
+    if (worker->shared) {
+        vm.shared = worker->shared;
+    } else {
+        /* one form at a time, the whole config has more constants than a module can */
+        assert(run_source(&vm, worker->config, 1, RUN_STREAMING) == COMPILE_OK);
+        worker->bytes = exprs.length * sizeof(struct expr) + arena_used(&expr_arena)
+                      + vm.global_map.size * sizeof(struct smap_slot(expr));
+    }
+
+    compiler_init(&compiler, reader_create_borrowed((struct slice(char)){(char*)worker->src, worker->src_length}), &module);
+    assert(compile(&compiler) == COMPILE_OK);
+
+    mark = exprs.length;
+
+    for (i = 0; i < RUNS; ++i) {
+        worker->result = vm_run(&vm, &module).integer;
+
+        /* the result is an integer, so nothing the run built is needed */
+        exprs.length = mark;
+    }
+
+    compiler_destroy(&compiler);
+    module_destroy(&module);
+
+    isolate_leave(&vm.isolate);
+    vm_destroy(&vm);
+
+    return NULL;
+}
+
+static void run(const char* label, usize threads, struct slice(char) config, struct shared_env* shared,
+                const char* src, usize src_length, i64 expected) {
+    struct worker* workers = calloc(threads, sizeof(struct worker));
+    f64 start, elapsed;
+    usize bytes = 0;
+    usize i;
+
+    assert(workers);
+
+    start = monotonic_now();
+
+    for (i = 0; i < threads; ++i) {
+        workers[i] = (struct worker){ .config = config, .shared = shared, .src = src, .src_length = src_length };
+        assert(pthread_create(&workers[i].thread, NULL, worker_run, &workers[i]) == 0);
+    }
+
+    for (i = 0; i < threads; ++i) {
+        pthread_join(workers[i].thread, NULL);
+        assert(workers[i].result == expected);
+        bytes += workers[i].bytes;
+    }
+
+    elapsed = monotonic_now() - start;
+
+    if (shared) bytes = shared->bytes;
+
+    printf("  %-16s %12.0f runs/s %10.1f KB of config\n", label, threads * RUNS / elapsed, bytes / 1024.0);
+
+    free(workers);
+}
+
+i32 main(i32 argc, char** argv) {
+    struct slice(char) config = generate_config();
+    struct shared_env shared;
+    struct vm loader = {0};
+    usize threads = 4;
+
+    if (argc > 1) threads = atoi(argv[1]);
+
+    /* a vm attached to the environment publishes its defvars there */
+    shared_env_init(&shared);
+    vm_init(&loader);
+    loader.shared = &shared;
+    isolate_enter(&loader.isolate);
+    assert(run_source(&loader, config, 1, RUN_STREAMING) == COMPILE_OK);
+    isolate_leave(&loader.isolate);
+    vm_destroy(&loader);
+
+    printf("%d globals read by %lu threads, %d runs each\n",
+           CONFIG_INTEGERS + CONFIG_LISTS, (unsigned long)threads, RUNS);
+
+    run("private scalars", threads, config, NULL, scalar_src, sizeof(scalar_src) - 1, 17 * 3 + 503 * 3);
+    run("shared scalars", threads, config, &shared, scalar_src, sizeof(scalar_src) - 1, 17 * 3 + 503 * 3);
+    run("private lists", threads, config, NULL, list_src, sizeof(list_src) - 1, 1);
+    run("shared lists", threads, config, &shared, list_src, sizeof(list_src) - 1, 1);
+
+    shared_env_destroy(&shared);
+    free(config.ptr);
+
+    return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * Putting a string together out of many short pieces with #string-append,
+ * which copies everything built so far every time, next to appending them to
+ * a builder and making the string once at the end. After that, what a
+ * #substring costs as the substring gets longer, which stays flat since it
+ * shares the bytes of the string it was taken from, and what making a string
+ * costs on either side of the small string limit.
+ *
+ * Usage: bin/bench/string [max pieces]
+ * */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "builder.h"
+#include "expr.h"
+#include "native.h"
+
+#define PIECE "abcd"
+#define SOURCE_LENGTH MEGABYTES(1)
+#define CREATES 1000000
+
+/* The natives take their arguments as a list on the heap */
+static struct expr call2(native_fn fn, struct expr a, struct expr b) {
+    u32 args = expr_new_cons(expr_box(b), 0);
+
+    args = expr_new_cons(expr_box(a), args);
+
+    return fn(EXPR(args));
+}
+
+static struct expr call3(native_fn fn, struct expr a, struct expr b, struct expr c) {
+    u32 args = expr_new_cons(expr_box(c), 0);
+
+    args = expr_new_cons(expr_box(b), args);
+    args = expr_new_cons(expr_box(a), args);
+
+    return fn(EXPR(args));
+}
+
+static f64 time_append(usize pieces) {
+    struct expr piece = expr_create_string(PIECE, strlen(PIECE));
+    struct expr string = expr_create_string("", 0);
+    f64 start;
+    usize i;
+
+    start = monotonic_now();
+    for (i = 0; i < pieces; ++i) string = call2(native_string_append, string, piece);
+
+    assert(expr_string(&string).length == pieces * strlen(PIECE));
+
+    return monotonic_now() - start;
+}
+
+static f64 time_builder(usize pieces) {
+    struct expr piece = expr_create_string(PIECE, strlen(PIECE));
+    struct builder* builder = builder_create();
+    struct expr string;
+    f64 start;
+    usize i;
+
+    start = monotonic_now();
+    for (i = 0; i < pieces; ++i) builder_append_expr(builder, piece);
+    string = builder_string(builder);
+
+    assert(expr_string(&string).length == pieces * strlen(PIECE));
+
+    return monotonic_now() - start;
+}
+
+static f64 time_substring(struct expr source, usize length, usize calls) {
+    volatile usize sink = 0;
+    struct expr slice;
+    f64 start;
+    usize i, offset;
+
+    start = monotonic_now();
+    for (i = 0; i < calls; ++i) {
+        offset = (i * 4099) % (SOURCE_LENGTH - length + 1);
+        slice = call3(native_substring, source, expr_create_integer(offset),
+                      expr_create_integer(offset + length));
+        sink += expr_string(&slice).length;
+    }
+
+    return (monotonic_now() - start) / calls;
+}
+
+static f64 time_create(const char* text, u32 length) {
+    volatile u32 sink = 0;
+    struct expr string;
+    f64 start;
+    usize i;
+
+    start = monotonic_now();
+    for (i = 0; i < CREATES; ++i) {
+        string = expr_create_string(text, length);
+        sink += string.small_length;
+    }
+
+    return (monotonic_now() - start) / CREATES;
+}
+
+/* Throws away the heap and arena a run filled, so the next starts from nothing */
+static void reset(struct arena* saved) {
+    arena_destroy(&expr_arena);
+    expr_arena = *saved;
+    exprs.length = 1;
+}
+
+i32 main(i32 argc, char** argv) {
+    struct arena saved = expr_arena;
+    usize max_pieces = 10000;
+    usize pieces, length;
+    char* text;
+    struct expr source;
+    f64 appended, built;
+
+    if (argc > 1) max_pieces = atoi(argv[1]);
+
+    expr_new_nil();
+
+    printf("%10s %14s %14s\n", "pieces", "append ms", "builder ms");
+
+    for (pieces = 10; pieces <= max_pieces; pieces *= 10) {
+        expr_arena = (struct arena){0};
+        appended = time_append(pieces);
+        reset(&saved);
+
+        expr_arena = (struct arena){0};
+        built = time_builder(pieces);
+        reset(&saved);
+
+        printf("%10lu %14.3f %14.3f\n", (unsigned long)pieces, appended * 1e3, built * 1e3);
+    }
+
+    text = malloc(SOURCE_LENGTH);
+    assert(text);
+    memset(text, 'x', SOURCE_LENGTH);
+    source = expr_create_string_borrowed(text, SOURCE_LENGTH);
+
+    printf("\n%10s %14s\n", "length", "substring ns");
+
+    for (length = 10; length <= SOURCE_LENGTH; length *= 10) {
+        printf("%10lu %14.1f\n", (unsigned long)length, time_substring(source, length, 100000) * 1e9);
+        exprs.length = 1;
+    }
+
+    printf("\nsmall string (%d bytes) %8.1f ns\n", EXPR_SMALL_STRING_MAX,
+           time_create(text, EXPR_SMALL_STRING_MAX) * 1e9);
+    printf("heap string  (%d bytes) %8.1f ns\n", EXPR_SMALL_STRING_MAX + 1,
+           time_create(text, EXPR_SMALL_STRING_MAX + 1) * 1e9);
+
+    free(text);
+    arena_destroy(&expr_arena);
+    DYNARRAY_FREE(&exprs);
+
+    return 0;
+}
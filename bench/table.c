@@ -0,0 +1,151 @@
+/*
+ * Lookups in a table next to the same lookups walking an association list of
+ * (key . value) conses, from 10^2 to 10^6 entries, with the keys compared the
+ * same way in both. The last line is what a table-get costs from Hoax,
+ * instruction dispatch included.
+ *
+ * Usage: bin/bench/table [max entries]
+ * */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "compiler.h"
+#include "reader.h"
+#include "table.h"
+#include "vm.h"
+
+#define CALLS_PER_MODULE 50
+
+/* Spreads the keys out so neither side gets sequential integers handed to it */
+static i64 key_of(usize i) {
+    return (i64)(i * 7919 + 13);
+}
+
+static u32 build_alist(usize entries) {
+    u32 alist = 0;
+    u32 pair;
+    usize i;
+
+    /* built back to front so entry 0 ends up first */
+    for (i = entries; i-- > 0;) {
+        pair = expr_new_cons(expr_new_integer(key_of(i)), expr_new_integer((i64)i));
+        alist = expr_new_cons(pair, alist);
+    }
+
+    return alist;
+}
+
+static struct expr alist_get(u32 alist, struct expr key) {
+    struct expr pair;
+
+    for (; alist != 0; alist = EXPR(alist).cdr) {
+        pair = EXPR(EXPR(alist).car);
+        if (table_keys_equal(EXPR(pair.car), key)) return EXPR(pair.cdr);
+    }
+
+    return expr_create_nil();
+}
+
+/* The same pseudo random keys for both, every one of them present */
+static usize next_index(u64* state, usize entries) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+
+    return *state % entries;
+}
+
+static f64 time_table(struct table* table, usize entries, usize lookups) {
+    volatile i64 sink = 0;
+    u64 state = 88172645463325252ull;
+    f64 start;
+    usize i;
+
+    start = monotonic_now();
+    for (i = 0; i < lookups; ++i) {
+        sink += table_get(table, expr_create_integer(key_of(next_index(&state, entries)))).integer;
+    }
+
+    return (monotonic_now() - start) / lookups;
+}
+
+static f64 time_alist(u32 alist, usize entries, usize lookups) {
+    volatile i64 sink = 0;
+    u64 state = 88172645463325252ull;
+    f64 start;
+    usize i;
+
+    start = monotonic_now();
+    for (i = 0; i < lookups; ++i) {
+        sink += alist_get(alist, expr_create_integer(key_of(next_index(&state, entries)))).integer;
+    }
+
+    return (monotonic_now() - start) / lookups;
+}
+
+/* Modules top out at 256 constants, so a short one gets run over and over */
+static f64 time_table_get(struct vm* vm, usize calls) {
+    const char* form = "(table-get tbl 7932)\n";
+    char src[KILOBYTES(2)];
+    struct compiler compiler = {0};
+    struct module module = {0};
+    usize length = strlen(form);
+    usize i;
+    f64 start, elapsed;
+
+    for (i = 0; i < CALLS_PER_MODULE; ++i) memcpy(src + i * length, form, length);
+
+    compiler_init(&compiler, reader_create_borrowed((struct slice(char)){src, length * CALLS_PER_MODULE}), &module);
+    assert(compile(&compiler) == COMPILE_OK);
+
+    start = monotonic_now();
+    for (i = 0; i < calls / CALLS_PER_MODULE; ++i) vm_run(vm, &module);
+    elapsed = monotonic_now() - start;
+
+    module_destroy(&module);
+    compiler_destroy(&compiler);
+
+    return elapsed / (calls - calls % CALLS_PER_MODULE);
+}
+
+i32 main(i32 argc, char** argv) {
+    struct vm vm = {0};
+    struct table* table = NULL;
+    usize max_entries = 1000000;
+    usize entries, i;
+    u32 alist;
+    f64 hashed, scanned;
+
+    if (argc > 1) max_entries = atoi(argv[1]);
+
+    vm_init(&vm);
+    isolate_enter(&vm.isolate);
+
+    printf("%10s %14s %14s\n", "entries", "table ns", "alist ns");
+
+    for (entries = 100; entries <= max_entries; entries *= 10) {
+        table = table_create();
+        for (i = 0; i < entries; ++i) {
+            table_put(table, expr_create_integer(key_of(i)), expr_create_integer((i64)i));
+        }
+
+        alist = build_alist(entries);
+
+        hashed = time_table(table, entries, 1000000);
+        /* an alist lookup reads half the list on average, so fewer of them */
+        scanned = time_alist(alist, entries, entries < 100000 ? 10000000 / entries : 100);
+
+        printf("%10lu %14.1f %14.1f\n", (unsigned long)entries, hashed * 1e9, scanned * 1e9);
+    }
+
+    vm_set_global(&vm, STRING("tbl"), expr_create_table(table));
+    printf("table-get from hoax %8.1f ns\n", time_table_get(&vm, 1000000) * 1e9);
+
+    isolate_leave(&vm.isolate);
+    vm_destroy(&vm);
+
+    return 0;
+}
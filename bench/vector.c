@@ -0,0 +1,133 @@
+/*
+ * How close the bulk vector natives get to memory bandwidth at every kernel
+ * level the CPU supports, called from Hoax on vectors of a few million
+ * elements, next to what reading one element at a time through vector-ref
+ * costs. The natives that make a vector also pay for faulting in its pages,
+ * and none of those get freed before exit.
+ *
+ * Usage: bin/bench/vector [elements]
+ * */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "compiler.h"
+#include "reader.h"
+#include "vector.h"
+#include "vm.h"
+
+#define REPEATS 3
+#define CALLS_PER_MODULE 50
+
+static const char* level_names[] = {"scalar", "sse2", "avx2"};
+
+static void compile_source(struct compiler* compiler, struct module* module, struct slice(char) src) {
+    compiler_init(compiler, reader_create_borrowed(src), module);
+    assert(compile(compiler) == COMPILE_OK);
+}
+
+/* The best of a few runs of a form, the first one faults the pages in */
+static f64 time_form(struct vm* vm, const char* form) {
+    struct compiler compiler = {0};
+    struct module module = {0};
+    f64 start, elapsed, best = 0;
+    usize i;
+
+    compile_source(&compiler, &module, STRING((char*)form));
+
+    for (i = 0; i < REPEATS; ++i) {
+        start = monotonic_now();
+        vm_run(vm, &module);
+        elapsed = monotonic_now() - start;
+        if (i == 0 || elapsed < best) best = elapsed;
+    }
+
+    module_destroy(&module);
+    compiler_destroy(&compiler);
+
+    return best;
+}
+
+/* Modules top out at 256 constants, so a short one gets run over and over */
+static f64 time_refs(struct vm* vm, usize refs) {
+    const char* form = "(vector-ref xs 7)\n";
+    char src[KILOBYTES(2)];
+    struct compiler compiler = {0};
+    struct module module = {0};
+    usize length = strlen(form);
+    usize i;
+    f64 start, elapsed;
+
+    for (i = 0; i < CALLS_PER_MODULE; ++i) memcpy(src + i * length, form, length);
+
+    compile_source(&compiler, &module, (struct slice(char)){src, length * CALLS_PER_MODULE});
+
+    start = monotonic_now();
+    for (i = 0; i < refs / CALLS_PER_MODULE; ++i) vm_run(vm, &module);
+    elapsed = monotonic_now() - start;
+
+    module_destroy(&module);
+    compiler_destroy(&compiler);
+
+    return elapsed / (refs - refs % CALLS_PER_MODULE);
+}
+
+/* Bytes read and written by a form over the time it took */
+static void report(const char* name, f64 seconds, usize bytes) {
+    printf("  %-22s %9.2f ms %8.2f GB/s\n", name, seconds * 1e3, bytes / seconds / 1e9);
+}
+
+i32 main(i32 argc, char** argv) {
+    struct vm vm = {0};
+    usize length = 4000000;
+    usize bytes, i;
+    struct vector* xs;
+    struct vector* ys;
+    struct vector* ns;
+    i32 level;
+
+    if (argc > 1) length = atoi(argv[1]);
+
+    vm_init(&vm);
+    isolate_enter(&vm.isolate);
+
+    xs = vector_create(VECTOR_F64, length);
+    ys = vector_create(VECTOR_F64, length);
+    ns = vector_create(VECTOR_I64, length);
+
+    for (i = 0; i < length; ++i) {
+        xs->reals[i] = (f64)(i % 1000) * 0.25;
+        ys->reals[i] = (f64)(i % 7);
+        ns->integers[i] = (i64)(i % 1000);
+    }
+
+    vm_set_global(&vm, STRING("xs"), expr_create_vector(xs));
+    vm_set_global(&vm, STRING("ys"), expr_create_vector(ys));
+    vm_set_global(&vm, STRING("ns"), expr_create_vector(ns));
+
+    bytes = length * sizeof(f64);
+
+    printf("%lu elements, %.1f MB a vector\n", (unsigned long)length, bytes / 1e6);
+
+    for (level = VECTOR_LEVEL_SCALAR; level <= (i32)vector_best_level(); ++level) {
+        vector_set_level(level);
+        printf("%s\n", level_names[vector_get_level()]);
+
+        report("#vector-sum f64", time_form(&vm, "(#vector-sum xs)"), bytes);
+        report("#vector-sum i64", time_form(&vm, "(#vector-sum ns)"), bytes);
+        report("#vector-dot f64", time_form(&vm, "(#vector-dot xs ys)"), bytes * 2);
+        report("#vector-max f64", time_form(&vm, "(#vector-max xs)"), bytes);
+        report("#vector-max i64", time_form(&vm, "(#vector-max ns)"), bytes);
+        report("#vector-add f64", time_form(&vm, "(#vector-add xs ys)"), bytes * 3);
+        report("#vector-scale f64", time_form(&vm, "(#vector-scale xs 2.0)"), bytes * 2);
+    }
+
+    printf("vector-ref, one element %8.1f ns\n", time_refs(&vm, 1000000) * 1e9);
+
+    isolate_leave(&vm.isolate);
+    vm_destroy(&vm);
+
+    return 0;
+}
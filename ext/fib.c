@@ -0,0 +1,56 @@
+/*
+ * A small native extension, and the one bench/load_native loads.
+ *
+ * Usage: (#load-native bin/ext/libfib.so) then (#fib 30)
+ * */
+
+#include "extension.h"
+
+/* The nth fibonacci number, wrapped around to 64 bits */
+static struct expr native_fib(struct expr args) {
+    u64 a = 0, b = 1, next;
+    i64 n;
+
+    assert(integerp(CAR(args)));
+
+    for (n = CAR(args).integer; n > 0; --n) {
+        next = a + b;
+        a = b;
+        b = next;
+    }
+
+    return expr_create_integer((i64)a);
+}
+
+/* 1 + 2 + ... + n, one addition at a time on purpose */
+static struct expr native_sum_to(struct expr args) {
+    i64 sum = 0;
+    i64 i;
+
+    assert(integerp(CAR(args)));
+
+    for (i = 1; i <= CAR(args).integer; ++i) sum += i;
+
+    return expr_create_integer(sum);
+}
+
+/* Shaped like the builtin #+, so calling the two costs the same but for where they live */
+static struct expr native_times(struct expr args) {
+    assert(integerp(CAR(args)) && integerp(CAR(CDR(args))));
+
+    return expr_create_integer(CAR(args).integer * CAR(CDR(args)).integer);
+}
+
+static const struct hoax_extension_native natives[] = {
+    {"#fib",    1, native_fib},
+    {"#sum-to", 1, native_sum_to},
+    {"#times",  2, native_times},
+};
+
+static const struct hoax_extension table = {
+    HOAX_EXTENSION_ABI, sizeof(natives) / sizeof(natives[0]), natives,
+};
+
+const struct hoax_extension* hoax_native_register_v1(void) {
+    return &table;
+}
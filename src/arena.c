@@ -3,41 +3,108 @@
 
 #include "arena.h"
 
-static inline void arena_init(struct arena* arena, usize capacity) {
-    void* mem = malloc(capacity);
+#define ARENA_HEADER sizeof(void*)
+
+static inline void arena_init(struct arena* arena, usize capacity, void* previous) {
+    void* mem = malloc(ARENA_HEADER + capacity);
     assert(mem);
+    *(void**)mem = previous;
     arena->capacity = capacity;
     arena->mem_start = mem;
-    arena->mem_cursor = mem;
+    arena->mem_cursor = (char*)mem + ARENA_HEADER;
+}
+
+/* Frees every block before the current one */
+static inline void arena_free_previous(struct arena* arena) {
+    void* block = *(void**)arena->mem_start;
+    void* previous;
+
+    while (block) {
+        previous = *(void**)block;
+        free(block);
+        block = previous;
+    }
+
+    *(void**)arena->mem_start = NULL;
 }
 
 struct arena arena_create(usize capacity) {
     struct arena arena = {0};
 
-    arena_init(&arena, capacity);
+    arena_init(&arena, capacity, NULL);
 
     return arena;
 }
 
 void arena_destroy(struct arena* arena) {
-    free(arena->mem_start);
+    if (arena->mem_start) {
+        arena_free_previous(arena);
+        free(arena->mem_start);
+    }
+
     arena->mem_cursor = 0;
     arena->mem_start = 0;
     arena->capacity = 0;
 }
 
+/* other's chain goes right behind the current block, which stays current */
+void arena_adopt(struct arena* arena, struct arena* other) {
+    void* oldest;
+
+    if (other->mem_start == 0) return;
+
+    if (arena->mem_start == 0) {
+        *arena = *other;
+    } else {
+        for (oldest = other->mem_start; *(void**)oldest; oldest = *(void**)oldest);
+
+        *(void**)oldest = *(void**)arena->mem_start;
+        *(void**)arena->mem_start = other->mem_start;
+    }
+
+    *other = (struct arena){0};
+}
+
 void* arena_alloc(struct arena* arena, usize size) {
-    if (arena->mem_start == 0) arena_init(arena, ARENA_DEFAULT_CAP);
+    usize capacity;
+
+    if (arena->mem_start == 0) arena_init(arena, ARENA_DEFAULT_CAP, NULL);
+
+    if (size > arena->capacity - arena_used(arena)) {
+        capacity = arena->capacity * 2;
+        while (capacity < size) capacity *= 2;
 
-    assert(size <= arena->capacity - arena_used(arena));
+        arena_init(arena, capacity, arena->mem_start);
+    }
 
     return (arena->mem_cursor += size) - size;
 }
 
+/* Keeps the current block, which is the biggest one */
 void arena_clear(struct arena* arena) {
-    arena->mem_cursor = arena->mem_start;
+    if (arena->mem_start == 0) return;
+
+    arena_free_previous(arena);
+    arena->mem_cursor = (char*)arena->mem_start + ARENA_HEADER;
+}
+
+struct arena_mark arena_get_mark(const struct arena* arena) {
+    return (struct arena_mark){arena->mem_start, arena->mem_cursor, arena->capacity};
+}
+
+void arena_rewind(struct arena* arena, struct arena_mark mark) {
+    void* previous;
+
+    while (arena->mem_start && arena->mem_start != mark.block) {
+        previous = *(void**)arena->mem_start;
+        free(arena->mem_start);
+        arena->mem_start = previous;
+    }
+
+    arena->mem_cursor = mark.cursor;
+    arena->capacity = mark.capacity;
 }
 
 usize arena_used(const struct arena* arena) {
-    return arena->mem_cursor - arena->mem_start;
+    return arena->mem_cursor - (void*)((char*)arena->mem_start + ARENA_HEADER);
 }
@@ -5,10 +5,15 @@
 
 #define ARENA_DEFAULT_CAP (KILOBYTES(4))
 
+/* 
+ * A bump allocator over a chain of blocks. When the current block fills up a
+ * bigger one is started, so nothing handed out ever moves. Every block starts
+ * with a pointer to the block before it.
+ * */
 struct arena {
     void* mem_start;
     void* mem_cursor;
-    usize capacity; /**/
+    usize capacity; /* of the current block, not counting its header */
 };
 
 struct arena arena_create(usize capacity);
@@ -16,7 +21,30 @@ struct arena arena_create(usize capacity);
 void arena_destroy(struct arena* arena);
 void arena_clear(struct arena* arena);
 
+/*
+ * Moves every block of other into arena, so what was allocated from other
+ * lives as long as arena does. other is left empty. Used to hand the strings
+ * a thread decoded over along with the heap it read them into.
+ * */
+void arena_adopt(struct arena* arena, struct arena* other);
+
 void* arena_alloc(struct arena* arena, usize size);
 usize arena_used(const struct arena* arena);
 
+/* How far an arena had got, for throwing away everything allocated since */
+struct arena_mark {
+    void* block;
+    void* cursor;
+    usize capacity;
+};
+
+struct arena_mark arena_get_mark(const struct arena* arena);
+
+/*
+ * Frees every block started after the mark was taken and goes back to where
+ * it was in the block it was taken in. Blocks adopted since are kept if they
+ * went behind that block.
+ * */
+void arena_rewind(struct arena* arena, struct arena_mark mark);
+
 #endif  /*__ARENA_H*/
@@ -0,0 +1,308 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "batch.h"
+#include "compiler.h"
+#include "run.h"
+#include "source.h"
+#include "vm.h"
+
+#define BATCH_PATH_CAP 4096
+/* A job's output file, the dir plus a slash and a u32 */
+#define BATCH_JOB_PATH_CAP (BATCH_PATH_CAP + 16)
+
+/* Sent up the pipe by a worker for every finished job, well under PIPE_BUF */
+struct batch_result {
+    u32 job;
+    i32 status;
+    f64 elapsed;
+};
+
+struct batch {
+    struct batch_options* options;
+    char dir[BATCH_PATH_CAP]; /* where the output of every job is captured, empty until made */
+    usize* next_job; /* shared with every worker */
+    i32 results[2];  /* the pipe workers report finished jobs through */
+};
+
+static void output_path(struct batch* batch, u32 job, char* path, usize size) {
+    snprintf(path, size, "%s/%u", batch->dir, job);
+}
+
+/* Runs in a fork of the worker made just for this job, so it never returns */
+static void run_job(struct batch* batch, struct vm* vm, u32 job) {
+    struct source source;
+    char path[BATCH_JOB_PATH_CAP];
+    i32 fd;
+    u8 ret;
+
+    output_path(batch, job, path, sizeof(path));
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) _exit(1);
+
+    dup2(fd, STDOUT_FILENO);
+    dup2(fd, STDERR_FILENO);
+    close(fd);
+
+    if (!source_open(&source, batch->options->paths[job])) _exit(1);
+
+    ret = run_source(vm, source.text, 1, RUN_WHOLE);
+
+    fflush(stdout);
+    _exit(ret == COMPILE_OK ? 0 : 1);
+}
+
+static void worker(struct batch* batch, struct vm* vm) {
+    struct batch_result result;
+    pid_t pid;
+    i32 status;
+    usize job;
+    f64 start;
+
+    close(batch->results[0]);
+
+    while ((job = __atomic_fetch_add(batch->next_job, 1, __ATOMIC_RELAXED)) < batch->options->count) {
+        start = monotonic_now();
+
+        pid = fork();
+        if (pid == 0) run_job(batch, vm, job);
+
+        result.job = job;
+        result.status = 1;
+
+        if (pid > 0) {
+            while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+
+            if (WIFEXITED(status)) result.status = WEXITSTATUS(status);
+            else if (WIFSIGNALED(status)) result.status = 128 + WTERMSIG(status);
+        }
+
+        result.elapsed = monotonic_now() - start;
+
+        if (write(batch->results[1], &result, sizeof(result)) != sizeof(result)) break;
+    }
+
+    _exit(0);
+}
+
+static void print_job(struct batch* batch, u32 job) {
+    char path[BATCH_JOB_PATH_CAP];
+    char buffer[KILOBYTES(16)];
+    isize n;
+    i32 fd;
+
+    output_path(batch, job, path, sizeof(path));
+
+    printf("==> %s <==\n", batch->options->paths[job]);
+
+    fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+            fwrite(buffer, 1, n, stdout);
+        }
+
+        close(fd);
+        unlink(path);
+    }
+
+    fflush(stdout);
+}
+
+/* Whatever a job that never reported got to write, so the dir can go */
+static void drop_output(struct batch* batch, u32 job) {
+    char path[BATCH_JOB_PATH_CAP];
+
+    output_path(batch, job, path, sizeof(path));
+    unlink(path);
+}
+
+static void print_summary(struct batch* batch, i32* statuses, f64* elapsed, usize workers, f64 wall) {
+    usize count = batch->options->count;
+    usize failed = 0;
+    f64 total = 0, slowest = 0;
+    usize i;
+
+    for (i = 0; i < count; ++i) {
+        if (statuses[i] != 0) failed += 1;
+        total += elapsed[i];
+        if (elapsed[i] > slowest) slowest = elapsed[i];
+    }
+
+    fprintf(stderr, "\n%lu jobs on %lu workers in %.3f ms, %lu ok, %lu failed\n",
+            (unsigned long)count, (unsigned long)workers, wall * 1e3,
+            (unsigned long)(count - failed), (unsigned long)failed);
+    fprintf(stderr, "mean %.3f ms, slowest %.3f ms\n",
+            count ? total / count * 1e3 : 0.0, slowest * 1e3);
+    fprintf(stderr, "%8s %12s  %s\n", "status", "ms", "script");
+
+    for (i = 0; i < count; ++i) {
+        fprintf(stderr, "%8d %12.3f  %s\n", statuses[i], elapsed[i] * 1e3, batch->options->paths[i]);
+    }
+}
+
+/* Where job output goes, under $TMPDIR like mkstemp and friends would put it */
+static bool make_dir(struct batch* batch) {
+    const char* tmp = getenv("TMPDIR");
+    i32 length;
+
+    if (!tmp || tmp[0] == '\0') tmp = "/tmp";
+
+    length = snprintf(batch->dir, sizeof(batch->dir), "%s/hoax-batch-XXXXXX", tmp);
+    if (length < 0 || (usize)length >= sizeof(batch->dir) || !mkdtemp(batch->dir)) {
+        batch->dir[0] = '\0';
+        return false;
+    }
+
+    return true;
+}
+
+i32 batch_run(struct batch_options* options) {
+    struct batch batch = {0};
+    struct batch_result result;
+    struct source prelude = {0};
+    struct vm vm = {0};
+    pid_t* workers = NULL;
+    i32* statuses = NULL;
+    f64* elapsed = NULL;
+    bool* done = NULL;
+    usize started = 0, next_print = 0;
+    i32 ret = 1;
+    f64 start;
+    usize i;
+
+    batch.options = options;
+    batch.results[0] = batch.results[1] = -1;
+    batch.next_job = MAP_FAILED;
+
+    vm_init(&vm);
+    isolate_enter(&vm.isolate);
+
+    if (options->prelude) {
+        if (!source_open(&prelude, options->prelude)) goto cleanup;
+
+        if (run_source(&vm, prelude.text, 0, RUN_WHOLE) != COMPILE_OK) {
+            fprintf(stderr, "[batch] error: the prelude %s failed to run\n", options->prelude);
+            goto cleanup;
+        }
+    }
+
+    /* anything still buffered would be printed again by every fork */
+    fflush(stdout);
+
+    if (!make_dir(&batch) || pipe(batch.results) < 0) {
+        fprintf(stderr, "[batch] error: failed to set up the job output\n");
+        goto cleanup;
+    }
+
+    batch.next_job = mmap(NULL, sizeof(usize), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    assert(batch.next_job != MAP_FAILED);
+    *batch.next_job = 0;
+
+    workers = malloc(sizeof(pid_t) * options->jobs);
+    statuses = malloc(sizeof(i32) * options->count);
+    elapsed = calloc(options->count, sizeof(f64));
+    done = calloc(options->count, sizeof(bool));
+    assert(workers && statuses && elapsed && done);
+
+    /* jobs nobody reported on count as failed */
+    for (i = 0; i < options->count; ++i) statuses[i] = 1;
+
+    start = monotonic_now();
+
+    for (i = 0; i < options->jobs && i < options->count; ++i) {
+        workers[started] = fork();
+        if (workers[started] == 0) worker(&batch, &vm);
+        if (workers[started] < 0) break;
+        started += 1;
+    }
+
+    close(batch.results[1]);
+    batch.results[1] = -1;
+
+    if (started == 0 && options->count > 0) {
+        fprintf(stderr, "[batch] error: failed to start any workers\n");
+    }
+
+    while (read(batch.results[0], &result, sizeof(result)) == sizeof(result)) {
+        statuses[result.job] = result.status;
+        elapsed[result.job] = result.elapsed;
+        done[result.job] = true;
+
+        if (!options->ordered) {
+            print_job(&batch, result.job);
+            continue;
+        }
+
+        while (next_print < options->count && done[next_print]) {
+            print_job(&batch, next_print++);
+        }
+    }
+
+    for (i = 0; i < started; ++i) {
+        while (waitpid(workers[i], NULL, 0) < 0 && errno == EINTR);
+    }
+
+    /* a job nobody reported on, from a worker that got killed, holds up the ones after it */
+    for (i = 0; i < options->count; ++i) {
+        if (done[i] && options->ordered && i >= next_print) print_job(&batch, i);
+        else if (!done[i]) drop_output(&batch, i);
+    }
+
+    print_summary(&batch, statuses, elapsed, started, monotonic_now() - start);
+
+    ret = 0;
+    for (i = 0; i < options->count; ++i) {
+        if (statuses[i] != 0) ret = 1;
+    }
+
+cleanup:
+    if (batch.results[0] >= 0) close(batch.results[0]);
+    if (batch.results[1] >= 0) close(batch.results[1]);
+    if (batch.dir[0] != '\0') rmdir(batch.dir);
+    if (batch.next_job != MAP_FAILED) munmap(batch.next_job, sizeof(usize));
+    free(workers);
+    free(statuses);
+    free(elapsed);
+    free(done);
+
+    isolate_leave(&vm.isolate);
+    vm_destroy(&vm);
+    source_close(&prelude);
+
+    return ret;
+}
+
+char** batch_read_paths(FILE* stream, usize* count) {
+    char line[BATCH_PATH_CAP];
+    char** paths = NULL;
+    usize capacity = 0;
+    usize length;
+
+    *count = 0;
+
+    while (fgets(line, sizeof(line), stream)) {
+        length = strcspn(line, "\r\n");
+        if (length == 0) continue;
+
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            paths = realloc(paths, sizeof(char*) * capacity);
+            assert(paths);
+        }
+
+        paths[*count] = malloc(length + 1);
+        assert(paths[*count]);
+        memcpy(paths[*count], line, length);
+        paths[*count][length] = '\0';
+        *count += 1;
+    }
+
+    return paths;
+}
@@ -0,0 +1,32 @@
+#ifndef __BATCH_H
+#define __BATCH_H
+
+#include "common.h"
+
+struct batch_options {
+    char** paths;   /* the scripts to run, one job each */
+    usize count;
+    char* prelude;  /* run once before forking, NULL for none */
+    usize jobs;     /* how many worker processes run scripts at once */
+    bool ordered;   /* print output in the order of paths instead of as jobs finish */
+};
+
+/*
+ * Runs a batch of scripts from one warm process.
+ *
+ * The prelude is run once in this process, then the workers are forked and
+ * inherit its heap and globals copy-on-write. Workers take the next job off a
+ * counter in shared memory and run each script in a fork of their own, so
+ * every script starts from the state the prelude left behind, and a crash only
+ * takes down its own job.
+ *
+ * Each job's stdout and stderr are captured and printed under a header either
+ * as the job finishes or in order, followed by a summary of every job's exit
+ * status and time on stderr. Returns 0 if every job succeeded, 1 otherwise.
+ * */
+i32 batch_run(struct batch_options* options);
+
+/* Reads one path per line, for when the paths come from stdin */
+char** batch_read_paths(FILE* stream, usize* count);
+
+#endif  /*__BATCH_H*/
@@ -0,0 +1,68 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+
+#include "builder.h"
+
+#define BUILDER_MIN_CAPACITY 64
+
+static void builder_free(struct owned* owned) {
+    struct builder* builder = (struct builder*)owned;
+
+    free(builder->bytes);
+    free(builder);
+}
+
+struct builder* builder_create(void) {
+    struct builder* builder = calloc(1, sizeof(struct builder));
+
+    assert(builder);
+
+    owned_register(&builder->owned, builder_free);
+
+    return builder;
+}
+
+void builder_append(struct builder* builder, const char* bytes, usize length) {
+    usize capacity = builder->capacity ? builder->capacity : BUILDER_MIN_CAPACITY;
+
+    if (builder->length + length > builder->capacity) {
+        while (capacity < builder->length + length) capacity *= 2;
+
+        builder->bytes = realloc(builder->bytes, capacity);
+        assert(builder->bytes);
+        builder->capacity = capacity;
+    }
+
+    memcpy(builder->bytes + builder->length, bytes, length);
+    builder->length += length;
+}
+
+bool builder_append_expr(struct builder* builder, struct expr expr) {
+    char text[EXPR_FLOAT_TEXT_MAX];
+    struct slice(char) string;
+
+    switch (expr.type) {
+        case EXPR_STRING:
+            string = expr_string(&expr);
+            builder_append(builder, string.ptr, string.length);
+            return true;
+        case EXPR_SYMBOL:
+            builder_append(builder, expr.symbol, expr.length);
+            return true;
+        case EXPR_INTEGER:
+            builder_append(builder, text, snprintf(text, sizeof(text), "%ld", expr.integer));
+            return true;
+        case EXPR_FLOAT:
+            builder_append(builder, text, expr_format_float(text, sizeof(text), expr.real));
+            return true;
+        default:
+            return false;
+    }
+}
+
+struct expr builder_string(const struct builder* builder) {
+    assert(builder->length <= UINT32_MAX && "builder: string too long");
+
+    return expr_create_string(builder->bytes, builder->length);
+}
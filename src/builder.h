@@ -0,0 +1,45 @@
+#ifndef __BUILDER_H
+#define __BUILDER_H
+
+#include "common.h"
+#include "expr.h"
+
+/*
+ * Growable buffers for putting a string together a piece at a time.
+ *
+ *     (defvar out (#builder))
+ *     (#builder-append! out "count: ")
+ *     (#builder-append! out 42)
+ *     (#builder->string out)
+ *
+ * Strings are immutable, so appending two of them copies both, and doing it
+ * in a loop copies everything built so far every time around. A builder
+ * doubles its buffer instead, so n appends cost O(n) bytes copied in total,
+ * and the string only gets made once at the end.
+ *
+ * Like tables, a builder is shared by reference between the heaps its expr
+ * gets copied into and is only freed when the process exits. Nothing locks it,
+ * so only one thread should append to it at a time.
+ * */
+
+struct builder {
+    struct owned owned; /* builders live until exit */
+    char* bytes;
+    usize length;
+    usize capacity;
+};
+
+struct builder* builder_create(void);
+
+void builder_append(struct builder* builder, const char* bytes, usize length);
+
+/*
+ * Appends the text of a string or symbol, or an integer or float written out
+ * the way it's printed. Returns false for anything else.
+ * */
+bool builder_append_expr(struct builder* builder, struct expr expr);
+
+/* A copy of what's been built so far, the builder can keep going after */
+struct expr builder_string(const struct builder* builder);
+
+#endif  /*__BUILDER_H*/
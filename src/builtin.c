@@ -0,0 +1,64 @@
+#include "builtin.h"
+#include "compiler.h"
+#include "module.h"
+#include "native.h"
+
+/* Generated from builtin.def by tools/gen_builtins.c */
+#include "builtin_table.h"
+
+#define BUILTIN_NAME(name) {(name), sizeof(name) - 1}
+
+#define BUILTIN_LITERAL(name, op, sig) \
+    {BUILTIN_NAME(name), BUILTIN_KIND_LITERAL, 0, (op), NULL, NULL, (sig)},
+#define BUILTIN_FUNCTION(name, arity, op, sig) \
+    {BUILTIN_NAME(name), BUILTIN_KIND_FUNCTION, (arity), (op), NULL, NULL, (sig)},
+#define BUILTIN_SPECIAL_FORM(name, fn) \
+    {BUILTIN_NAME(name), BUILTIN_KIND_SPECIAL_FORM, 0, 0, (fn), NULL, NULL},
+#define BUILTIN_NATIVE(name, arity, fn, sig, op) \
+    {BUILTIN_NAME(name), BUILTIN_KIND_NATIVE, (arity), (op), NULL, (fn), (sig)},
+
+const struct builtin builtins[] = {
+#include "builtin.def"
+};
+
+const usize builtins_length = ARRAY_LENGTH(builtins);
+
+const struct builtin* builtin_lookup(struct slice(char) name) {
+    u8 index;
+
+    index = builtin_slots[builtin_hash(name.ptr, name.length, BUILTIN_TABLE_SEED) & BUILTIN_TABLE_MASK];
+
+    /* slot indices are stored off by one so that zero can mean empty */
+    if (index == 0) return NULL;
+    if (!string_equal(builtins[index - 1].name, name)) return NULL;
+
+    return &builtins[index - 1];
+}
+
+type_set builtin_param_type(const struct builtin* builtin, u8 n) {
+    assert(builtin->signature && n < builtin->arity);
+
+    return builtin_type_code(builtin->signature[n]);
+}
+
+type_set builtin_return_type(const struct builtin* builtin) {
+    const char* code;
+    type_set type = 0;
+
+    if (!builtin->signature) return TYPE_ANY;
+
+    /* validated by the generator, there is always a colon */
+    for (code = strchr(builtin->signature, ':') + 1; *code != '\0'; ++code) {
+        type |= builtin_type_code(*code);
+    }
+
+    return type;
+}
+
+struct expr builtin_create_native(u32 index) {
+    struct expr native = expr_create_native(builtins[index].native, builtins[index].arity);
+
+    native.builtin = index + 1;
+
+    return native;
+}
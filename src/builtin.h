@@ -3,27 +3,138 @@
 
 #include "generics.h"
 #include "common.h"
+#include "native.h"
+#include "expr.h"
 
-/* @TODO: See about implementing compile-time type checking for builtin-functions */
+struct compiler;
 
-/* 
- * @TODO: See about updating these here. They just feel very hacked together
- * and rushed
+/*
+ * Every type an expression might evaluate to, one bit per expr_type. This is
+ * what the compiler infers for each expression it compiles and what the
+ * signatures of the builtins are checked against.
+ * */
+typedef u32 type_set;
+
+#define TYPE_OF(expr_type) ((type_set)1 << (expr_type))
+#define TYPE_ANY ((type_set)0xffffffffu)
+
+typedef u8 (*special_form_fn)(struct compiler* compiler, struct expr expr);
+
+enum builtin_kind {
+    BUILTIN_KIND_LITERAL,
+    BUILTIN_KIND_FUNCTION,
+    BUILTIN_KIND_SPECIAL_FORM,
+    BUILTIN_KIND_NATIVE,
+};
+
+/*
+ * One entry of the table in builtin.def. Only the fields that make sense for
+ * the kind of the entry are filled in, the rest are left zeroed.
  * */
-struct builtin_function_info {
+struct builtin {
+    struct slice(char) name;
+    u8 kind;
     u8 arity;
     u8 op_code;
+    special_form_fn compile;
+    native_fn native;
+    /*
+     * One code per argument, then a colon, then the codes of everything it can
+     * return, see builtin_type_code. Special forms have none.
+     * */
+    const char* signature;
 };
 
-SMAP_DECL_S(builtin_function_info);
+extern const struct builtin builtins[];
+extern const usize builtins_length;
 
-struct builtin_function {
-    struct slice(char) name;
-    struct builtin_function_info info;
-};
+/*
+ * Looks up a name in the perfect hash table generated from builtin.def at
+ * build time. Returns NULL if the name is not a builtin of any kind.
+ * */
+const struct builtin* builtin_lookup(struct slice(char) name);
+
+/*
+ * The codes signatures are written with:
+ *      n nil, b boolean, i integer, c cons, s symbol, f native, h channel,
+ *      x extern, r float, v vector, t table, q string, w builder, l list
+ *      (a cons or nil), * anything
+ * Returns 0 for anything else.
+ * */
+static inline type_set builtin_type_code(char code) {
+    switch (code) {
+        case 'n': return TYPE_OF(EXPR_NIL);
+        case 'b': return TYPE_OF(EXPR_BOOLEAN);
+        case 'i': return TYPE_OF(EXPR_INTEGER);
+        case 'c': return TYPE_OF(EXPR_CONS);
+        case 's': return TYPE_OF(EXPR_SYMBOL);
+        case 'f': return TYPE_OF(EXPR_NATIVE);
+        case 'h': return TYPE_OF(EXPR_CHANNEL);
+        case 'x': return TYPE_OF(EXPR_EXTERN);
+        case 'r': return TYPE_OF(EXPR_FLOAT);
+        case 'v': return TYPE_OF(EXPR_VECTOR);
+        case 't': return TYPE_OF(EXPR_TABLE);
+        case 'q': return TYPE_OF(EXPR_STRING);
+        case 'w': return TYPE_OF(EXPR_BUILDER);
+        case 'l': return TYPE_OF(EXPR_CONS) | TYPE_OF(EXPR_NIL);
+        case '*': return TYPE_ANY;
+    }
+
+    return 0;
+}
+
+/* What the nth argument of a builtin function or native has to be */
+type_set builtin_param_type(const struct builtin* builtin, u8 n);
+
+/* Everything a builtin can evaluate to, TYPE_ANY for special forms */
+type_set builtin_return_type(const struct builtin* builtin);
+
+/* The native expr of builtins[index], which carries the index along so its signature is one lookup away */
+struct expr builtin_create_native(u32 index);
+
+/*
+ * Finds the native of the table a native expr was bound from, so its
+ * signature can be checked wherever it gets called. Returns NULL for natives
+ * that aren't builtins, which check their own arguments.
+ * */
+static inline const struct builtin* builtin_find_native(struct expr native) {
+    return native.builtin ? &builtins[native.builtin - 1] : NULL;
+}
+
+/* Whether a native can be called with the argument at position n */
+static inline bool builtin_accepts(const struct builtin* builtin, u8 n, struct expr arg) {
+    return (builtin_param_type(builtin, n) & TYPE_OF(arg.type)) != 0;
+}
 
 /*
- * The builtin functions/symbols 
+ * builtin_accepts for any native, for code that calls one with values the
+ * compiler never saw. The natives of builtin.def leave checking to the caller,
+ * other natives check their own arguments and accept anything here.
+ * */
+static inline bool builtin_check_arg(struct expr native, u8 n, struct expr arg) {
+    const struct builtin* builtin = builtin_find_native(native);
+
+    return !builtin || builtin_accepts(builtin, n, arg);
+}
+
+/*
+ * The hash the generated table was built with. It lives here so the generator
+ * and the lookup cannot disagree on it.
+ * */
+static inline u32 builtin_hash(const char* key, usize length, u32 seed) {
+    u32 hash = 2166136261u ^ seed;
+    usize i;
+
+    for (i = 0; i < length; ++i) {
+        hash ^= (u8)key[i];
+        hash *= 16777619u;
+    }
+
+    return hash ^ (hash >> 15);
+}
+
+/*
+ * The builtin functions/symbols
  *
  * Literals:
  *      t => OP_TRUE
@@ -34,7 +145,7 @@ struct builtin_function {
  *        - Pushes the value nil onto the stack
  * Maths:
  *      + => OP_ADD
- *        - Takes two elements off the stack and adds them together if they are 
+ *        - Takes two elements off the stack and adds them together if they are
  *          both numbers
  *      - => OP_SUB
  *        - Takes two elements off the stack and subtracts them if they are both
@@ -57,13 +168,67 @@ struct builtin_function {
  *        - If the element on the top of the stack is of type cons, put the CDR
  *          of cons cell on the stack without touching the cons cell internally
  *
+ * Vectors (see vector.h):
+ *      make-vector => OP_MAKE_VECTOR
+ *        - (make-vector length value) makes a vector of length copies of
+ *          value, of integers or floats depending on what value is
+ *      vector-ref => OP_VECTOR_REF
+ *        - (vector-ref vector index) pushes the element at index
+ *      vector-set! => OP_VECTOR_SET
+ *        - (vector-set! vector index value) stores value at index and pushes it
+ *      vector-length => OP_VECTOR_LENGTH
+ *        - Pushes how many elements a vector has
+ *
+ * Tables (see table.h):
+ *      make-table => OP_MAKE_TABLE
+ *        - Pushes a new empty table
+ *      table-get => OP_TABLE_GET
+ *        - (table-get table key) pushes the value stored under key, or nil
+ *      table-put! => OP_TABLE_PUT
+ *        - (table-put! table key value) stores value under key and pushes it
+ *      table-del! => OP_TABLE_DEL
+ *        - (table-del! table key) removes key and pushes whether it was there
+ *      table-count => OP_TABLE_COUNT
+ *        - Pushes how many keys a table has
+ *
  * VM Related Functionality:
  *      toggle-debug => OP_TOGGLE_DEBUG
  *        - Toggles the module bytecode disassembly after compilation
+ *      #reload => OP_RELOAD
+ *        - (#reload path/to/file.hoax) runs the forms of the file that changed
+ *          since it was last reloaded and pushes how many ran
+ *      #load-native => OP_LOAD_NATIVE
+ *        - (#load-native path/to/libfoo.so) binds the natives of a shared
+ *          object as globals and pushes how many there were, see extension.h
+ *      defextern
+ *        - (defextern strlen (ptr) long) binds a C function of the process
+ *          as a global that is called like any other, see extern.h
  *      display => OP_DISPLAY
  *        - Pops the element on the top of the stack and prints it to stdout
  *      quit => OP_HALT
  *        - Quits the execution of the VM. More useful in the REPL
+ *
+ * Special Forms:
+ *      if, defvar, #reload, quote, #load-native, defextern
+ *
+ * Natives (bound as globals when the VM starts):
+ *      #display, #hello, #+, #chan, #send, #recv, #pmap, #read-file, #sleep,
+ *      #vector-sum, #vector-dot, #vector-scale, #vector-add, #vector-mul,
+ *      #vector-min, #vector-max, #string-length, #substring, #string-append,
+ *      #string=?, #string->symbol, #symbol->string, #builder,
+ *      #builder-append!, #builder->string, #length, #append, #reverse, #nth,
+ *      #last, #list->vector, #filter, #sort
+ *
+ * Type Checks:
+ *      The compiler infers the types every expression might have, and where
+ *      the arguments of a call are proven to fit the signature in builtin.def
+ *      the call skips the runtime checks:
+ *        - +, -, * compile to OP_ADD_UNCHECKED, OP_SUB_UNCHECKED, OP_MUL_UNCHECKED
+ *        - car, cdr compile to OP_CAR_UNCHECKED, OP_CDR_UNCHECKED
+ *        - natives are called with OP_CALL_UNCHECKED, which still checks the
+ *          global is the native the signature belongs to
+ *      Everything else is checked when it runs, calls to natives against their
+ *      signature by vm_function_call. --stats reports the count per module.
  * */
 
 #endif  /*__BUILTIN_H*/
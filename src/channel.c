@@ -0,0 +1,125 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+
+#include "channel.h"
+
+static void channel_free(struct owned* owned) {
+    struct channel* channel = (struct channel*)owned;
+    usize i;
+
+    /* whatever nobody received */
+    for (i = channel->head; i != channel->tail; ++i) {
+        free(channel->slots[i & channel->mask].packed);
+    }
+
+    sem_destroy(&channel->spaces);
+    sem_destroy(&channel->items);
+    free(channel->slots);
+    free(channel);
+}
+
+static void wait_for(sem_t* sem) {
+    while (sem_wait(sem) < 0 && errno == EINTR);
+}
+
+struct channel* channel_create(usize capacity) {
+    struct channel* channel = calloc(1, sizeof(struct channel));
+    usize size = 1;
+    usize i;
+
+    assert(channel);
+
+    assert(capacity <= CHANNEL_CAPACITY_MAX && CHANNEL_CAPACITY_MAX <= SEM_VALUE_MAX);
+
+    while (size < capacity) size <<= 1;
+
+    channel->slots = malloc(sizeof(struct channel_slot) * size);
+    assert(channel->slots);
+    channel->mask = size - 1;
+
+    /* slot i is free for the send at position i */
+    for (i = 0; i < size; ++i) {
+        channel->slots[i] = (struct channel_slot){ .sequence = i };
+    }
+
+    if (sem_init(&channel->spaces, 0, size) != 0 || sem_init(&channel->items, 0, 0) != 0) {
+        assert(0 && "Failed to make the channel's semaphores");
+    }
+
+    owned_register(&channel->owned, channel_free);
+
+    return channel;
+}
+
+/*
+ * Claims the slot at end for whoever is waiting on sequence position + offset.
+ * The semaphores already promised there's a slot, but a sender can get to it
+ * before the receiver that freed it up last time around is done with it, so
+ * that one case backs off.
+ * */
+static struct channel_slot* claim(struct channel* channel, usize* end, usize offset) {
+    struct channel_slot* slot;
+    usize position = __atomic_load_n(end, __ATOMIC_RELAXED);
+    isize diff;
+
+    for (;;) {
+        slot = &channel->slots[position & channel->mask];
+        diff = (isize)__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - (isize)(position + offset);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(end, &position, position + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                return slot;
+        } else {
+            if (diff < 0) sched_yield();
+            position = __atomic_load_n(end, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+void channel_send(struct channel* channel, struct expr value) {
+    struct packed_expr* packed = NULL;
+    struct channel_slot* slot;
+    usize sequence;
+
+    if (expr_needs_pack(value)) packed = expr_pack(value);
+
+    wait_for(&channel->spaces);
+
+    slot = claim(channel, &channel->tail, 0);
+    sequence = slot->sequence;
+    slot->value = value;
+    slot->packed = packed;
+    __atomic_store_n(&slot->sequence, sequence + 1, __ATOMIC_RELEASE);
+
+    sem_post(&channel->items);
+}
+
+struct expr channel_recv(struct channel* channel) {
+    struct packed_expr* packed;
+    struct channel_slot* slot;
+    struct expr value;
+    usize sequence;
+
+    wait_for(&channel->items);
+
+    slot = claim(channel, &channel->head, 1);
+    sequence = slot->sequence;
+    value = slot->value;
+    packed = slot->packed;
+
+    /* the slot is free for the send one lap later */
+    __atomic_store_n(&slot->sequence, sequence + channel->mask, __ATOMIC_RELEASE);
+
+    sem_post(&channel->spaces);
+
+    if (!packed) return value;
+
+    value = expr_unpack(packed);
+    free(packed);
+
+    return value;
+}
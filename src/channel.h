@@ -0,0 +1,61 @@
+#ifndef __CHANNEL_H
+#define __CHANNEL_H
+
+#include <semaphore.h>
+
+#include "common.h"
+#include "expr.h"
+#include "pack.h"
+
+/* How big a cache line is assumed to be, to keep the two ends of a channel apart */
+#define CHANNEL_CACHE_LINE 64
+
+/* The semaphores count free slots, so capacities stay well under Linux's SEM_VALUE_MAX */
+#define CHANNEL_CAPACITY_MAX (1ul << 30)
+
+struct channel_slot {
+    usize sequence;
+    struct expr value;          /* anything that doesn't point anywhere goes as is */
+    struct packed_expr* packed; /* and the rest gets packed */
+};
+
+/*
+ * A bounded queue of values between vms on any number of threads.
+ *
+ * The ring is a multi producer, multi consumer queue where every slot carries
+ * a sequence number saying whose turn it is, so senders and receivers claim
+ * slots with a single compare and swap and never take a lock. Two semaphores
+ * count the free and the filled slots, so a sender blocks while the channel is
+ * full and a receiver while it's empty, without spinning.
+ *
+ * Values are packed on send and unpacked into the receiver's heap, so nothing
+ * in one heap ever points into another.
+ * */
+struct channel {
+    struct owned owned; /* channels live until exit */
+    struct channel_slot* slots;
+    usize mask;
+    sem_t spaces; /* free slots */
+    sem_t items;  /* filled slots */
+
+    char head_pad[CHANNEL_CACHE_LINE];
+    usize head; /* where the next receive reads */
+    char tail_pad[CHANNEL_CACHE_LINE];
+    usize tail; /* where the next send writes */
+    char end_pad[CHANNEL_CACHE_LINE];
+};
+
+/*
+ * Capacity gets rounded up to a power of two. A channel can be reached from
+ * any number of heaps and nothing tracks which, so channels are only freed
+ * when the process exits.
+ * */
+struct channel* channel_create(usize capacity);
+
+/* Copies value out of the current heap, blocking while the channel is full */
+void channel_send(struct channel* channel, struct expr value);
+
+/* Blocks until there's a value and copies it into the current heap */
+struct expr channel_recv(struct channel* channel);
+
+#endif  /*__CHANNEL_H*/
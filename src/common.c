@@ -0,0 +1,38 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <time.h>
+
+#include "common.h"
+
+static struct owned* owned_list;
+static pthread_once_t cleanup_once = PTHREAD_ONCE_INIT;
+
+static void owned_free_all(void) {
+    struct owned* owned;
+
+    while ((owned = owned_list)) {
+        owned_list = owned->next;
+        owned->free_fn(owned);
+    }
+}
+
+static void register_cleanup(void) {
+    atexit(owned_free_all);
+}
+
+void owned_register(struct owned* owned, void (*free_fn)(struct owned* owned)) {
+    owned->free_fn = free_fn;
+
+    pthread_once(&cleanup_once, register_cleanup);
+
+    owned->next = __atomic_load_n(&owned_list, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&owned_list, &owned->next, owned, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+f64 monotonic_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (f64)ts.tv_sec + (f64)ts.tv_nsec / 1e9;
+}
@@ -14,19 +14,31 @@
 #define UNIMPLEMENTED() assert(0 && "Unimplemented");
 
 /* 
- * @TODO: See about encoding a file location in a 32 bit integer with the
- * first 8 bits being the column and the last 24 being the line.
- *
- * Realistically, your source code should not be exceeding 256 columns, that's
- * just bad practice at that point.  With the current scheme you can have a max
- * of 65k lines in a single file, which is pretty good and very unlikely to be
- * surpassed any time soon.
+ * A line and column, both starting at 1. Exprs only carry a byte offset into
+ * their source, these get worked out from it with a line_index when an error
+ * actually needs to be reported.
  * */
 struct file_location {
-    u16 line;
-    u16 column;
+    u32 line;
+    u32 column;
 };
 
+/* Seconds on a clock that never jumps, for timing things and deadlines */
+f64 monotonic_now(void);
+
+/*
+ * For objects any number of heaps can reach without anything tracking which,
+ * so they can't be freed before the process exits. The header goes first in
+ * the object, and free_fn gets it back at exit to free the whole thing.
+ * */
+struct owned {
+    struct owned* next;
+    void (*free_fn)(struct owned* owned);
+};
+
+/* Keeps owned until exit, from any thread */
+void owned_register(struct owned* owned, void (*free_fn)(struct owned* owned));
+
 #define KILOBYTES(n) (n * 1024)
 #define MEGABYTES(n) (KILOBYTES(n) * 1024)
 #define GIGABYTES(n) (MEGABYTES(n) * 1024)
@@ -3,57 +3,34 @@
 #include "builtin.h"
 #include "reader.h"
 #include "compiler.h"
+#include "extern.h"
 #include "generics.h"
 
-SMAP_IMPL_S(builtin_function_info);
+DYNARRAY_IMPL_S(compile_global);
 
-void compiler_init(struct compiler* compiler, struct slice(char) src, struct module* module) {
-    compiler->reader = reader_create(src);
+void compiler_init(struct compiler* compiler, struct reader reader, struct module* module) {
+    compiler->reader = reader;
     compiler->module = module;
-
-    smap__builtin_function_info_put(&compiler->builtins, STRING("+"),
-                                    (struct builtin_function_info){2, OP_ADD});
-
-    smap__builtin_function_info_put(&compiler->builtins, STRING("-"),
-                                    (struct builtin_function_info){2, OP_SUB});
-    
-    smap__builtin_function_info_put(&compiler->builtins, STRING("*"),
-                                    (struct builtin_function_info){2, OP_MUL});
-
-    smap__builtin_function_info_put(&compiler->builtins, STRING("/"),
-                                    (struct builtin_function_info){2, OP_DIV});
-
-    smap__builtin_function_info_put(&compiler->builtins, STRING("car"),
-                                    (struct builtin_function_info){1, OP_CAR});
-
-    smap__builtin_function_info_put(&compiler->builtins, STRING("cdr"),
-                                    (struct builtin_function_info){1, OP_CDR});
-
-    smap__builtin_function_info_put(&compiler->builtins, STRING("cons"),
-                                    (struct builtin_function_info){2, OP_CONS});
-
-    smap__builtin_function_info_put(&compiler->builtins, STRING("quit"),
-                                    (struct builtin_function_info){0, OP_HALT});
-
-    smap__builtin_function_info_put(&compiler->builtins, STRING("toggle-debug"),
-                                    (struct builtin_function_info){0, OP_TOGGLE_DEBUG});
 }
 
 void compiler_destroy(struct compiler* compiler) {
-    SMAP_DESTROY(&compiler->builtins);
+    reader_destroy(&compiler->reader);
+    DYNARRAY_FREE(&compiler->globals);
+    SMAP_DESTROY(&compiler->global_index);
 }
 
-static inline u8 emit_byte(struct compiler* compiler, u8 byte) {
+/* Returns the length of the code after the byte, which jumps are patched with */
+static inline u32 emit_byte(struct compiler* compiler, u8 byte) {
     module_write_byte(compiler->module, byte);
     return compiler->module->code.length;
 }
 
-static inline u8 emit_constant(struct compiler* compiler, struct expr expr) {
+static inline u32 emit_constant(struct compiler* compiler, struct expr expr) {
     emit_byte(compiler, OP_CONSTANT);
     return emit_byte(compiler, module_write_const(compiler->module, expr));
 }
 
-static inline u8 emit_jmp(struct compiler* compiler, u8 jmp) {
+static inline u32 emit_jmp(struct compiler* compiler, u8 jmp) {
     emit_byte(compiler, jmp);
     emit_byte(compiler, 0x00);
     return emit_byte(compiler, 0x00);
@@ -67,20 +44,201 @@ static inline void patch_jmp(struct compiler* compiler, u32 jmp_save) {
     compiler->module->code.at[jmp_save-1] = ((u8) jmp_offset) & 0xFF;
 }
 
+static struct compile_global* find_global(struct compiler* compiler, struct slice(char) name) {
+    struct option(u32) index = smap__u32_get(&compiler->global_index, name);
+
+    return index.is_some ? &compiler->globals.at[index.item] : NULL;
+}
+
+static void analyze_expr(struct compiler* compiler, struct expr expr, u32 form, bool top) {
+    const struct builtin* builtin;
+    struct compile_global* global;
+    struct slice(char) name;
+    struct expr rest;
+
+    if (!consp(expr)) return;
+
+    if (symbolp(CAR(expr))) {
+        builtin = builtin_lookup((struct slice(char)){CAR(expr).symbol, CAR(expr).length});
+
+        if (builtin && (builtin->compile == compile_reload || builtin->compile == compile_load_native)) {
+            compiler->opaque = true;
+        }
+
+        if (builtin && (builtin->compile == compile_defvar || builtin->compile == compile_defextern)
+            && consp(CDR(expr)) && symbolp(CAR(CDR(expr)))) {
+            name = (struct slice(char)){CAR(CDR(expr)).symbol, CAR(CDR(expr)).length};
+
+            if (!(global = find_global(compiler, name))) {
+                dynarray__compile_global_push(&compiler->globals, (struct compile_global){
+                    .name = name, .form = CONSTANT_NONE, .index = CONSTANT_NONE,
+                });
+                smap__u32_put(&compiler->global_index, name, compiler->globals.length - 1);
+                global = &compiler->globals.at[compiler->globals.length - 1];
+            }
+
+            global->assignments += 1;
+            global->form = top ? form : CONSTANT_NONE;
+        }
+    }
+
+    for (rest = expr; consp(rest); rest = CDR(rest)) {
+        analyze_expr(compiler, CAR(rest), form, false);
+    }
+}
+
+/*
+ * Finds every global the module assigns before any of it is compiled, so uses
+ * of a global after the one form that assigns it can be inlined, and so can
+ * uses of globals of other modules nothing here touches.
+ * */
+static void analyze(struct compiler* compiler, const u32* forms, u32 count) {
+    u32 i;
+
+    DYNARRAY_CLEAR(&compiler->globals);
+    SMAP_CLEAR(&compiler->global_index);
+    compiler->form = 0;
+    compiler->opaque = false;
+
+    if (!compiler->constants) return;
+
+    for (i = 0; i < count; ++i) {
+        analyze_expr(compiler, EXPR(forms[i]), i, true);
+    }
+}
+
+/*
+ * Whether a global can be inlined where it is used, setting value to what it
+ * will hold. Globals the module assigns are up to what analyze found and the
+ * rest up to the registry, which records that this module depends on them.
+ * */
+static bool resolve_global(struct compiler* compiler, struct slice(char) name, struct expr* value) {
+    const struct builtin* builtin;
+    struct compile_global* global;
+    struct constant* constant;
+    u32 index;
+
+    if (!compiler->constants || compiler->opaque) return false;
+
+    if ((global = find_global(compiler, name))) {
+        /* the defvar hasn't run yet where it's used before or in the form assigning it */
+        if (!global->constant || compiler->form <= global->form) return false;
+
+        index = global->index;
+        *value = global->value;
+    } else {
+        index = constant_find(compiler->constants, name);
+
+        /* the natives are bound before anything runs */
+        if (index == CONSTANT_NONE) {
+            builtin = builtin_lookup(name);
+            if (!builtin || builtin->kind != BUILTIN_KIND_NATIVE) return false;
+
+            index = constant_add(compiler->constants, name,
+                                 builtin_create_native(builtin - builtins), CONSTANT_DEFINED);
+        }
+
+        constant = &compiler->constants->entries.at[index];
+        if (constant->state != CONSTANT_DEFINED) return false;
+
+        *value = constant->value;
+    }
+
+    dynarray__u32_push(&compiler->module->deps, index);
+
+    return true;
+}
+
+/* Called by the top-level form assigning a global with what it assigns */
+static void define_global(struct compiler* compiler, struct slice(char) name, struct expr value) {
+    struct compile_global* global;
+
+    if (!compiler->constants || compiler->opaque || !constant_inlinable(value)) return;
+
+    global = find_global(compiler, name);
+    if (!global || global->assignments != 1 || global->form != compiler->form) return;
+
+    global->index = constant_find(compiler->constants, name);
+    if (global->index == CONSTANT_NONE) {
+        global->index = constant_add(compiler->constants, name, value, CONSTANT_PENDING);
+    }
+
+    global->value = value;
+    global->constant = true;
+}
+
+/* What an expression evaluates to if that can be told without running it */
+static bool known_value(struct compiler* compiler, struct expr expr, struct expr* value) {
+    const struct builtin* builtin;
+    struct slice(char) name;
+
+    if (integerp(expr) || floatp(expr)) {
+        *value = expr;
+        return true;
+    }
+
+    if (!symbolp(expr)) return false;
+
+    name = (struct slice(char)){expr.symbol, expr.length};
+    builtin = builtin_lookup(name);
+
+    if (builtin && builtin->kind == BUILTIN_KIND_LITERAL) {
+        *value = builtin->op_code == OP_NIL ? expr_create_nil() : expr_create_boolean(builtin->op_code == OP_TRUE);
+        return true;
+    }
+
+    return resolve_global(compiler, name, value);
+}
+
+static void emit_inlined(struct compiler* compiler, struct expr value) {
+    switch (value.type) {
+        case EXPR_NIL:     emit_byte(compiler, OP_NIL); break;
+        case EXPR_BOOLEAN: emit_byte(compiler, value.boolean ? OP_TRUE : OP_FALSE); break;
+        default:           emit_constant(compiler, value); break;
+    }
+
+    compiler->type = TYPE_OF(value.type);
+}
+
 u8 compile(struct compiler* compiler) {
+    struct dynarray(u32) forms = {0};
     u8 ret;
     u32 ptr;
 
-    ret = COMPILE_OK;
-
+    /* the whole module is read before any of it is compiled, see analyze */
     while ((ptr = read_expr(&compiler->reader)) != 0) {
 
         /* If we failed to read an expression we can propagate that up */
         if (ptr == READER_ERROR) {
+            DYNARRAY_FREE(&forms);
             return COMPILE_READER_ERROR;
         }
 
-        ret = compile_expr(compiler, EXPR(ptr));
+        dynarray__u32_push(&forms, ptr);
+    }
+
+    ret = compile_forms(compiler, &forms);
+
+    DYNARRAY_FREE(&forms);
+
+    return ret;
+}
+
+u8 compile_forms(struct compiler* compiler, struct dynarray(u32)* forms) {
+    u8 ret;
+    u32 i;
+
+    ret = COMPILE_OK;
+
+    analyze(compiler, forms->at, forms->length);
+
+    for (i = 0; i < forms->length; ++i) {
+        /* only the last form's value is the module's result */
+        if (i > 0) emit_byte(compiler, OP_POP);
+
+        compiler->form = i;
+
+        ret = compile_expr(compiler, EXPR(forms->at[i]));
 
         if (ret != COMPILE_OK) break;
     }
@@ -90,10 +248,29 @@ u8 compile(struct compiler* compiler) {
     return ret;
 }
 
+u8 compile_form(struct compiler* compiler, struct expr expr) {
+    u8 ret;
+
+    analyze(compiler, NULL, 0);
+    if (compiler->constants) analyze_expr(compiler, expr, 0, true);
+
+    ret = compile_expr(compiler, expr);
+
+    emit_byte(compiler, OP_RETURN);
+
+    return ret;
+}
+
 u8 compile_expr(struct compiler* compiler, struct expr expr) {
+    /* anything that knows better narrows it down */
+    compiler->type = TYPE_ANY;
+
     switch ((enum expr_type)expr.type) {
         case EXPR_INTEGER:
+        case EXPR_FLOAT:
+        case EXPR_STRING:
             emit_constant(compiler, expr);
+            compiler->type = TYPE_OF(expr.type);
             break;
         case EXPR_CONS:
             return compile_list(compiler, expr);
@@ -102,6 +279,11 @@ u8 compile_expr(struct compiler* compiler, struct expr expr) {
         case EXPR_NIL:
         case EXPR_BOOLEAN:
         case EXPR_NATIVE:
+        case EXPR_CHANNEL:
+        case EXPR_EXTERN:
+        case EXPR_VECTOR:
+        case EXPR_TABLE:
+        case EXPR_BUILDER:
             break;
     }
 
@@ -109,16 +291,16 @@ u8 compile_expr(struct compiler* compiler, struct expr expr) {
 }
 
 u8 compile_symbol(struct compiler* compiler, struct expr expr) {
-    /* 
-     * We probably won't have to do the whole table thing for symbols because
-     * I don't foresee having to lookup that many more symbols
-     * */
-    if (expr.length == 1 && memcmp(expr.symbol, "t", 1) == 0) {
-        emit_byte(compiler, OP_TRUE);
-    } else if (expr.length == 1 && memcmp(expr.symbol, "f", 1) == 0) {
-        emit_byte(compiler, OP_FALSE);
-    } else if (expr.length == 3 && memcmp(expr.symbol, "nil", 3) == 0) {
-        emit_byte(compiler, OP_NIL);
+    const struct builtin* builtin;
+    struct expr value;
+
+    builtin = builtin_lookup((struct slice(char)){expr.symbol, expr.length});
+
+    if (builtin && builtin->kind == BUILTIN_KIND_LITERAL) {
+        emit_byte(compiler, builtin->op_code);
+        compiler->type = builtin_return_type(builtin);
+    } else if (resolve_global(compiler, (struct slice(char)){expr.symbol, expr.length}, &value)) {
+        emit_inlined(compiler, value);
     } else {
         emit_constant(compiler, expr);
         emit_byte(compiler, OP_LOAD_VAR);
@@ -128,25 +310,22 @@ u8 compile_symbol(struct compiler* compiler, struct expr expr) {
 }
 
 u8 compile_list(struct compiler* compiler, struct expr expr) {
+    const struct builtin* builtin;
+    struct file_location loc;
+
     if (!symbolp(CAR(expr))) {
-        fprintf(stderr, "(%d:%d) error: the first element of a list must be a symbol:\n\t'",
-                expr.loc.line, expr.loc.column);
+        loc = reader_location(&compiler->reader, expr.offset);
+        fprintf(stderr, "(%u:%u) error: the first element of a list must be a symbol:\n\t'",
+                loc.line, loc.column);
         expr_fprint(stderr, expr);
         fprintf(stderr, "'\n");
         return COMPILE_EXPECTED_SYMBOL;
     }
 
-    /* 
-     * But I can foresee the need to do a table for special forms like 'if',
-     * 'let', 'defun', 'define', etc.
-     *
-     * @TODO: Create another table of special forms and their respective
-     *        compilation function.
-     * */
-    if (memcmp(CAR(expr).symbol, "if", 2) == 0)
-        return compile_if(compiler, expr);
-    else if (memcmp(CAR(expr).symbol, "defvar", 6) == 0)
-        return compile_defvar(compiler, expr);
+    builtin = builtin_lookup((struct slice(char)){CAR(expr).symbol, CAR(expr).length});
+
+    if (builtin && builtin->kind == BUILTIN_KIND_SPECIAL_FORM)
+        return builtin->compile(compiler, expr);
 
     return compile_function(compiler, expr);
 }
@@ -156,11 +335,14 @@ u8 compile_if(struct compiler* compiler, struct expr expr) {
     struct expr then_branch;
     struct expr else_branch;
     u32 jmf_save, jmp_save;
+    struct file_location loc;
+    type_set type;
     u8 ret;
 
     if (expr.length != 4) {
-        fprintf(stderr, "(%d:%d) error: if expressions must have 4 parts:\n\t'",
-                expr.loc.line, expr.loc.column);
+        loc = reader_location(&compiler->reader, expr.offset);
+        fprintf(stderr, "(%u:%u) error: if expressions must have 4 parts:\n\t'",
+                loc.line, loc.column);
         expr_fprint(stderr, expr);
         fprintf(stderr, "'\n");
         return COMPILE_EXPECTED_ARGS;
@@ -178,6 +360,8 @@ u8 compile_if(struct compiler* compiler, struct expr expr) {
     ret = compile_expr(compiler, then_branch);
     if (ret != COMPILE_OK) return ret;
 
+    type = compiler->type;
+
     jmp_save = emit_jmp(compiler, OP_JMP);
 
     patch_jmp(compiler, jmf_save);
@@ -187,6 +371,8 @@ u8 compile_if(struct compiler* compiler, struct expr expr) {
 
     patch_jmp(compiler, jmp_save);
 
+    compiler->type |= type;
+
     return COMPILE_OK;
 }
 
@@ -194,10 +380,13 @@ u8 compile_defvar(struct compiler* compiler, struct expr expr)  {
     u8 ret;
     struct expr name;
     struct expr value;
+    struct expr known;
+    struct file_location loc;
 
     if (expr.length != 3) {
-        fprintf(stderr, "(%d:%d) error: defvar expressions must have 3 parts:\n\t'",
-                expr.loc.line, expr.loc.column);
+        loc = reader_location(&compiler->reader, expr.offset);
+        fprintf(stderr, "(%u:%u) error: defvar expressions must have 3 parts:\n\t'",
+                loc.line, loc.column);
         expr_fprint(stderr, expr);
         fprintf(stderr, "'\n");
         return COMPILE_EXPECTED_ARGS;
@@ -207,8 +396,9 @@ u8 compile_defvar(struct compiler* compiler, struct expr expr)  {
     value = CAR(CDR(CDR(expr)));
 
     if (!symbolp(name)) {
-        fprintf(stderr, "(%d:%d) error: defvar expects a symbol as the first arg:\n\t'",
-                expr.loc.line, expr.loc.column);
+        loc = reader_location(&compiler->reader, expr.offset);
+        fprintf(stderr, "(%u:%u) error: defvar expects a symbol as the first arg:\n\t'",
+                loc.line, loc.column);
         expr_fprint(stderr, expr);
         fprintf(stderr, "'\n");
         return COMPILE_EXPECTED_SYMBOL;
@@ -217,6 +407,10 @@ u8 compile_defvar(struct compiler* compiler, struct expr expr)  {
     ret = compile_expr(compiler, value);
     if (ret != COMPILE_OK) return ret;
 
+    if (known_value(compiler, value, &known)) {
+        define_global(compiler, (struct slice(char)){name.symbol, name.length}, known);
+    }
+
     emit_constant(compiler, name);
 
     emit_byte(compiler, OP_STORE_VAR);
@@ -225,48 +419,323 @@ u8 compile_defvar(struct compiler* compiler, struct expr expr)  {
     return COMPILE_OK;
 }
 
+u8 compile_reload(struct compiler* compiler, struct expr expr) {
+    struct expr path;
+    struct file_location loc;
+
+    if (expr.length != 2) {
+        loc = reader_location(&compiler->reader, expr.offset);
+        fprintf(stderr, "(%u:%u) error: #reload expressions must have 2 parts:\n\t'",
+                loc.line, loc.column);
+        expr_fprint(stderr, expr);
+        fprintf(stderr, "'\n");
+        return COMPILE_EXPECTED_ARGS;
+    }
+
+    path = CAR(CDR(expr));
+
+    if (!symbolp(path) && !stringp(path)) {
+        loc = reader_location(&compiler->reader, expr.offset);
+        fprintf(stderr, "(%u:%u) error: #reload expects the path as a string or symbol:\n\t'",
+                loc.line, loc.column);
+        expr_fprint(stderr, expr);
+        fprintf(stderr, "'\n");
+        return COMPILE_EXPECTED_SYMBOL;
+    }
+
+    emit_constant(compiler, path);
+    emit_byte(compiler, OP_RELOAD);
+
+    return COMPILE_OK;
+}
+
+u8 compile_load_native(struct compiler* compiler, struct expr expr) {
+    struct expr path;
+    struct file_location loc;
+
+    if (expr.length != 2) {
+        loc = reader_location(&compiler->reader, expr.offset);
+        fprintf(stderr, "(%u:%u) error: #load-native expressions must have 2 parts:\n\t'",
+                loc.line, loc.column);
+        expr_fprint(stderr, expr);
+        fprintf(stderr, "'\n");
+        return COMPILE_EXPECTED_ARGS;
+    }
+
+    path = CAR(CDR(expr));
+
+    if (!symbolp(path) && !stringp(path)) {
+        loc = reader_location(&compiler->reader, expr.offset);
+        fprintf(stderr, "(%u:%u) error: #load-native expects the path as a string or symbol:\n\t'",
+                loc.line, loc.column);
+        expr_fprint(stderr, expr);
+        fprintf(stderr, "'\n");
+        return COMPILE_EXPECTED_SYMBOL;
+    }
+
+    emit_constant(compiler, path);
+    emit_byte(compiler, OP_LOAD_NATIVE);
+
+    return COMPILE_OK;
+}
+
+static u8 defextern_error(struct compiler* compiler, struct expr expr, const char* message, u8 status) {
+    struct file_location loc = reader_location(&compiler->reader, expr.offset);
+
+    fprintf(stderr, "(%u:%u) error: %s:\n\t'", loc.line, loc.column, message);
+    expr_fprint(stderr, expr);
+    fprintf(stderr, "'\n");
+
+    return status;
+}
+
+/*
+ * The C function is looked up here rather than when the form runs, so a
+ * misspelled symbol is caught with the rest of the compile errors and the
+ * extern ends up in the module as a plain constant, stored like a defvar.
+ * */
+u8 compile_defextern(struct compiler* compiler, struct expr expr) {
+    struct expr name, params, ret, param;
+    struct extern_fn* ext;
+    u8 types[EXTERN_ARGS_MAX];
+    u8 arity = 0;
+    u8 ret_type;
+
+    if (expr.length != 4) {
+        return defextern_error(compiler, expr, "defextern expressions must have 4 parts",
+                               COMPILE_EXPECTED_ARGS);
+    }
+
+    name = CAR(CDR(expr));
+    params = CAR(CDR(CDR(expr)));
+    ret = CAR(CDR(CDR(CDR(expr))));
+
+    if (!symbolp(name)) {
+        return defextern_error(compiler, expr, "defextern expects a symbol as the first arg",
+                               COMPILE_EXPECTED_SYMBOL);
+    }
+
+    /* () reads as nil, a function that takes nothing */
+    if (!nilp(params) && !consp(params)) {
+        return defextern_error(compiler, expr, "defextern expects a list of argument types",
+                               COMPILE_EXPECTED_ARGS);
+    }
+
+    for (param = params; consp(param); param = CDR(param)) {
+        if (arity == EXTERN_ARGS_MAX) {
+            return defextern_error(compiler, expr, "defextern takes too many argument types",
+                                   COMPILE_EXPECTED_ARGS);
+        }
+
+        if (!symbolp(CAR(param))
+            || !extern_parse_type((struct slice(char)){CAR(param).symbol, CAR(param).length}, &types[arity])
+            || types[arity] == EXTERN_VOID) {
+            return defextern_error(compiler, expr, "defextern argument types are int, long, ptr, or double",
+                                   COMPILE_EXPECTED_SYMBOL);
+        }
+
+        arity++;
+    }
+
+    if (!symbolp(ret) || !extern_parse_type((struct slice(char)){ret.symbol, ret.length}, &ret_type)) {
+        return defextern_error(compiler, expr, "defextern return types are void, int, long, ptr, or double",
+                               COMPILE_EXPECTED_SYMBOL);
+    }
+
+    ext = extern_create((struct slice(char)){name.symbol, name.length}, types, arity, ret_type);
+    if (!ext) {
+        return defextern_error(compiler, expr, "defextern could not bind the C function",
+                               COMPILE_UNKOWN_SYMBOL);
+    }
+
+    emit_constant(compiler, expr_create_extern(ext));
+    emit_constant(compiler, name);
+    emit_byte(compiler, OP_STORE_VAR);
+
+    define_global(compiler, (struct slice(char)){name.symbol, name.length}, expr_create_extern(ext));
+
+    return COMPILE_OK;
+}
+
+/*
+ * Atoms go in the constants. Lists can't, #reload throws away the heap a form
+ * was read into once it's compiled, so they get packed into the module and
+ * every run of the quote unpacks a copy into the heap it runs in.
+ * */
+u8 compile_quote(struct compiler* compiler, struct expr expr) {
+    struct expr value;
+    struct file_location loc;
+
+    if (expr.length != 2) {
+        loc = reader_location(&compiler->reader, expr.offset);
+        fprintf(stderr, "(%u:%u) error: quote expressions must have 2 parts:\n\t'",
+                loc.line, loc.column);
+        expr_fprint(stderr, expr);
+        fprintf(stderr, "'\n");
+        return COMPILE_EXPECTED_ARGS;
+    }
+
+    value = CAR(CDR(expr));
+
+    if (consp(value)) {
+        emit_byte(compiler, OP_QUOTE);
+        emit_byte(compiler, module_write_quote(compiler->module, value));
+    } else {
+        emit_constant(compiler, value);
+    }
+
+    compiler->type = TYPE_OF(value.type);
+
+    return COMPILE_OK;
+}
+
 u8 compile_function(struct compiler* compiler, struct expr expr) {
+    const struct builtin* builtin;
+    struct expr func;
     u8 ret;
 
     if ((ret = compile_builtin_function(compiler, expr)) != COMPILE_UNKOWN_FUNCTION) {
         return ret;
     }
 
+    if (resolve_global(compiler, (struct slice(char)){CAR(expr).symbol, CAR(expr).length}, &func)
+        && (nativep(func) || externp(func))) {
+        return compile_direct_call(compiler, expr, func);
+    }
+
+    builtin = builtin_lookup((struct slice(char)){CAR(expr).symbol, CAR(expr).length});
+    if (builtin && builtin->kind == BUILTIN_KIND_NATIVE) {
+        return compile_native_call(compiler, expr, builtin);
+    }
+
     ret = compile_args(compiler, CDR(expr));
     if (ret != COMPILE_OK) return ret;
     emit_constant(compiler, CAR(expr));
     emit_byte(compiler, OP_CALL);
 
+    compiler->type = TYPE_ANY;
+
     return COMPILE_OK;
 }
 
-u8 compile_builtin_function(struct compiler* compiler, struct expr expr) {
+/* The variant of an instruction that skips checking its operands, or the instruction if it has none */
+static u8 unchecked_op_code(u8 op_code) {
+    switch (op_code) {
+        case OP_ADD: return OP_ADD_UNCHECKED;
+        case OP_SUB: return OP_SUB_UNCHECKED;
+        case OP_MUL: return OP_MUL_UNCHECKED;
+        case OP_CAR: return OP_CAR_UNCHECKED;
+        case OP_CDR: return OP_CDR_UNCHECKED;
+    }
+
+    return op_code;
+}
+
+/*
+ * Compiles the arguments of a call to a builtin and works out how many of
+ * them need their type checked when the call runs, leaving out the types in
+ * excluded from what the signature accepts. Sets proven if every one of them
+ * can only ever evaluate to a type that fits.
+ * */
+static u8 compile_typed_args(struct compiler* compiler, struct expr args, const struct builtin* builtin,
+                             type_set excluded, u32* checks, bool* proven) {
+    type_set accepted;
     u8 ret;
+    u8 n;
+
+    *checks = 0;
+    *proven = true;
+
+    for (n = 0; consp(args); args = CDR(args), ++n) {
+        ret = compile_expr(compiler, CAR(args));
+        if (ret != COMPILE_OK) return ret;
+
+        accepted = builtin_param_type(builtin, n) & ~excluded;
+        if (accepted == TYPE_ANY) continue;
+
+        *checks += 1;
+        if ((compiler->type & ~accepted) != 0) *proven = false;
+    }
+
+    return COMPILE_OK;
+}
+
+static u8 compile_arity_error(struct compiler* compiler, struct expr car, u32 arity, u32 given) {
+    struct file_location loc = reader_location(&compiler->reader, car.offset);
 
-    struct option(builtin_function_info) fn = {0};
+    fprintf(stderr, "(%u:%u) error: '%.*s' takes %d arguments but only %d were provided\n",
+            loc.line, loc.column, car.length, car.symbol, arity, given);
+
+    return COMPILE_MISSING_FUNCTION_ARGS;
+}
+
+u8 compile_builtin_function(struct compiler* compiler, struct expr expr) {
+    u8 ret, op_code;
+    const struct builtin* fn;
+    u32 checks;
+    bool proven;
 
     struct expr car = CAR(expr);
     struct expr args = CDR(expr);
 
-    struct slice(char) fn_name = {car.symbol, car.length};
+    fn = builtin_lookup((struct slice(char)){car.symbol, car.length});
 
-    fn = smap__builtin_function_info_get(&compiler->builtins, fn_name);
-
-    if (!fn.is_some) {
+    if (!fn || fn->kind != BUILTIN_KIND_FUNCTION) {
         return COMPILE_UNKOWN_FUNCTION;
     }
 
     /* do a compile time check of the number of arguments required by that function */
-    if (args.length != fn.item.arity) {
-        fprintf(stderr, "(%d:%d) error: '%.*s' takes %d arguments but only %d were provided\n", 
-                car.loc.line, car.loc.column, car.length, car.symbol, fn.item.arity, args.length);
-        return COMPILE_MISSING_FUNCTION_ARGS;
+    if (args.length != fn->arity) {
+        return compile_arity_error(compiler, car, fn->arity, args.length);
     }
 
-    ret = compile_args(compiler, args);
+    ret = compile_typed_args(compiler, args, fn, 0, &checks, &proven);
     if (ret != COMPILE_OK) return ret;
 
-    emit_byte(compiler, fn.item.op_code);
+    op_code = proven ? unchecked_op_code(fn->op_code) : fn->op_code;
+
+    compiler->module->checks += checks;
+    if (op_code != fn->op_code) compiler->module->checks_elided += checks;
+
+    emit_byte(compiler, op_code);
+    compiler->type = builtin_return_type(fn);
+
+    return COMPILE_OK;
+}
+
+/*
+ * Natives are called by name like any other function, so rebinding one still
+ * works, but their arity and the types of their arguments are known ahead of
+ * time. The vm never hands a native nil, which is why it doesn't count as
+ * fitting even where the signature takes anything.
+ * */
+u8 compile_native_call(struct compiler* compiler, struct expr expr, const struct builtin* native) {
+    struct expr car = CAR(expr);
+    struct expr args = CDR(expr);
+    u32 checks;
+    bool proven;
+    u8 ret;
+
+    if (args.length != native->arity) {
+        return compile_arity_error(compiler, car, native->arity, args.length);
+    }
+
+    ret = compile_typed_args(compiler, args, native, TYPE_OF(EXPR_NIL), &checks, &proven);
+    if (ret != COMPILE_OK) return ret;
+
+    emit_constant(compiler, car);
+
+    compiler->module->checks += checks;
+
+    if (proven) {
+        compiler->module->checks_elided += checks;
+        emit_byte(compiler, OP_CALL_UNCHECKED);
+        emit_byte(compiler, (u8)(native - builtins));
+    } else {
+        emit_byte(compiler, OP_CALL);
+    }
+
+    compiler->type = builtin_return_type(native);
 
     return COMPILE_OK;
 }
@@ -274,10 +743,61 @@ u8 compile_builtin_function(struct compiler* compiler, struct expr expr) {
 u8 compile_args(struct compiler* compiler, struct expr expr) {
     u8 ret;
 
-    if (!consp(expr)) return COMPILE_OK;
+    for (; consp(expr); expr = CDR(expr)) {
+        ret = compile_expr(compiler, CAR(expr));
+        if (ret != COMPILE_OK) return ret;
+    }
 
-    ret = compile_expr(compiler, CAR(expr));
+    return COMPILE_OK;
+}
+
+/*
+ * A call to a global known to hold a native or an extern, which skips looking
+ * the global up when it runs. Natives of builtin.def that an instruction does
+ * the same as compile to that instruction instead.
+ * */
+u8 compile_direct_call(struct compiler* compiler, struct expr expr, struct expr func) {
+    const struct builtin* builtin = nativep(func) ? builtin_find_native(func) : NULL;
+    struct expr car = CAR(expr);
+    struct expr args = CDR(expr);
+    u32 arity = nativep(func) ? func.arity : func.ext->arity;
+    u32 checks = 0;
+    bool proven = false;
+    u8 ret, op_code, index;
+
+    if (args.length != arity) {
+        return compile_arity_error(compiler, car, arity, args.length);
+    }
+
+    if (builtin && builtin->op_code != OP_CALL) {
+        ret = compile_typed_args(compiler, args, builtin, 0, &checks, &proven);
+        if (ret != COMPILE_OK) return ret;
+
+        op_code = proven ? unchecked_op_code(builtin->op_code) : builtin->op_code;
+
+        compiler->module->checks += checks;
+        if (op_code != builtin->op_code) compiler->module->checks_elided += checks;
+
+        emit_byte(compiler, op_code);
+        compiler->type = builtin_return_type(builtin);
+
+        return COMPILE_OK;
+    }
+
+    ret = builtin
+        ? compile_typed_args(compiler, args, builtin, TYPE_OF(EXPR_NIL), &checks, &proven)
+        : compile_args(compiler, args);
     if (ret != COMPILE_OK) return ret;
 
-    return compile_args(compiler, CDR(expr));
+    index = module_write_const(compiler->module, func);
+
+    compiler->module->checks += checks;
+    if (proven) compiler->module->checks_elided += checks;
+
+    emit_byte(compiler, proven ? OP_CALL_NATIVE_UNCHECKED : OP_CALL_NATIVE);
+    emit_byte(compiler, index);
+
+    compiler->type = builtin ? builtin_return_type(builtin) : TYPE_ANY;
+
+    return COMPILE_OK;
 }
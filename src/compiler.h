@@ -6,8 +6,8 @@
 #include "reader.h"
 #include "generics.h"
 #include "builtin.h"
+#include "constant.h"
 
-/* @TODO: Implment quoting */
 /* @TODO: Implement global variables */
 /* @TODO: Implement let expressions */
 /* @TODO: Implement user defined functions */
@@ -22,10 +22,33 @@ enum compiler_status {
     COMPILE_READER_ERROR,
 };
 
+/* A global the module being compiled assigns somewhere */
+struct compile_global {
+    struct slice(char) name;
+    u32 assignments;
+    u32 form;        /* the top-level form assigning it, CONSTANT_NONE if it's nested */
+    u32 index;       /* its entry in the constant registry once it is known to be constant */
+    struct expr value;
+    bool constant;   /* assigned once at the top level to something inlinable */
+};
+
+DYNARRAY_DECL_S(compile_global);
+
 struct compiler {
     struct module* module;
     struct reader reader;
-    struct smap(builtin_function_info) builtins;
+    type_set type; /* every type the last expression compiled might evaluate to */
+
+    /*
+     * Where globals that are never reassigned get inlined from, see constant.h.
+     * NULL looks every global up when the code runs, which is what it has to
+     * be when anything else can assign the vm's globals while the module runs.
+     * */
+    struct constant_registry* constants;
+    struct dynarray(compile_global) globals;
+    struct smap(u32) global_index; /* where each of globals is by name */
+    u32 form;    /* the index of the top-level form being compiled */
+    bool opaque; /* the module loads code that can assign any global, nothing gets inlined */
 };
 
 /* 
@@ -33,17 +56,30 @@ struct compiler {
  *       users of the "library" to see.
  * */
 
-void compiler_init(struct compiler* compiler, struct slice(char) src, struct module* module);
+void compiler_init(struct compiler* compiler, struct reader reader, struct module* module);
 
 void compiler_destroy(struct compiler* compiler);
 
 u8 compile(struct compiler* compiler);
+
+/* Compiles forms that were already read, see parallel_read_forms */
+u8 compile_forms(struct compiler* compiler, struct dynarray(u32)* forms);
+
+/* Compiles one top-level form into a module of its own, see pipeline_run */
+u8 compile_form(struct compiler* compiler, struct expr expr);
+
 u8 compile_expr(struct compiler* compiler, struct expr expr);
 u8 compile_symbol(struct compiler* compiler, struct expr expr);
 u8 compile_list(struct compiler* compiler, struct expr expr);
 u8 compile_if(struct compiler* compiler, struct expr expr);
 u8 compile_defvar(struct compiler* compiler, struct expr expr);
+u8 compile_reload(struct compiler* compiler, struct expr expr);
+u8 compile_quote(struct compiler* compiler, struct expr expr);
+u8 compile_load_native(struct compiler* compiler, struct expr expr);
+u8 compile_defextern(struct compiler* compiler, struct expr expr);
 u8 compile_builtin_function(struct compiler* compiler, struct expr expr);
+u8 compile_native_call(struct compiler* compiler, struct expr expr, const struct builtin* native);
+u8 compile_direct_call(struct compiler* compiler, struct expr expr, struct expr func);
 u8 compile_function(struct compiler* compiler, struct expr expr);
 u8 compile_args(struct compiler* compiler, struct expr expr);
 
@@ -0,0 +1,108 @@
+#include "constant.h"
+#include "builtin.h"
+#include "module.h"
+
+DYNARRAY_IMPL_S(constant);
+SMAP_IMPL(u32);
+
+static bool same_value(struct expr a, struct expr b) {
+    if (a.type != b.type) return false;
+
+    switch (a.type) {
+        case EXPR_NIL:     return true;
+        case EXPR_BOOLEAN: return a.boolean == b.boolean;
+        case EXPR_INTEGER: return a.integer == b.integer;
+        case EXPR_FLOAT:   return a.real == b.real;
+        case EXPR_NATIVE:  return a.native == b.native;
+        case EXPR_EXTERN:  return a.ext == b.ext;
+    }
+
+    return false;
+}
+
+bool constant_inlinable(struct expr value) {
+    switch (value.type) {
+        case EXPR_NIL:
+        case EXPR_BOOLEAN:
+        case EXPR_INTEGER:
+        case EXPR_FLOAT:
+        case EXPR_NATIVE:
+        case EXPR_EXTERN:
+            return true;
+    }
+
+    return false;
+}
+
+u32 constant_find(struct constant_registry* registry, struct slice(char) name) {
+    struct option(u32) index = smap__u32_get(&registry->index, name);
+
+    return index.is_some ? index.item : CONSTANT_NONE;
+}
+
+u32 constant_add(struct constant_registry* registry, struct slice(char) name, struct expr value, u8 state) {
+    struct constant constant = {0};
+
+    constant.name.ptr = malloc(name.length);
+    assert(constant.name.ptr);
+    memcpy(constant.name.ptr, name.ptr, name.length);
+    constant.name.length = name.length;
+    constant.value = value;
+    constant.state = state;
+
+    dynarray__constant_push(&registry->entries, constant);
+    smap__u32_put(&registry->index, constant.name, registry->entries.length - 1);
+
+    return registry->entries.length - 1;
+}
+
+void constant_assigned(struct constant_registry* registry, struct slice(char) name, struct expr value) {
+    const struct builtin* builtin;
+    struct constant* constant;
+    u32 index = constant_find(registry, name);
+
+    if (index == CONSTANT_NONE) {
+        /* binding the builtin natives is not an assignment, anything else to their names is */
+        builtin = builtin_lookup(name);
+        if (builtin && builtin->kind == BUILTIN_KIND_NATIVE
+            && !(nativep(value) && value.native == builtin->native)) {
+            constant_add(registry, name, value, CONSTANT_REDEFINED);
+        }
+
+        return;
+    }
+
+    constant = &registry->entries.at[index];
+
+    switch (constant->state) {
+        case CONSTANT_PENDING:
+            constant->state = same_value(constant->value, value) ? CONSTANT_DEFINED : CONSTANT_REDEFINED;
+            break;
+        case CONSTANT_DEFINED:
+            constant->state = CONSTANT_REDEFINED;
+            break;
+    }
+}
+
+bool constant_deps_valid(struct constant_registry* registry, struct module* module) {
+    u32 i, index;
+
+    for (i = 0; i < module->deps.length; ++i) {
+        index = module->deps.at[i];
+        if (index >= registry->entries.length || registry->entries.at[index].state == CONSTANT_REDEFINED)
+            return false;
+    }
+
+    return true;
+}
+
+void constant_registry_destroy(struct constant_registry* registry) {
+    struct constant* constant;
+
+    DYNARRAY_FOR_EACH(&registry->entries, constant) {
+        free(constant->name.ptr);
+    }
+
+    DYNARRAY_FREE(&registry->entries);
+    SMAP_DESTROY(&registry->index);
+}
@@ -0,0 +1,63 @@
+#ifndef __CONSTANT_H
+#define __CONSTANT_H
+
+#include "common.h"
+#include "expr.h"
+
+struct module;
+
+/*
+ * Globals the compiler may inline, because as far as anything compiled so far
+ * can tell they are never assigned again: globals a module defvars exactly
+ * once at the top level to an integer, a float, t, f, nil, a native or an
+ * extern, and the natives of builtin.def nothing has rebound.
+ *
+ * Inlining is only sound as long as nothing assigns the global again, which
+ * another module can always do later on, from the next line of the repl or a
+ * file that gets #reload-ed. So every assignment goes through
+ * constant_assigned, and the second one marks the global as redefined. It is
+ * never inlined again from then on, and every module that inlined it lists its
+ * index in its deps, so whoever keeps bytecode around (see reload.c) can tell
+ * it is stale with constant_deps_valid and compile it again.
+ * */
+
+enum constant_state {
+    CONSTANT_PENDING,   /* compiled, waiting for the defvar to run */
+    CONSTANT_DEFINED,   /* assigned once, safe to inline */
+    CONSTANT_REDEFINED, /* assigned again, never to be inlined */
+};
+
+struct constant {
+    struct slice(char) name; /* owned, the source it came from can go away */
+    struct expr value;
+    u8 state;
+};
+
+DYNARRAY_DECL_S(constant);
+SMAP_DECL(u32);
+
+struct constant_registry {
+    struct dynarray(constant) entries;
+    struct smap(u32) index; /* the index of every entry by its name */
+};
+
+#define CONSTANT_NONE ((u32)-1)
+
+/* Returns the index of the global's entry or CONSTANT_NONE */
+u32 constant_find(struct constant_registry* registry, struct slice(char) name);
+
+/* Adds an entry for a global that has none yet and returns its index */
+u32 constant_add(struct constant_registry* registry, struct slice(char) name, struct expr value, u8 state);
+
+/* Called with every value a global of the vm is set to */
+void constant_assigned(struct constant_registry* registry, struct slice(char) name, struct expr value);
+
+/* Whether nothing a module inlined has been redefined since it was compiled */
+bool constant_deps_valid(struct constant_registry* registry, struct module* module);
+
+/* The values that can be inlined, they neither live on the heap nor borrow source text */
+bool constant_inlinable(struct expr value);
+
+void constant_registry_destroy(struct constant_registry* registry);
+
+#endif  /*__CONSTANT_H*/
@@ -0,0 +1,175 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+
+#include "epoch.h"
+
+/* One per thread that has ever read, reused once the thread exits */
+struct epoch_record {
+    u64 active; /* the epoch the thread entered in, 0 while it's outside */
+    bool in_use;
+    struct epoch_record* next;
+};
+
+struct epoch_retired {
+    void* ptr;
+    void (*free_fn)(void*);
+    u64 epoch;
+};
+
+DYNARRAY_DECL_S(epoch_retired);
+DYNARRAY_IMPL_S(epoch_retired);
+
+/* Starts at 1 so 0 can mean outside */
+static u64 global_epoch = 1;
+static struct epoch_record* records;
+
+static pthread_mutex_t retired_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct dynarray(epoch_retired) retired;
+
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t record_key;
+
+static __thread struct epoch_record* self;
+static __thread u32 depth;
+
+static void release_record(void* record) {
+    ((struct epoch_record*)record)->active = 0;
+    __atomic_store_n(&((struct epoch_record*)record)->in_use, false, __ATOMIC_RELEASE);
+}
+
+static void create_key(void) {
+    pthread_key_create(&record_key, release_record);
+}
+
+/* A record nobody is using, made if there isn't one */
+static struct epoch_record* claim_record(void) {
+    struct epoch_record* record;
+    bool unused;
+
+    for (record = __atomic_load_n(&records, __ATOMIC_ACQUIRE); record; record = record->next) {
+        unused = false;
+        if (__atomic_compare_exchange_n(&record->in_use, &unused, true, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            break;
+    }
+
+    if (!record) {
+        record = calloc(1, sizeof(struct epoch_record));
+        assert(record);
+        record->in_use = true;
+
+        record->next = __atomic_load_n(&records, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&records, &record->next, record, true,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    }
+
+    return record;
+}
+
+static struct epoch_record* acquire_record(void) {
+    struct epoch_record* record;
+
+    pthread_once(&key_once, create_key);
+
+    record = claim_record();
+    pthread_setspecific(record_key, record);
+
+    return record;
+}
+
+void epoch_enter(void) {
+    if (depth++ > 0) return;
+
+    if (!self) self = acquire_record();
+
+    __atomic_store_n(&self->active, __atomic_load_n(&global_epoch, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+
+    /* the announcement has to land before anything shared is loaded */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void epoch_leave(void) {
+    assert(depth > 0);
+    if (--depth > 0) return;
+
+    __atomic_store_n(&self->active, 0, __ATOMIC_RELEASE);
+}
+
+struct epoch_record* epoch_pin(void) {
+    struct epoch_record* pin = claim_record();
+
+    epoch_repin(pin);
+
+    return pin;
+}
+
+void epoch_idle(struct epoch_record* pin) {
+    __atomic_store_n(&pin->active, 0, __ATOMIC_RELEASE);
+}
+
+void epoch_repin(struct epoch_record* pin) {
+    __atomic_store_n(&pin->active, __atomic_load_n(&global_epoch, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void epoch_unpin(struct epoch_record* pin) {
+    release_record(pin);
+}
+
+/* The oldest epoch any reader is still in, or the current one if none are */
+static u64 oldest_active(void) {
+    u64 oldest = __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST);
+    struct epoch_record* record;
+    u64 active;
+
+    for (record = __atomic_load_n(&records, __ATOMIC_ACQUIRE); record; record = record->next) {
+        active = __atomic_load_n(&record->active, __ATOMIC_SEQ_CST);
+        if (active != 0 && active < oldest) oldest = active;
+    }
+
+    return oldest;
+}
+
+static void reclaim_locked(void) {
+    u64 oldest = oldest_active();
+    usize i, kept = 0;
+
+    for (i = 0; i < retired.length; ++i) {
+        /* readers in the epoch it was retired in might have loaded it before it was unlinked */
+        if (retired.at[i].epoch < oldest) {
+            retired.at[i].free_fn(retired.at[i].ptr);
+        } else {
+            retired.at[kept++] = retired.at[i];
+        }
+    }
+
+    retired.length = kept;
+}
+
+void epoch_retire(void* ptr, void (*free_fn)(void*)) {
+    struct epoch_retired item = { .ptr = ptr, .free_fn = free_fn };
+
+    pthread_mutex_lock(&retired_lock);
+
+    /* it's already unlinked, so anyone entering after the bump can't find it */
+    item.epoch = __atomic_fetch_add(&global_epoch, 1, __ATOMIC_SEQ_CST);
+    dynarray__epoch_retired_push(&retired, item);
+
+    reclaim_locked();
+
+    pthread_mutex_unlock(&retired_lock);
+}
+
+void epoch_reclaim(void) {
+    pthread_mutex_lock(&retired_lock);
+
+    reclaim_locked();
+
+    if (retired.length == 0) {
+        DYNARRAY_FREE(&retired);
+        retired = (struct dynarray(epoch_retired)){0};
+    }
+
+    pthread_mutex_unlock(&retired_lock);
+}
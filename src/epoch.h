@@ -0,0 +1,43 @@
+#ifndef __EPOCH_H
+#define __EPOCH_H
+
+#include "common.h"
+
+/*
+ * Epoch based reclamation for memory that readers walk without locks.
+ *
+ * Readers bracket every access with epoch_enter and epoch_leave, which only
+ * write to a slot owned by the calling thread. A writer that unlinks something
+ * readers might still be looking at retires it instead of freeing it, and it
+ * gets freed once every reader that was inside at the time has left.
+ *
+ * Entering nests, and a thread's slot is handed to another thread once it
+ * exits.
+ * */
+
+void epoch_enter(void);
+void epoch_leave(void);
+
+/* Frees ptr with free_fn once no reader can still see it */
+void epoch_retire(void* ptr, void (*free_fn)(void*));
+
+/* Frees whatever was retired and isn't visible to any reader anymore */
+void epoch_reclaim(void);
+
+struct epoch_record;
+
+/*
+ * Holds back reclamation like a reader that entered now and hasn't left, for
+ * whoever keeps the pin rather than for the calling thread, so it can be
+ * dropped from any thread.
+ * */
+struct epoch_record* epoch_pin(void);
+void epoch_unpin(struct epoch_record* pin);
+
+/* Stops a pin from holding anything back, without giving its record up */
+void epoch_idle(struct epoch_record* pin);
+
+/* Pins again as of now, a pin that's already holding moves up to the current epoch */
+void epoch_repin(struct epoch_record* pin);
+
+#endif  /*__EPOCH_H*/
@@ -1,18 +1,28 @@
 #include <stdio.h>
 
 #include "expr.h"
+#include "extern.h"
+#include "builder.h"
 #include "native.h"
+#include "table.h"
+#include "vector.h"
 
 DYNARRAY_IMPL_S(expr);
 SMAP_IMPL_S(expr);
+DYNARRAY_IMPL(u32);
 
-struct dynarray(expr) exprs = {0};
-struct arena expr_arena = {0};
+/* Small strings count on their length sitting right before the type, and on exprs staying 16 bytes */
+typedef char expr_layout_check[sizeof(struct expr) == 16 && offsetof(struct expr, small_length) == 14 ? 1 : -1];
+
+__thread struct dynarray(expr) exprs = {0};
+__thread struct arena expr_arena = {0};
+
+struct expr* expr_shared_pages[EXPR_SHARED_PAGES];
 
 u32 expr_box(struct expr expr) {
     /* The dynarray is too full for our needs */
     /* We have to be careful of overflowing our u32 */
-    if (exprs.length >= (usize)(1 << 31)) {
+    if (exprs.length >= (usize)EXPR_SHARED_BIT) {
         assert(0 && "We need to fix this asap!");
         return 0;
     }
@@ -22,6 +32,38 @@ u32 expr_box(struct expr expr) {
     return exprs.length - 1;
 }
 
+u32 expr_heap_adopt(struct dynarray(expr)* heap) {
+    u32 base = expr_heap_copy(heap->at, heap->length);
+
+    DYNARRAY_FREE(heap);
+    *heap = (struct dynarray(expr)){0};
+
+    return base;
+}
+
+u32 expr_heap_copy(const struct expr* cells, u32 length) {
+    u32 base = exprs.length - 1;
+    u32 count = length - 1;
+    struct expr* cell;
+    u32 i;
+
+    DYNARRAY_RESERVE(struct expr, &exprs, count);
+    memcpy(exprs.at + exprs.length, cells + 1, count * sizeof(struct expr));
+
+    for (i = 0; i < count; ++i) {
+        cell = &exprs.at[exprs.length + i];
+        if (cell->type != EXPR_CONS) continue;
+
+        /* index 0 is nil in both heaps so it stays put */
+        if (cell->car) cell->car += base;
+        if (cell->cdr) cell->cdr += base;
+    }
+
+    exprs.length += count;
+
+    return base;
+}
+
 u32 expr_new() {
     struct expr expr = {0};
     return expr_box(expr);
@@ -53,7 +95,7 @@ u32 expr_new_integer(i64 integer) {
     return ptr;
 }
 
-u32 expr_new_symbol(char* symbol, u8 length) {
+u32 expr_new_symbol(char* symbol, u32 length) {
     u32 ptr = expr_new();
 
     exprs.at[ptr].type = EXPR_SYMBOL;
@@ -83,6 +125,66 @@ u32 expr_new_native(native_fn fn, u8 arity) {
     return ptr;
 }
 
+u32 expr_new_channel(struct channel* channel) {
+    u32 ptr = expr_new();
+
+    exprs.at[ptr].type = EXPR_CHANNEL;
+    exprs.at[ptr].channel = channel;
+
+    return ptr;
+}
+
+u32 expr_new_extern(struct extern_fn* ext) {
+    u32 ptr = expr_new();
+
+    exprs.at[ptr].type = EXPR_EXTERN;
+    exprs.at[ptr].ext = ext;
+
+    return ptr;
+}
+
+u32 expr_new_float(f64 real) {
+    u32 ptr = expr_new();
+
+    exprs.at[ptr].type = EXPR_FLOAT;
+    exprs.at[ptr].real = real;
+
+    return ptr;
+}
+
+u32 expr_new_vector(struct vector* vector) {
+    u32 ptr = expr_new();
+
+    exprs.at[ptr].type = EXPR_VECTOR;
+    exprs.at[ptr].vector = vector;
+
+    return ptr;
+}
+
+u32 expr_new_table(struct table* table) {
+    u32 ptr = expr_new();
+
+    exprs.at[ptr].type = EXPR_TABLE;
+    exprs.at[ptr].table = table;
+
+    return ptr;
+}
+
+u32 expr_new_string(const char* text, u32 length) {
+    struct expr string = expr_create_string(text, length);
+
+    return expr_box(string);
+}
+
+u32 expr_new_builder(struct builder* builder) {
+    u32 ptr = expr_new();
+
+    exprs.at[ptr].type = EXPR_BUILDER;
+    exprs.at[ptr].builder = builder;
+
+    return ptr;
+}
+
 struct expr expr_create() {
     return (struct expr){0};
 }
@@ -111,7 +213,7 @@ struct expr expr_create_integer(i64 integer) {
     return expr;
 }
 
-struct expr expr_create_symbol(char* symbol, u8 length) {
+struct expr expr_create_symbol(char* symbol, u32 length) {
     struct expr expr = expr_create();
     expr.type = EXPR_SYMBOL;
     expr.symbol = symbol;
@@ -138,11 +240,80 @@ struct expr expr_create_native(native_fn fn, u8 arity) {
     return expr;
 }
 
-/* Takes an index (pointer) into the expr array and returns the associated expr */
-#define EXPR(ptr) exprs.at[(ptr)]
+struct expr expr_create_channel(struct channel* channel) {
+    struct expr expr = expr_create();
+    expr.type = EXPR_CHANNEL;
+    expr.channel = channel;
+
+    return expr;
+}
+
+struct expr expr_create_extern(struct extern_fn* ext) {
+    struct expr expr = expr_create();
+    expr.type = EXPR_EXTERN;
+    expr.ext = ext;
+
+    return expr;
+}
+
+struct expr expr_create_float(f64 real) {
+    struct expr expr = expr_create();
+    expr.type = EXPR_FLOAT;
+    expr.real = real;
+
+    return expr;
+}
+
+struct expr expr_create_vector(struct vector* vector) {
+    struct expr expr = expr_create();
+    expr.type = EXPR_VECTOR;
+    expr.vector = vector;
+
+    return expr;
+}
+
+struct expr expr_create_table(struct table* table) {
+    struct expr expr = expr_create();
+    expr.type = EXPR_TABLE;
+    expr.table = table;
+
+    return expr;
+}
+
+struct expr expr_create_builder(struct builder* builder) {
+    struct expr expr = expr_create();
+    expr.type = EXPR_BUILDER;
+    expr.builder = builder;
+
+    return expr;
+}
+
+struct expr expr_create_string_borrowed(char* text, u32 length) {
+    struct expr expr = expr_create();
+    expr.type = EXPR_STRING;
+
+    if (length <= EXPR_SMALL_STRING_MAX) {
+        memcpy(expr.small, text, length);
+        expr.small_length = length;
+    } else {
+        expr.string = text;
+        expr.size = length;
+        expr.small_length = EXPR_STRING_SLICE;
+    }
+
+    return expr;
+}
+
+struct expr expr_create_string(const char* text, u32 length) {
+    char* copy;
+
+    if (length <= EXPR_SMALL_STRING_MAX) return expr_create_string_borrowed((char*)text, length);
 
-#define CAR(e) EXPR((e).car)
-#define CDR(e) EXPR((e).cdr)
+    copy = arena_alloc(&expr_arena, length);
+    memcpy(copy, text, length);
+
+    return expr_create_string_borrowed(copy, length);
+}
 
 u8 nilp(struct expr expr) { return expr.type == EXPR_NIL; }
 u8 boolp(struct expr expr) { return expr.type == EXPR_BOOLEAN; }
@@ -150,6 +321,13 @@ u8 integerp(struct expr expr) { return expr.type == EXPR_INTEGER; }
 u8 symbolp(struct expr expr) { return expr.type == EXPR_SYMBOL; }
 u8 consp(struct expr expr) { return expr.type == EXPR_CONS; }
 u8 nativep(struct expr expr) { return expr.type == EXPR_NATIVE; }
+u8 channelp(struct expr expr) { return expr.type == EXPR_CHANNEL; }
+u8 externp(struct expr expr) { return expr.type == EXPR_EXTERN; }
+u8 floatp(struct expr expr) { return expr.type == EXPR_FLOAT; }
+u8 vectorp(struct expr expr) { return expr.type == EXPR_VECTOR; }
+u8 tablep(struct expr expr) { return expr.type == EXPR_TABLE; }
+u8 stringp(struct expr expr) { return expr.type == EXPR_STRING; }
+u8 builderp(struct expr expr) { return expr.type == EXPR_BUILDER; }
 
 void expr_print(struct expr expr) {
     expr_fprint(stdout, expr);
@@ -159,7 +337,20 @@ void expr_println(struct expr expr) {
     expr_fprintln(stdout, expr);
 }
 
+/* As few digits as give back the same double, with a point so it can't be mistaken for an integer */
+u32 expr_format_float(char* buffer, usize size, f64 real) {
+    char digits[EXPR_FLOAT_TEXT_MAX];
+
+    snprintf(digits, sizeof(digits), "%.15g", real);
+    if (strtod(digits, NULL) != real) snprintf(digits, sizeof(digits), "%.17g", real);
+
+    return snprintf(buffer, size, "%s%s", digits, strpbrk(digits, ".ein") ? "" : ".0");
+}
+
 void expr_fprint(FILE* stream, struct expr expr) {
+    char text[EXPR_FLOAT_TEXT_MAX];
+    struct slice(char) string;
+
     switch ((enum expr_type) expr.type) {
         case EXPR_NIL:
             fprintf(stream, "nil");
@@ -183,12 +374,36 @@ void expr_fprint(FILE* stream, struct expr expr) {
         case EXPR_NATIVE:
             fprintf(stream, "<native fn>");
             break;
+        case EXPR_CHANNEL:
+            fprintf(stream, "<channel>");
+            break;
+        case EXPR_EXTERN:
+            fprintf(stream, "<extern %.*s>", STRINGF(expr.ext->name));
+            break;
+        case EXPR_FLOAT:
+            expr_format_float(text, sizeof(text), expr.real);
+            fprintf(stream, "%s", text);
+            break;
+        case EXPR_VECTOR:
+            fprintf(stream, "<vector %s %zu>", expr.vector->kind == VECTOR_I64 ? "i64" : "f64",
+                    expr.vector->length);
+            break;
+        case EXPR_TABLE:
+            fprintf(stream, "<table %zu>", expr.table->count);
+            break;
+        case EXPR_STRING:
+            string = expr_string(&expr);
+            fprintf(stream, "%.*s", STRINGF(string));
+            break;
+        case EXPR_BUILDER:
+            fprintf(stream, "<builder %zu>", expr.builder->length);
+            break;
     }
 }
 
 void expr_fprintln(FILE* stream, struct expr expr) {
     expr_fprint(stream, expr);
-    putchar('\n');
+    fputc('\n', stream);
 }
 
 bool expr_is_truthy(struct expr expr) {
@@ -203,6 +418,20 @@ bool expr_is_truthy(struct expr expr) {
             return expr.length != 0;
         case EXPR_NATIVE:
             return expr.native != NULL;
+        case EXPR_CHANNEL:
+            return expr.channel != NULL;
+        case EXPR_EXTERN:
+            return expr.ext != NULL;
+        case EXPR_FLOAT:
+            return expr.real != 0.0;
+        case EXPR_VECTOR:
+            return expr.vector != NULL;
+        case EXPR_TABLE:
+            return expr.table != NULL;
+        case EXPR_STRING:
+            return expr_string(&expr).length != 0;
+        case EXPR_BUILDER:
+            return expr.builder != NULL;
         case EXPR_SYMBOL:
             UNIMPLEMENTED();
    }
@@ -210,43 +439,34 @@ bool expr_is_truthy(struct expr expr) {
     return false;
 }
 
-static u8 __expr_cons_length(struct expr expr, u8 acc) {
-    if (!consp(CDR(expr))) return acc;
+u32 expr_cons_length(struct expr expr) {
+    u32 length = 0;
 
-    return __expr_cons_length(CDR(expr), acc+1);
-}
+    for (; consp(expr); expr = CDR(expr)) length += 1;
 
-u8 expr_cons_length(struct expr expr) {
-    if (!consp(expr)) return 0;
-    return __expr_cons_length(expr, 1);
+    return length;
 }
 
+/* Walks to the end every time, build long lists front to back through a tail instead */
 u32 expr_cons_append(u32 list, struct expr expr) {
-    u32 cdr;
-    if (list == 0) return expr_new_cons(expr_box(expr), 0);
+    u32 cell = expr_new_cons(expr_box(expr), 0);
+    u32 tail = list;
 
-    cdr = EXPR(list).cdr;
+    if (list == 0) return cell;
 
+    /* the heap only grows before the walk, so indexing into it is safe */
+    while (EXPR(tail).cdr != 0) tail = EXPR(tail).cdr;
+    EXPR(tail).cdr = cell;
 
-    EXPR(list).cdr = expr_cons_append(cdr, expr);
     return list;
 }
 
-/*
-  (define .rev (lambda (xs acc)
-                (cond
-                    ((empty? xs) acc)
-                    (else (let ( (x (car xs)) 
-                               (.rev (cdr xs) (cons x) acc))))))))
-*/
+u32 expr_cons_reverse(u32 list) {
+    u32 reversed = 0;
 
-u32 __expr_cons_reverse(u32 list, u32 acc) {
-    if (expr_cons_length(EXPR(list)) == 0) return acc;
-    return __expr_cons_reverse(EXPR(list).cdr, expr_new_cons(EXPR(list).car, acc));
-}
+    for (; consp(EXPR(list)); list = EXPR(list).cdr) reversed = expr_new_cons(EXPR(list).car, reversed);
 
-u32 expr_cons_reverse(u32 list) {
-    return __expr_cons_reverse(list, 0);
+    return reversed;
 }
 
 struct expr expr_native_call(struct expr func, struct expr args) {
@@ -6,8 +6,6 @@
 #include "native.h"
 
 /* @TODO: Implement dynamic symbols */
-/* @TODO: Implement strings */
-/* @TODO: Implement floating point numbers */
 /* @TODO: Implement some sort of garbage collection for the "heap" */
 
 enum expr_type {
@@ -17,65 +15,185 @@ enum expr_type {
     EXPR_CONS,
     EXPR_SYMBOL,
     EXPR_NATIVE,
+    EXPR_CHANNEL,
+    EXPR_EXTERN,
+    EXPR_FLOAT,
+    EXPR_VECTOR,
+    EXPR_TABLE,
+    EXPR_STRING,
+    EXPR_BUILDER,
 };
 
+struct channel;
+struct extern_fn;
+struct vector;
+struct table;
+struct builder;
+
+/* Strings up to this long are stored in the expr itself */
+#define EXPR_SMALL_STRING_MAX 14
+
+/* The small_length of strings that aren't stored in the expr */
+#define EXPR_STRING_SLICE 0xff
+
 struct expr {
-    /* the goal is to keep this union to the max of 8 bytes */
     union {
-        bool boolean;
-        i64 integer;
-        /* 
-         * Pointer to the string stored in the expr arena allocator.
-         *
-         * The length of this string is stored outside of the union to bypass
-         * the padding of a struct of a pointer and a u8 inside of the union.
-         * */
-        char* symbol;
-        native_fn native;
         struct {
-            u32 car;
-            u32 cdr;
+            /* the goal is to keep this union to the max of 8 bytes */
+            union {
+                bool boolean;
+                i64 integer;
+                f64 real;
+                /* 
+                 * Pointer to the string stored in the expr arena allocator.
+                 *
+                 * The length of this string is stored outside of the union to bypass
+                 * the padding of a struct of a pointer and a u8 inside of the union.
+                 * */
+                char* symbol;
+                /* the bytes of a string that isn't small, borrowed from whatever it was sliced out of */
+                char* string;
+                native_fn native;
+                struct channel* channel; /* shared by every heap the expr gets copied into */
+                struct extern_fn* ext;   /* a C function declared with defextern */
+                struct vector* vector;   /* shared by every heap like channels, see vector.h */
+                struct table* table;     /* the same, see table.h */
+                struct builder* builder; /* the same, see builder.h */
+                struct {
+                    u32 car;
+                    u32 cdr;
+                };
+            };
+
+            union {
+                u32 offset; /* byte offset into the source, only used for exprs that come from parsing */
+                u32 size;   /* the length of a string that isn't small */
+                u32 builtin; /* where a native is in builtins plus one, 0 for natives that aren't builtins */
+            };
+
+            /* 
+             * The type shares a word with the length so lengths can be wider than a
+             * byte without growing the struct past 16 bytes. Lengths of lists longer
+             * than EXPR_LENGTH_MAX saturate at it.
+             * */
+            union {
+                struct {
+                    u32 length : 24; /* used for the length of symbols and lists */
+                    u32 type : 8;
+                };
+                struct {
+                    u32 arity : 24; /* used for the number of arguments a function or closure take */
+                    u32 : 8;
+                };
+            };
         };
-    };
-
-    struct file_location loc; /* only used for exprs that come from parsing */
-    u8 type;
 
-    union {
-        u8 length; /* used for the length of strings, symbols, and lists */
-        u8 arity; /* used for the number of arguments a function or closure take */
+        /*
+         * Small strings take up everything but the type, offset and length
+         * included, so nothing may set those on a string. Go through
+         * expr_string instead of reading either representation directly.
+         * */
+        struct {
+            char small[EXPR_SMALL_STRING_MAX];
+            u8 small_length; /* or EXPR_STRING_SLICE */
+        };
     };
-
-    /* essentially 2 free bytes if we need to store more infomation here */
-    u16 padding;
 };
 
+#define EXPR_LENGTH_MAX ((1u << 24) - 1)
+
 DYNARRAY_DECL_S(expr);
 SMAP_DECL_S(expr);
+DYNARRAY_DECL(u32);
 
-extern struct dynarray(expr) exprs;
-extern struct arena expr_arena;
+/* 
+ * Every thread has its own heap, so threads can read or build exprs without
+ * stepping on each other. Moving exprs from one heap to another is up to the
+ * caller.
+ * */
+extern __thread struct dynarray(expr) exprs;
+extern __thread struct arena expr_arena;
 
 u32 expr_box(struct expr expr);
 
+/* 
+ * Moves every cell of another thread's heap but its nil onto the end of this
+ * thread's heap and relocates the cons indices. Adding the returned base to an
+ * index into the old heap gives its index in this one. The old heap is freed.
+ * */
+u32 expr_heap_adopt(struct dynarray(expr)* heap);
+
+/* Like expr_heap_adopt, for cells laid out like a heap that aren't one */
+u32 expr_heap_copy(const struct expr* cells, u32 length);
+
 u32 expr_new();
 u32 expr_new_nil();
 u32 expr_new_boolean(bool boolean);
 u32 expr_new_integer(i64 integer);
-u32 expr_new_symbol(char* symbol, u8 length);
+u32 expr_new_symbol(char* symbol, u32 length);
 u32 expr_new_cons(u32 car, u32 cdr);
 u32 expr_new_native(native_fn fn, u8 arity);
+u32 expr_new_channel(struct channel* channel);
+u32 expr_new_extern(struct extern_fn* ext);
+u32 expr_new_float(f64 real);
+u32 expr_new_vector(struct vector* vector);
+u32 expr_new_table(struct table* table);
+u32 expr_new_string(const char* text, u32 length);
+u32 expr_new_builder(struct builder* builder);
 
 struct expr expr_create();
 struct expr expr_create_nil();
 struct expr expr_create_boolean(bool boolean);
 struct expr expr_create_integer(i64 integer);
-struct expr expr_create_symbol(char* symbol, u8 length);
+struct expr expr_create_symbol(char* symbol, u32 length);
 struct expr expr_create_cons(u32 car, u32 cdr);
 struct expr expr_create_native(native_fn fn, u8 arity);
+struct expr expr_create_channel(struct channel* channel);
+struct expr expr_create_extern(struct extern_fn* ext);
+struct expr expr_create_float(f64 real);
+struct expr expr_create_vector(struct vector* vector);
+struct expr expr_create_table(struct table* table);
+struct expr expr_create_builder(struct builder* builder);
+
+/* Copies text into the expr arena unless it's small enough to go in the expr */
+struct expr expr_create_string(const char* text, u32 length);
+
+/* Points at text unless it's small, so text has to outlive the string */
+struct expr expr_create_string_borrowed(char* text, u32 length);
+
+/*
+ * The bytes of a string. Small ones live in the expr itself, so the slice is
+ * only good for as long as *expr doesn't move, which for an expr on the heap
+ * means until the heap next grows.
+ * */
+static inline struct slice(char) expr_string(struct expr* expr) {
+    if (expr->small_length == EXPR_STRING_SLICE) return (struct slice(char)){expr->string, expr->size};
+    return (struct slice(char)){expr->small, expr->small_length};
+}
+
+/*
+ * Indices with the top bit set are cells of the one heap the whole process
+ * shares, the rest of the bits split into a page and a cell in it. Its pages
+ * never move and its cells never change once a value is in there, so any
+ * thread can read them straight out of any heap. Only shared.c puts values in
+ * it, see shared.h for how long they last.
+ * */
+#define EXPR_SHARED_BIT (1u << 31)
+#define EXPR_SHARED_PAGE_BITS 12
+#define EXPR_SHARED_PAGE_CELLS (1u << EXPR_SHARED_PAGE_BITS)
+#define EXPR_SHARED_PAGES (1u << (31 - EXPR_SHARED_PAGE_BITS))
+
+extern struct expr* expr_shared_pages[EXPR_SHARED_PAGES];
+
+static inline struct expr* expr_cell(u32 ptr) {
+    if (!(ptr & EXPR_SHARED_BIT)) return &exprs.at[ptr];
+
+    ptr &= ~EXPR_SHARED_BIT;
+    return &expr_shared_pages[ptr >> EXPR_SHARED_PAGE_BITS][ptr & (EXPR_SHARED_PAGE_CELLS - 1)];
+}
 
 /* Takes an index (pointer) into the expr array and returns the associated expr */
-#define EXPR(ptr) exprs.at[(ptr)]
+#define EXPR(ptr) (*expr_cell(ptr))
 
 #define CAR(e) EXPR((e).car)
 #define CDR(e) EXPR((e).cdr)
@@ -86,6 +204,19 @@ u8 integerp(struct expr expr);
 u8 symbolp(struct expr expr);
 u8 consp(struct expr expr);
 u8 nativep(struct expr expr);
+u8 channelp(struct expr expr);
+u8 externp(struct expr expr);
+u8 floatp(struct expr expr);
+u8 vectorp(struct expr expr);
+u8 tablep(struct expr expr);
+u8 stringp(struct expr expr);
+u8 builderp(struct expr expr);
+
+/* Longest a float can get written out, nul included */
+#define EXPR_FLOAT_TEXT_MAX 32
+
+/* Writes real the way it's printed and returns how long that is */
+u32 expr_format_float(char* buffer, usize size, f64 real);
 
 void expr_fprint(FILE* stream, struct expr expr);
 void expr_fprintln(FILE* stream, struct expr expr);
@@ -94,7 +225,7 @@ void expr_println(struct expr expr);
 
 bool expr_is_truthy(struct expr expr);
 
-u8 expr_cons_length(struct expr expr);
+u32 expr_cons_length(struct expr expr);
 u32 expr_cons_append(u32 list, struct expr expr);
 u32 expr_cons_reverse(u32 list);
 
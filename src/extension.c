@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include <dlfcn.h>
+
+#include "extension.h"
+#include "vm.h"
+
+#define EXTENSION_PATH_CAP 4096
+
+struct expr extension_load(struct vm* vm, struct slice(char) path) {
+    const struct hoax_extension* table;
+    hoax_extension_entry_fn entry;
+    char buffer[EXTENSION_PATH_CAP];
+    void* handle;
+    u32 i;
+
+    if (path.length >= EXTENSION_PATH_CAP) {
+        fprintf(stderr, "error: the extension path %.*s is too long\n", STRINGF(path));
+        return expr_create_nil();
+    }
+
+    memcpy(buffer, path.ptr, path.length);
+    buffer[path.length] = '\0';
+
+    /* loading the same object again just hands back the same handle */
+    handle = dlopen(buffer, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        fprintf(stderr, "error: failed to load %s: %s\n", buffer, dlerror());
+        return expr_create_nil();
+    }
+
+    /* dlsym hands back a void*, and C99 has no cast from that to a function pointer */
+    *(void**)&entry = dlsym(handle, HOAX_EXTENSION_ENTRY);
+    if (!entry) {
+        fprintf(stderr, "error: %s has no %s\n", buffer, HOAX_EXTENSION_ENTRY);
+        dlclose(handle);
+        return expr_create_nil();
+    }
+
+    table = entry();
+    if (!table || table->abi != HOAX_EXTENSION_ABI) {
+        fprintf(stderr, "error: %s was built for ABI version %u, this is version %u\n",
+                buffer, table ? table->abi : 0, HOAX_EXTENSION_ABI);
+        dlclose(handle);
+        return expr_create_nil();
+    }
+
+    for (i = 0; i < table->count; ++i) {
+        vm_set_global(vm, STRING((char*)table->natives[i].name),
+                      expr_create_native(table->natives[i].fn, table->natives[i].arity));
+    }
+
+    return expr_create_integer(table->count);
+}
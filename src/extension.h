@@ -0,0 +1,63 @@
+#ifndef __EXTENSION_H
+#define __EXTENSION_H
+
+#include "common.h"
+#include "expr.h"
+#include "native.h"
+
+/*
+ * Natives living in a shared object of their own, loaded at runtime with
+ * (#load-native path/to/libfoo.so).
+ *
+ * An extension exports one function under HOAX_EXTENSION_ENTRY which returns
+ * a table of its natives. The table is checked against the ABI version the
+ * interpreter was built with before anything in it is bound, so an extension
+ * built against an older layout gets refused instead of crashing.
+ *
+ *     static const struct hoax_extension_native natives[] = {
+ *         {"#fib", 1, native_fib},
+ *     };
+ *
+ *     static const struct hoax_extension table = {
+ *         HOAX_EXTENSION_ABI, sizeof(natives) / sizeof(natives[0]), natives,
+ *     };
+ *
+ *     const struct hoax_extension* hoax_native_register_v1(void) {
+ *         return &table;
+ *     }
+ *
+ * Extensions call back into the interpreter (CAR, expr_create_integer, etc.)
+ * through the symbols the executable exports, so it has to be linked with
+ * -rdynamic. Names and functions are used as they are, which is why a loaded
+ * extension is never unloaded.
+ * */
+
+/* Bumped whenever the layout of the table or of struct expr changes */
+#define HOAX_EXTENSION_ABI 1
+
+#define HOAX_EXTENSION_ENTRY "hoax_native_register_v1"
+
+struct hoax_extension_native {
+    const char* name;
+    u8 arity;
+    native_fn fn;
+};
+
+struct hoax_extension {
+    u32 abi;
+    u32 count;
+    const struct hoax_extension_native* natives;
+};
+
+typedef const struct hoax_extension* (*hoax_extension_entry_fn)(void);
+
+struct vm;
+
+/*
+ * Loads the shared object at path and binds every native in its table as a
+ * global of vm. Returns how many were bound, or nil after printing why the
+ * extension could not be loaded.
+ * */
+struct expr extension_load(struct vm* vm, struct slice(char) path);
+
+#endif  /*__EXTENSION_H*/
@@ -0,0 +1,209 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <dlfcn.h>
+
+#include "extern.h"
+#include "vector.h"
+#include "vm.h"
+
+#include "extern_stubs.h"
+
+#define EXTERN_NAME_CAP 256
+
+/* Room for the nul-terminated copies of the symbols passed to one call */
+#define EXTERN_SCRATCH_CAP KILOBYTES(1)
+
+/* The copies one call makes, the ones too long for text get their own allocation */
+struct extern_scratch {
+    char text[EXTERN_SCRATCH_CAP];
+    usize used;
+    char* allocated[EXTERN_INTS_MAX];
+    u32 allocations;
+};
+
+bool extern_parse_type(struct slice(char) name, u8* type) {
+    static const struct {
+        const char* name;
+        u8 type;
+    } types[] = {
+        {"void",   EXTERN_VOID},
+        {"int",    EXTERN_INT},
+        {"long",   EXTERN_LONG},
+        {"ptr",    EXTERN_PTR},
+        {"double", EXTERN_DOUBLE},
+    };
+    u32 i;
+
+    for (i = 0; i < sizeof(types) / sizeof(types[0]); ++i) {
+        if (name.length == strlen(types[i].name) && memcmp(name.ptr, types[i].name, name.length) == 0) {
+            *type = types[i].type;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static u8 extern_return_kind(u8 type) {
+    switch ((enum extern_type)type) {
+        case EXTERN_VOID:   return EXTERN_RETURN_VOID;
+        case EXTERN_INT:    return EXTERN_RETURN_INT;
+        case EXTERN_LONG:
+        case EXTERN_PTR:    return EXTERN_RETURN_LONG;
+        case EXTERN_DOUBLE: return EXTERN_RETURN_DOUBLE;
+    }
+
+    assert(0 && "Not an extern type");
+    return EXTERN_RETURN_VOID;
+}
+
+struct extern_fn* extern_create(struct slice(char) name, const u8* types, u8 arity, u8 ret) {
+    struct extern_fn* ext;
+    char buffer[EXTERN_NAME_CAP];
+    void* fn;
+    u8 ints = 0, doubles = 0;
+    u8 i;
+
+    if (name.length >= EXTERN_NAME_CAP) {
+        fprintf(stderr, "error: the extern name %.*s is too long\n", STRINGF(name));
+        return NULL;
+    }
+
+    memcpy(buffer, name.ptr, name.length);
+    buffer[name.length] = '\0';
+
+    dlerror();
+    fn = dlsym(RTLD_DEFAULT, buffer);
+    if (!fn) {
+        fprintf(stderr, "error: failed to find the extern %s\n", buffer);
+        return NULL;
+    }
+
+    ext = arena_alloc(&expr_arena, sizeof(*ext));
+    ext->fn = fn;
+    ext->arity = arity;
+    ext->ret = ret;
+
+    for (i = 0; i < arity; ++i) {
+        ext->types[i] = types[i];
+        ext->slots[i] = types[i] == EXTERN_DOUBLE ? doubles++ : ints++;
+
+        if (ints > EXTERN_INTS_MAX || doubles > EXTERN_DOUBLES_MAX) {
+            fprintf(stderr, "error: the extern %s takes more than %d integer or %d double arguments\n",
+                    buffer, EXTERN_INTS_MAX, EXTERN_DOUBLES_MAX);
+            return NULL;
+        }
+    }
+
+    ext->stub = extern_stubs[extern_return_kind(ret)][ints][doubles];
+
+    /* the name is borrowed from the source, which can go away before the extern does */
+    ext->name.ptr = arena_alloc(&expr_arena, name.length);
+    ext->name.length = name.length;
+    memcpy(ext->name.ptr, name.ptr, name.length);
+
+    return ext;
+}
+
+/*
+ * Symbols and strings aren't nul-terminated, so C gets a copy that lives until
+ * the call returns. False if arg is nothing a pointer can be made of.
+ * */
+static bool extern_pointer(struct expr arg, i64* pointer, struct extern_scratch* scratch) {
+    struct slice(char) text;
+    char* copy;
+
+    switch (arg.type) {
+        case EXPR_NIL:
+            *pointer = 0;
+            return true;
+        case EXPR_INTEGER:
+            *pointer = arg.integer;
+            return true;
+        case EXPR_VECTOR:
+            *pointer = (i64)(uintptr_t)arg.vector->data;
+            return true;
+        case EXPR_SYMBOL:
+        case EXPR_STRING:
+            text = symbolp(arg) ? (struct slice(char)){arg.symbol, arg.length} : expr_string(&arg);
+            if (scratch->used + text.length + 1 <= EXTERN_SCRATCH_CAP) {
+                copy = scratch->text + scratch->used;
+                scratch->used += text.length + 1;
+            } else {
+                /* every ptr takes an integer slot, so there's always room to remember it */
+                copy = malloc(text.length + 1);
+                assert(copy);
+                scratch->allocated[scratch->allocations++] = copy;
+            }
+
+            memcpy(copy, text.ptr, text.length);
+            copy[text.length] = '\0';
+            *pointer = (i64)(uintptr_t)copy;
+            return true;
+    }
+
+    return false;
+}
+
+struct expr extern_call(struct vm* vm, const struct extern_fn* fn) {
+    i64 ints[EXTERN_INTS_MAX];
+    f64 doubles[EXTERN_DOUBLES_MAX];
+    struct extern_scratch scratch;
+    union extern_value value;
+    struct expr arg;
+    i32 i;
+
+    scratch.used = 0;
+    scratch.allocations = 0;
+
+    /* the last argument is on top */
+    for (i = fn->arity - 1; i >= 0; --i) {
+        arg = vm_pop(vm);
+
+        switch ((enum extern_type)fn->types[i]) {
+            case EXTERN_INT:
+            case EXTERN_LONG:
+                assert(integerp(arg));
+                ints[fn->slots[i]] = arg.integer;
+                break;
+            case EXTERN_PTR:
+                if (extern_pointer(arg, &ints[fn->slots[i]], &scratch)) break;
+
+                fprintf(stderr, "error: argument %d of the extern %.*s is a ptr, "
+                        "which takes nil, an integer, a vector, a symbol or a string, not: ",
+                        i + 1, STRINGF(fn->name));
+                expr_fprintln(stderr, arg);
+
+                /* the function isn't called, but its other arguments still come off the stack */
+                while (i-- > 0) vm_pop(vm);
+                while (scratch.allocations > 0) free(scratch.allocated[--scratch.allocations]);
+                return expr_create_nil();
+            case EXTERN_DOUBLE:
+                assert(integerp(arg) || floatp(arg));
+                doubles[fn->slots[i]] = floatp(arg) ? arg.real : (f64)arg.integer;
+                break;
+            case EXTERN_VOID:
+                assert(0 && "Arguments can't be void");
+        }
+    }
+
+    value = fn->stub(fn->fn, ints, doubles);
+
+    while (scratch.allocations > 0) free(scratch.allocated[--scratch.allocations]);
+
+    switch ((enum extern_type)fn->ret) {
+        case EXTERN_VOID:
+            return expr_create_nil();
+        case EXTERN_INT:
+            return expr_create_integer((i32)value.integer);
+        case EXTERN_LONG:
+        case EXTERN_PTR:
+            return expr_create_integer(value.integer);
+        case EXTERN_DOUBLE:
+            return expr_create_float(value.real);
+    }
+
+    assert(0 && "Not an extern type");
+    return expr_create_nil();
+}
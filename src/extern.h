@@ -0,0 +1,91 @@
+#ifndef __EXTERN_H
+#define __EXTERN_H
+
+#include "common.h"
+#include "expr.h"
+
+/*
+ * C functions called straight from Hoax, declared with
+ *
+ *     (defextern strlen (ptr) long)
+ *     (defextern getpid () int)
+ *
+ * The symbol is looked up with dlsym when the form is compiled, so only
+ * functions of the executable and the libraries it links against are found.
+ *
+ * Calls go through a stub made ahead of time for every signature class: how
+ * many integer and double arguments there are and what comes back. Integer
+ * and floating point arguments travel in separate registers in the calling
+ * conventions we run on, so the order they are declared in doesn't matter and
+ * every signature of a class shares one stub. Declaring a function picks its
+ * stub once, and a call is just moving the arguments off the stack.
+ *
+ * Arguments:
+ *      int, long => an integer
+ *      ptr       => a string or symbol, passed as a nul-terminated copy that
+ *                   only lives for the call, a vector, passed as its data, an
+ *                   integer address, or nil for NULL
+ *      double    => a float, or an integer converted
+ *
+ * Returns:
+ *      int, long, ptr => an integer
+ *      double         => a float
+ *      void           => nil
+ *
+ * Variadic functions like printf are not supported.
+ * */
+
+#define EXTERN_INTS_MAX 6
+#define EXTERN_DOUBLES_MAX 4
+#define EXTERN_ARGS_MAX (EXTERN_INTS_MAX + EXTERN_DOUBLES_MAX)
+
+enum extern_type {
+    EXTERN_VOID,
+    EXTERN_INT,
+    EXTERN_LONG,
+    EXTERN_PTR,
+    EXTERN_DOUBLE,
+};
+
+/* How a stub has to read what the function left behind */
+enum extern_return {
+    EXTERN_RETURN_VOID,
+    EXTERN_RETURN_INT,  /* only the low 32 bits of the register are set */
+    EXTERN_RETURN_LONG, /* longs and pointers */
+    EXTERN_RETURN_DOUBLE,
+    EXTERN_RETURN_COUNT,
+};
+
+union extern_value {
+    i64 integer;
+    f64 real;
+};
+
+typedef union extern_value (*extern_stub)(void* fn, const i64* ints, const f64* doubles);
+
+struct extern_fn {
+    void* fn;
+    extern_stub stub;
+    struct slice(char) name;
+    u8 arity;
+    u8 ret;
+    u8 types[EXTERN_ARGS_MAX];
+    u8 slots[EXTERN_ARGS_MAX]; /* where each argument goes in ints or doubles */
+};
+
+struct vm;
+
+/* Returns false if name is not one of the types above */
+bool extern_parse_type(struct slice(char) name, u8* type);
+
+/*
+ * Looks up name and picks the stub for its signature. The result lives in the
+ * thread's expr arena. Returns NULL after printing why if the symbol can't be
+ * found or the signature has too many arguments of one kind.
+ * */
+struct extern_fn* extern_create(struct slice(char) name, const u8* types, u8 arity, u8 ret);
+
+/* Pops the arguments of fn off the vm's stack and calls it */
+struct expr extern_call(struct vm* vm, const struct extern_fn* fn);
+
+#endif  /*__EXTERN_H*/
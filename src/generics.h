@@ -170,6 +170,19 @@
         }                                                               \
     } while (0)
 
+/* Makes room for at least n more elements without reallocating along the way */
+#define DYNARRAY_RESERVE(T, da, n)                                      \
+    do {                                                                \
+        if ((da)->length + (n) > (da)->capacity) {                      \
+            if ((da)->capacity == 0) (da)->capacity = 4;                \
+            while ((da)->length + (n) > (da)->capacity) {               \
+                (da)->capacity *= 2;                                    \
+            }                                                           \
+            (da)->at = realloc((da)->at, sizeof(T) * (da)->capacity);   \
+            assert((da)->at);                                           \
+        }                                                               \
+    } while (0)
+
 #define DYNARRAY_CLEAR(da) (da)->length = 0
 
 #define DYNARRAY_FREE(da) do { DYNARRAY_CLEAR(da); free((da)->at); } while (0)
@@ -412,6 +425,9 @@
  * having a string hashmap would be much simpler to implement and is more commonly
  * used. If we need a different key type for a hashmap for whatever reason, it
  * would probably be best to use a different hashmap implementation all together.
+ *
+ * A map doubles its slots whenever a put would leave it more than half full,
+ * so lookups stay O(1) however many keys go in.
  * */
 
 #define SMAP_DEFAULT_SIZE (1024)
@@ -428,6 +444,7 @@
     struct smap(T) {\
         struct smap_slot(T)* slots;\
         u64 size;\
+        u64 count;\
     };\
     struct smap(T) smap__##T##_create(u64 map_size);\
     void smap__##T##_init(struct smap(T)*, u64 map_size);\
@@ -440,6 +457,7 @@
     struct smap(T) {\
         struct smap_slot(T)* slots;\
         u64 size;\
+        u64 count;\
     };\
     struct smap(T) smap__##T##_create(u64 map_size);\
     void smap__##T##_init(struct smap(T)*, u64 map_size);\
@@ -454,6 +472,7 @@
     }\
     void smap__##T##_init(struct smap(T)* map, u64 map_size) {\
         map->size = map_size;\
+        map->count = 0;\
         map->slots = calloc(map->size, sizeof(struct smap_slot(T)));\
         assert(map->slots);\
     }\
@@ -473,16 +492,31 @@
         if (!slot.occupied) return OPTION_NONE(T);\
         return OPTION_SOME(T, slot.value);\
     }\
+    static void smap__##T##_grow(struct smap(T)* map) {\
+        struct smap(T) old = *map;\
+        u64 hash, i;\
+        smap__##T##_init(map, old.size * 2);\
+        map->count = old.count;\
+        for (i = 0; i < old.size; ++i) {\
+            if (!old.slots[i].occupied) continue;\
+            hash = SMAP_COMPUTE_HASH(map, old.slots[i].key);\
+            while (map->slots[hash].occupied) hash = (hash + 1) % map->size;\
+            map->slots[hash] = old.slots[i];\
+        }\
+        free(old.slots);\
+    }\
     struct option(T) smap__##T##_put(struct smap(T)* map, struct slice(char) key, T value) {\
         u64 hash;\
         struct option(T) old_value;\
         if (map->size == 0) smap__##T##_init(map, SMAP_DEFAULT_SIZE);\
+        if ((map->count + 1) * 2 > map->size) smap__##T##_grow(map);\
         old_value = OPTION_NONE(T);\
         hash = SMAP_COMPUTE_HASH(map, key);\
         if (!map->slots[hash].occupied) {\
             map->slots[hash].key = key;\
             map->slots[hash].value = value;\
             map->slots[hash].occupied = true;\
+            map->count += 1;\
         } else {\
             while (map->slots[hash].occupied && !string_equal(key, map->slots[hash].key)) {\
                 hash += 1;\
@@ -492,6 +526,7 @@
                 map->slots[hash].key = key;\
                 map->slots[hash].value = value;\
                 map->slots[hash].occupied = true;\
+                map->count += 1;\
             } else {\
                 old_value = OPTION_SOME(T, map->slots[hash].value);\
                 map->slots[hash].value = value;\
@@ -508,6 +543,7 @@
     }\
     void smap__##T##_init(struct smap(T)* map, u64 map_size) {\
         map->size = map_size;\
+        map->count = 0;\
         map->slots = calloc(map->size, sizeof(struct smap_slot(T)));\
         assert(map->slots);\
     }\
@@ -527,16 +563,31 @@
         if (!slot.occupied) return OPTION_NONE(T);\
         return OPTION_SOME(T, slot.value);\
     }\
+    static void smap__##T##_grow(struct smap(T)* map) {\
+        struct smap(T) old = *map;\
+        u64 hash, i;\
+        smap__##T##_init(map, old.size * 2);\
+        map->count = old.count;\
+        for (i = 0; i < old.size; ++i) {\
+            if (!old.slots[i].occupied) continue;\
+            hash = SMAP_COMPUTE_HASH(map, old.slots[i].key);\
+            while (map->slots[hash].occupied) hash = (hash + 1) % map->size;\
+            map->slots[hash] = old.slots[i];\
+        }\
+        free(old.slots);\
+    }\
     struct option(T) smap__##T##_put(struct smap(T)* map, struct slice(char) key, struct T value) {\
         u64 hash;\
         struct option(T) old_value;\
         if (map->size == 0) smap__##T##_init(map, SMAP_DEFAULT_SIZE);\
+        if ((map->count + 1) * 2 > map->size) smap__##T##_grow(map);\
         old_value = OPTION_NONE(T);\
         hash = SMAP_COMPUTE_HASH(map, key);\
         if (!map->slots[hash].occupied) {\
             map->slots[hash].key = key;\
             map->slots[hash].value = value;\
             map->slots[hash].occupied = true;\
+            map->count += 1;\
         } else {\
             while (map->slots[hash].occupied && !string_equal(key, map->slots[hash].key)) {\
                 hash += 1;\
@@ -546,6 +597,7 @@
                 map->slots[hash].key = key;\
                 map->slots[hash].value = value;\
                 map->slots[hash].occupied = true;\
+                map->count += 1;\
             } else {\
                 old_value = OPTION_SOME(T, map->slots[hash].value);\
                 map->slots[hash].value = value;\
@@ -557,6 +609,13 @@
 #define SMAP_DESTROY(smap) do {\
     free((smap)->slots);\
     (smap)->size = 0;\
+    (smap)->count = 0;\
+} while (0)
+
+/* Empties the map but keeps its slots, only touching them if something is in there */
+#define SMAP_CLEAR(smap) do {\
+    if ((smap)->count > 0) memset((smap)->slots, 0, sizeof(*(smap)->slots) * (smap)->size);\
+    (smap)->count = 0;\
 } while (0)
 
 #define SMAP_COMPUTE_HASH(smap, key) string_hash(key) % (smap)->size
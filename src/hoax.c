@@ -0,0 +1,141 @@
+#include <stdio.h>
+
+#include "hoax.h"
+#include "compiler.h"
+#include "reader.h"
+#include "vm.h"
+
+struct hoax {
+    struct vm vm;
+};
+
+struct hoax_program {
+    struct module module;
+};
+
+struct hoax_shared {
+    struct shared_env env;
+};
+
+struct hoax* hoax_create(void) {
+    struct hoax* hoax = calloc(1, sizeof(struct hoax));
+    assert(hoax);
+
+    vm_init(&hoax->vm);
+
+    return hoax;
+}
+
+void hoax_destroy(struct hoax* hoax) {
+    vm_destroy(&hoax->vm);
+    free(hoax);
+}
+
+/* Global names live as long as the instance does, so they go in its arena */
+static struct slice(char) hoax_name(const char* name) {
+    usize length = strlen(name);
+    char* copy = arena_alloc(&expr_arena, length);
+
+    memcpy(copy, name, length);
+
+    return (struct slice(char)){copy, length};
+}
+
+struct hoax_program* hoax_compile(struct hoax* hoax, const char* src, usize length) {
+    struct hoax_program* program = calloc(1, sizeof(struct hoax_program));
+    struct compiler compiler = {0};
+    u8 ret;
+
+    assert(program);
+
+    hoax_enter(hoax);
+
+    /* the reader only reads src, it copies symbols into the arena */
+    compiler_init(&compiler, reader_create((struct slice(char)){(char*)src, length}), &program->module);
+    ret = compile(&compiler);
+    compiler_destroy(&compiler);
+
+    hoax_leave(hoax);
+
+    if (ret != COMPILE_OK) {
+        hoax_program_destroy(program);
+        return NULL;
+    }
+
+    return program;
+}
+
+void hoax_program_destroy(struct hoax_program* program) {
+    module_destroy(&program->module);
+    free(program);
+}
+
+struct expr hoax_run(struct hoax* hoax, struct hoax_program* program) {
+    struct expr expr;
+
+    hoax_enter(hoax);
+    expr = vm_run(&hoax->vm, &program->module);
+    hoax_leave(hoax);
+
+    return expr;
+}
+
+struct expr hoax_eval(struct hoax* hoax, const char* src, usize length) {
+    struct hoax_program* program;
+    struct expr expr;
+
+    program = hoax_compile(hoax, src, length);
+    if (!program) return expr_create_nil();
+
+    expr = hoax_run(hoax, program);
+    hoax_program_destroy(program);
+
+    return expr;
+}
+
+struct expr hoax_get_global(struct hoax* hoax, const char* name) {
+    struct expr expr;
+
+    /* shared values get pinned for the instance rather than the calling thread */
+    hoax_enter(hoax);
+    expr = vm_get_global(&hoax->vm, (struct slice(char)){(char*)name, strlen(name)});
+    hoax_leave(hoax);
+
+    return expr;
+}
+
+void hoax_set_global(struct hoax* hoax, const char* name, struct expr value) {
+    hoax_enter(hoax);
+    vm_set_global(&hoax->vm, hoax_name(name), value);
+    hoax_leave(hoax);
+}
+
+struct hoax_shared* hoax_shared_create(void) {
+    struct hoax_shared* shared = malloc(sizeof(struct hoax_shared));
+    assert(shared);
+
+    shared_env_init(&shared->env);
+
+    return shared;
+}
+
+void hoax_shared_destroy(struct hoax_shared* shared) {
+    shared_env_destroy(&shared->env);
+    free(shared);
+}
+
+void hoax_share_globals(struct hoax* hoax, struct hoax_shared* shared) {
+    hoax->vm.shared = shared ? &shared->env : NULL;
+}
+
+void hoax_register_native(struct hoax* hoax, const char* name, native_fn fn, u8 arity) {
+    hoax_set_global(hoax, name, expr_create_native(fn, arity));
+}
+
+void hoax_enter(struct hoax* hoax) {
+    isolate_enter(&hoax->vm.isolate);
+}
+
+void hoax_leave(struct hoax* hoax) {
+    isolate_leave(&hoax->vm.isolate);
+}
@@ -0,0 +1,71 @@
+#ifndef __HOAX_H
+#define __HOAX_H
+
+#include "common.h"
+#include "expr.h"
+#include "native.h"
+
+/*
+ * The embedding API.
+ *
+ * Every struct hoax is an isolated interpreter with its own heap, symbols, and
+ * globals, so separate instances can run on separate threads at the same time
+ * without any locking between them. A single instance must only be used from
+ * one thread at a time, though which thread can change between calls.
+ *
+ * Integers, booleans, and nil returned by the API are plain values. Conses are
+ * indices into the heap of the instance they came from, so walking them with
+ * CAR() and CDR() only works inside a native or between hoax_enter and
+ * hoax_leave.
+ * */
+
+struct hoax;
+struct hoax_program;
+struct hoax_shared;
+
+struct hoax* hoax_create(void);
+void hoax_destroy(struct hoax* hoax);
+
+/* 
+ * Compiles every top-level form of src. Symbols are copied out of src, so it
+ * can be freed afterwards. Returns NULL after printing the error if src fails
+ * to read or compile.
+ * */
+struct hoax_program* hoax_compile(struct hoax* hoax, const char* src, usize length);
+void hoax_program_destroy(struct hoax_program* program);
+
+/* Runs a program compiled by the same instance, returning its last value */
+struct expr hoax_run(struct hoax* hoax, struct hoax_program* program);
+
+/* Compiles and runs src in one go, nil if it fails to compile */
+struct expr hoax_eval(struct hoax* hoax, const char* src, usize length);
+
+struct expr hoax_get_global(struct hoax* hoax, const char* name);
+void hoax_set_global(struct hoax* hoax, const char* name, struct expr value);
+
+/*
+ * Globals that several instances can read at once without locking, paid for
+ * once per process instead of once per instance. Instances read values where
+ * they sit without copying them, and a value read stays good until the next
+ * hoax_run of the instance returns, even if it gets replaced or the globals
+ * destroyed meanwhile. Whatever its globals keep of it is copied into its own
+ * heap by then, and a run's result stays good until the run after it returns.
+ * */
+struct hoax_shared* hoax_shared_create(void);
+void hoax_shared_destroy(struct hoax_shared* shared);
+
+/*
+ * Makes every defvar of the instance go to shared, and globals it can't find
+ * in its own get looked up there. Pass NULL to stop sharing. Globals set with
+ * hoax_set_global stay private and shadow shared ones.
+ * */
+void hoax_share_globals(struct hoax* hoax, struct hoax_shared* shared);
+
+/* Binds fn as a global, natives get their arguments as a list */
+void hoax_register_native(struct hoax* hoax, const char* name, native_fn fn, u8 arity);
+
+/* Makes the instance's heap the one EXPR() and friends see on this thread */
+void hoax_enter(struct hoax* hoax);
+void hoax_leave(struct hoax* hoax);
+
+#endif  /*__HOAX_H*/
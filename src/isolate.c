@@ -0,0 +1,56 @@
+#include "isolate.h"
+
+__thread struct isolate* current_isolate = NULL;
+
+void isolate_enter(struct isolate* isolate) {
+    if (current_isolate == isolate) {
+        isolate->depth += 1;
+        return;
+    }
+
+    /* its heap is parked in some other isolate while it's an outer one */
+    assert(isolate->depth == 0 && "isolate is already entered");
+
+    isolate->outer = current_isolate;
+    isolate->outer_exprs = exprs;
+    isolate->outer_arena = expr_arena;
+    isolate->depth = 1;
+
+    exprs = isolate->exprs;
+    expr_arena = isolate->expr_arena;
+    current_isolate = isolate;
+
+    if (exprs.length == 0) expr_new_nil();
+}
+
+void isolate_leave(struct isolate* isolate) {
+    assert(current_isolate == isolate && isolate->depth > 0);
+
+    if (--isolate->depth > 0) return;
+
+    isolate->exprs = exprs;
+    isolate->expr_arena = expr_arena;
+
+    exprs = isolate->outer_exprs;
+    expr_arena = isolate->outer_arena;
+    current_isolate = isolate->outer;
+
+    isolate->outer = NULL;
+    isolate->outer_exprs = (struct dynarray(expr)){0};
+    isolate->outer_arena = (struct arena){0};
+}
+
+void isolate_destroy(struct isolate* isolate) {
+    assert(isolate->depth == 0);
+
+    DYNARRAY_FREE(&isolate->exprs);
+    isolate->exprs = (struct dynarray(expr)){0};
+    arena_destroy(&isolate->expr_arena);
+
+    if (isolate->pin) epoch_unpin(isolate->pin);
+    if (isolate->held) epoch_unpin(isolate->held);
+    isolate->pin = NULL;
+    isolate->held = NULL;
+    isolate->pinned = false;
+    isolate->holding = false;
+}
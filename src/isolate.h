@@ -0,0 +1,47 @@
+#ifndef __ISOLATE_H
+#define __ISOLATE_H
+
+#include "common.h"
+#include "arena.h"
+#include "epoch.h"
+#include "expr.h"
+
+/*
+ * The heap and symbol arena of one interpreter. Every struct vm owns one.
+ *
+ * Code that works with exprs goes through the thread's exprs and expr_arena,
+ * so EXPR() stays a plain index. Entering an isolate moves its heap into those
+ * slots and parks whatever the thread had there; leaving moves both back.
+ *
+ * An isolate can be entered by one thread at a time. Entering the isolate the
+ * thread is already in just nests, so code running inside a vm (natives
+ * included) can call back into the API freely.
+ * */
+struct isolate {
+    struct dynarray(expr) exprs;
+    struct arena expr_arena;
+
+    /* what the thread had before entering, while entered */
+    struct isolate* outer;
+    struct dynarray(expr) outer_exprs;
+    struct arena outer_arena;
+    u32 depth;
+
+    /* keep the shared values its heap may point at alive, see shared.h */
+    struct epoch_record* pin;  /* for the values read since the last release, while pinned */
+    struct epoch_record* held; /* for the ones behind the last result, while holding */
+    bool pinned;
+    bool holding;
+};
+
+/* The isolate the current thread is in, NULL if it's in none */
+extern __thread struct isolate* current_isolate;
+
+/* Makes the isolate's heap the thread's heap, the heap always starts with nil */
+void isolate_enter(struct isolate* isolate);
+void isolate_leave(struct isolate* isolate);
+
+/* Frees the heap and symbols of an isolate nobody is in, and drops its pin */
+void isolate_destroy(struct isolate* isolate);
+
+#endif  /*__ISOLATE_H*/
@@ -0,0 +1,296 @@
+#include "list.h"
+#include "builtin.h"
+
+/* Runs this short get an insertion sort before the merging starts */
+#define SORT_RUN 16
+
+/* What a list being sorted holds, lists of nothing but integers get the radix sort */
+enum sort_kind {
+    SORT_INTEGERS,
+    SORT_NUMBERS,
+    SORT_STRINGS,
+    SORT_SYMBOLS,
+};
+
+struct radix_item {
+    u64 key;
+    u32 car;
+};
+
+u32 list_length(u32 list) {
+    u32 length = 0;
+
+    for (; consp(EXPR(list)); list = EXPR(list).cdr) length += 1;
+
+    return length;
+}
+
+u32 list_append(u32 a, u32 b) {
+    u32 head = 0, tail = 0;
+    u32 cell;
+
+    for (; consp(EXPR(a)); a = EXPR(a).cdr) {
+        /* making the cell can move the heap, so the tail is looked up after */
+        cell = expr_new_cons(EXPR(a).car, 0);
+
+        if (tail) EXPR(tail).cdr = cell;
+        else head = cell;
+
+        tail = cell;
+    }
+
+    if (!tail) return b;
+
+    EXPR(tail).cdr = b;
+
+    return head;
+}
+
+u32 list_reverse(u32 list) {
+    u32 reversed = 0;
+
+    for (; consp(EXPR(list)); list = EXPR(list).cdr) reversed = expr_new_cons(EXPR(list).car, reversed);
+
+    return reversed;
+}
+
+struct expr list_nth(u32 list, u64 n) {
+    for (; consp(EXPR(list)); list = EXPR(list).cdr, --n) {
+        if (n == 0) return CAR(EXPR(list));
+    }
+
+    return expr_create_nil();
+}
+
+struct expr list_last(u32 list) {
+    u32 last = 0;
+
+    for (; consp(EXPR(list)); list = EXPR(list).cdr) last = list;
+
+    return last ? CAR(EXPR(last)) : expr_create_nil();
+}
+
+struct vector* list_to_vector(u32 list) {
+    struct vector* vector;
+    struct expr element;
+    bool reals = false;
+    usize length = 0;
+    usize i;
+    u32 cell;
+
+    for (cell = list; consp(EXPR(cell)); cell = EXPR(cell).cdr) {
+        element = CAR(EXPR(cell));
+        assert((integerp(element) || floatp(element)) && "#list->vector: takes lists of numbers");
+
+        reals |= floatp(element);
+        length += 1;
+    }
+
+    vector = vector_create(reals ? VECTOR_F64 : VECTOR_I64, length);
+
+    for (i = 0, cell = list; i < length; ++i, cell = EXPR(cell).cdr) {
+        element = CAR(EXPR(cell));
+
+        if (!reals) vector->integers[i] = element.integer;
+        else vector->reals[i] = floatp(element) ? element.real : (f64)element.integer;
+    }
+
+    return vector;
+}
+
+u32 list_filter(u32 list, struct expr pred) {
+    u32 head = 0, tail = 0;
+    u32 cell;
+    bool keep;
+
+    assert(nativep(pred) && pred.arity == 1 && "#filter: takes a native of one argument");
+
+    for (; consp(EXPR(list)); list = EXPR(list).cdr) {
+        assert(builtin_check_arg(pred, 0, CAR(EXPR(list))) && "The element doesn't fit the native's signature");
+
+        /* the argument list only lives for the call, so it's a value instead of a cell */
+        keep = expr_is_truthy(pred.native(expr_create_cons(EXPR(list).car, 0)));
+
+        if (!keep) continue;
+
+        cell = expr_new_cons(EXPR(list).car, 0);
+
+        if (tail) EXPR(tail).cdr = cell;
+        else head = cell;
+
+        tail = cell;
+    }
+
+    return head;
+}
+
+/* The order of two elements of a list already known to be of one sort_kind */
+static inline i32 compare(struct expr a, struct expr b) {
+    struct slice(char) x, y;
+    f64 p, q;
+    i32 order;
+
+    if (integerp(a) && integerp(b)) return (a.integer > b.integer) - (a.integer < b.integer);
+
+    if (integerp(a) || floatp(a)) {
+        p = integerp(a) ? (f64)a.integer : a.real;
+        q = integerp(b) ? (f64)b.integer : b.real;
+        return (p > q) - (p < q);
+    }
+
+    if (symbolp(a)) {
+        x = (struct slice(char)){a.symbol, a.length};
+        y = (struct slice(char)){b.symbol, b.length};
+    } else {
+        x = expr_string(&a);
+        y = expr_string(&b);
+    }
+
+    order = memcmp(x.ptr, y.ptr, x.length < y.length ? x.length : y.length);
+    if (order != 0) return order;
+
+    return (x.length > y.length) - (x.length < y.length);
+}
+
+static enum sort_kind sort_kind_of(struct expr element) {
+    switch (element.type) {
+        case EXPR_INTEGER: return SORT_INTEGERS;
+        case EXPR_FLOAT:   return SORT_NUMBERS;
+        case EXPR_STRING:  return SORT_STRINGS;
+        case EXPR_SYMBOL:  return SORT_SYMBOLS;
+    }
+
+    assert(0 && "#sort: can only sort numbers, strings or symbols");
+    return SORT_NUMBERS;
+}
+
+/* Sorts cars by the elements they point at, stable, scratch is as long as cars */
+static void merge_sort(u32* cars, u32* scratch, usize length) {
+    u32* from = cars;
+    u32* to = scratch;
+    u32* swap;
+    usize width, low, middle, high, i, j, k;
+    u32 car;
+
+    for (low = 0; low < length; low += SORT_RUN) {
+        high = low + SORT_RUN < length ? low + SORT_RUN : length;
+
+        for (i = low + 1; i < high; ++i) {
+            car = cars[i];
+            for (j = i; j > low && compare(EXPR(cars[j - 1]), EXPR(car)) > 0; --j) cars[j] = cars[j - 1];
+            cars[j] = car;
+        }
+    }
+
+    for (width = SORT_RUN; width < length; width *= 2) {
+        for (low = 0; low < length; low += 2 * width) {
+            middle = low + width < length ? low + width : length;
+            high = low + 2 * width < length ? low + 2 * width : length;
+
+            /* taking from the left on ties is what keeps it stable */
+            for (i = low, j = middle, k = low; k < high; ++k) {
+                if (j >= high || (i < middle && compare(EXPR(from[i]), EXPR(from[j])) <= 0)) to[k] = from[i++];
+                else to[k] = from[j++];
+            }
+        }
+
+        swap = from;
+        from = to;
+        to = swap;
+    }
+
+    if (from != cars) memcpy(cars, from, length * sizeof(u32));
+}
+
+/*
+ * Least significant byte first, so every pass is stable. Flipping the sign
+ * bit makes the unsigned order of the keys that of the integers. A pass where
+ * every key has the same byte does nothing and gets skipped, which for small
+ * integers is most of them.
+ * */
+static void radix_sort(struct radix_item* items, struct radix_item* scratch, usize length) {
+    usize counts[8][256] = {{0}};
+    struct radix_item* from = items;
+    struct radix_item* to = scratch;
+    struct radix_item* swap;
+    usize offset, count;
+    usize i, byte;
+    u32 pass;
+
+    for (i = 0; i < length; ++i) {
+        for (pass = 0; pass < 8; ++pass) counts[pass][(items[i].key >> (pass * 8)) & 0xff] += 1;
+    }
+
+    for (pass = 0; pass < 8; ++pass) {
+        if (counts[pass][(items[0].key >> (pass * 8)) & 0xff] == length) continue;
+
+        for (byte = 0, offset = 0; byte < 256; ++byte) {
+            count = counts[pass][byte];
+            counts[pass][byte] = offset;
+            offset += count;
+        }
+
+        for (i = 0; i < length; ++i) to[counts[pass][(from[i].key >> (pass * 8)) & 0xff]++] = from[i];
+
+        swap = from;
+        from = to;
+        to = swap;
+    }
+
+    if (from != items) memcpy(items, from, length * sizeof(struct radix_item));
+}
+
+u32 list_sort(u32 list) {
+    struct radix_item* items;
+    u32* cars;
+    enum sort_kind kind, other;
+    u32 length = list_length(list);
+    u32 sorted = 0;
+    u32 cell, i;
+
+    if (length == 0) return 0;
+
+    kind = sort_kind_of(CAR(EXPR(list)));
+
+    for (cell = EXPR(list).cdr; consp(EXPR(cell)); cell = EXPR(cell).cdr) {
+        other = sort_kind_of(CAR(EXPR(cell)));
+
+        if (other == kind) continue;
+
+        /* integers and floats sort together */
+        assert(kind <= SORT_NUMBERS && other <= SORT_NUMBERS && "#sort: can't compare numbers, strings and symbols");
+        kind = SORT_NUMBERS;
+    }
+
+    if (kind == SORT_INTEGERS) {
+        items = malloc(2 * length * sizeof(struct radix_item));
+        assert(items);
+
+        for (i = 0, cell = list; i < length; ++i, cell = EXPR(cell).cdr) {
+            items[i].key = (u64)CAR(EXPR(cell)).integer ^ (1ull << 63);
+            items[i].car = EXPR(cell).car;
+        }
+
+        radix_sort(items, items + length, length);
+
+        /* built back to front, so it's all allocation and no indexing */
+        for (i = length; i-- > 0;) sorted = expr_new_cons(items[i].car, sorted);
+
+        free(items);
+
+        return sorted;
+    }
+
+    cars = malloc(2 * length * sizeof(u32));
+    assert(cars);
+
+    for (i = 0, cell = list; i < length; ++i, cell = EXPR(cell).cdr) cars[i] = EXPR(cell).car;
+
+    merge_sort(cars, cars + length, length);
+
+    for (i = length; i-- > 0;) sorted = expr_new_cons(cars[i], sorted);
+
+    free(cars);
+
+    return sorted;
+}
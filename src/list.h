@@ -0,0 +1,62 @@
+#ifndef __LIST_H
+#define __LIST_H
+
+#include "common.h"
+#include "expr.h"
+#include "native.h"
+#include "vector.h"
+
+/*
+ * The algorithms behind the list natives.
+ *
+ *     (#sort (#filter odd? (#reverse xs)))
+ *     (#nth xs 3)
+ *
+ * Lists are passed around as the heap index of their first cell, and a list
+ * ends at the first cdr that isn't a cons, so both 0 and a boxed nil end one.
+ * Every function walks the spine with a loop, so lists as long as the heap
+ * can hold never touch the C stack, and none of them is worse than n log n.
+ *
+ * The lists that come back are new spines whose cells point at the same
+ * elements as the list they came from, nothing gets boxed again. A function
+ * returning a list allocates exactly its cells and nothing else, and the
+ * spines it builds end in 0. #append shares its second list instead of
+ * copying it. Indices into the heap are only held across allocations, never
+ * pointers.
+ * */
+
+/* The number of cells in the spine */
+u32 list_length(u32 list);
+
+/* A copy of the spine of a with b as its tail, b itself if a is empty */
+u32 list_append(u32 a, u32 b);
+
+u32 list_reverse(u32 list);
+
+/* The element at index n, nil past the end */
+struct expr list_nth(u32 list, u64 n);
+
+/* The last element, nil for an empty list */
+struct expr list_last(u32 list);
+
+/*
+ * An f64 vector if any element is a float, an i64 vector otherwise. Every
+ * element has to be a number.
+ * */
+struct vector* list_to_vector(u32 list);
+
+/*
+ * The elements pred returns something truthy for, in order. pred is a native
+ * of one argument, its argument list isn't put on the heap.
+ * */
+u32 list_filter(u32 list, struct expr pred);
+
+/*
+ * A stable merge sort, into ascending order. Numbers compare by value, 1 and
+ * 1.0 being equal, strings and symbols by their bytes. Anything else, or
+ * mixing numbers, strings and symbols, is an error. Lists of nothing but
+ * integers get a radix sort instead, which is linear.
+ * */
+u32 list_sort(u32 list);
+
+#endif  /*__LIST_H*/
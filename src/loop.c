@@ -0,0 +1,482 @@
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include "loop.h"
+#include "compiler.h"
+#include "reader.h"
+
+enum loop_op_stage {
+    LOOP_STAGE_OPEN,
+    LOOP_STAGE_READ,
+    LOOP_STAGE_CLOSE,
+    LOOP_STAGE_TIMEOUT,
+};
+
+/* Everything an async native is waiting on, one step at a time */
+struct loop_op {
+    enum loop_op_stage stage;
+    struct fiber* fiber;
+    struct expr value; /* what a sleep returns */
+
+    /* reading a file */
+    char* path;
+    i32 fd;
+    bool failed;
+    char* buffer;
+    usize length;
+    usize capacity;
+
+    /* sleeping */
+    struct __kernel_timespec timeout;
+    f64 deadline;
+
+    struct loop_op* next;
+};
+
+/* The loop running on this thread, NULL outside of loop_run */
+static __thread struct loop* loop_current;
+
+static struct loop_op* op_create(enum loop_op_stage stage) {
+    struct loop_op* op = calloc(1, sizeof(struct loop_op));
+    assert(op);
+
+    op->stage = stage;
+    op->fd = -1;
+
+    return op;
+}
+
+static void op_destroy(struct loop_op* op) {
+    free(op->path);
+    free(op->buffer);
+    free(op);
+}
+
+static void op_reserve(struct loop_op* op) {
+    if (op->length < op->capacity) return;
+
+    op->capacity = op->capacity ? op->capacity * 2 : LOOP_READ_CHUNK;
+    op->buffer = realloc(op->buffer, op->capacity);
+    assert(op->buffer);
+}
+
+/* Strings have 32 bits of length, bigger files count as unreadable */
+static struct expr file_contents(struct loop_op* op) {
+    if (op->failed || op->length > UINT32_MAX) return expr_create_nil();
+
+    return expr_create_string(op->buffer, op->length);
+}
+
+/* Reads the whole file right away, counting the system calls it took */
+static void read_blocking(struct loop_op* op, u64* syscalls) {
+    isize n;
+
+    *syscalls += 1;
+    op->fd = open(op->path, O_RDONLY | O_CLOEXEC);
+    if (op->fd < 0) {
+        op->failed = true;
+        return;
+    }
+
+    for (;;) {
+        op_reserve(op);
+
+        *syscalls += 1;
+        n = read(op->fd, op->buffer + op->length, op->capacity - op->length);
+        if (n < 0 && errno == EINTR) continue;
+
+        if (n <= 0) {
+            op->failed = n < 0;
+            break;
+        }
+
+        op->length += n;
+    }
+
+    *syscalls += 1;
+    close(op->fd);
+}
+
+/* Fibers */
+
+void fiber_init(struct fiber* fiber, struct slice(char) text) {
+    *fiber = (struct fiber){0};
+    fiber->text = text;
+}
+
+void fiber_destroy(struct fiber* fiber) {
+    module_destroy(&fiber->module);
+    free(fiber->stack);
+}
+
+static void enqueue(struct loop* loop, struct fiber* fiber) {
+    fiber->next = NULL;
+
+    if (loop->tail) loop->tail->next = fiber;
+    else loop->head = fiber;
+
+    loop->tail = fiber;
+}
+
+/* Puts the operation's result in place of the native's and wakes the fiber up */
+static void finish(struct loop* loop, struct loop_op* op) {
+    struct fiber* fiber = op->fiber;
+
+    fiber->stack[fiber->sp - 1] = op->stage == LOOP_STAGE_TIMEOUT ? op->value : file_contents(op);
+    fiber->op = NULL;
+
+    loop->waiting -= 1;
+    enqueue(loop, fiber);
+
+    op_destroy(op);
+}
+
+static void run_fiber(struct loop* loop, struct fiber* fiber) {
+    struct vm* vm = loop->vm;
+    enum vm_status status;
+
+    if (fiber->sp > 0) memcpy(vm->stack, fiber->stack, sizeof(struct expr) * fiber->sp);
+    vm->module = fiber->running;
+    vm->ip = fiber->ip;
+    vm->sp = fiber->sp;
+    vm->base = fiber->base;
+
+    loop->current = fiber;
+    status = vm_run_for(vm, LOOP_QUANTUM);
+    loop->current = NULL;
+
+    if (vm->sp > fiber->stack_capacity) {
+        fiber->stack_capacity = vm->sp < 8 ? 8 : STACK_MAX;
+        fiber->stack = realloc(fiber->stack, sizeof(struct expr) * fiber->stack_capacity);
+        assert(fiber->stack);
+    }
+
+    if (vm->sp > 0) memcpy(fiber->stack, vm->stack, sizeof(struct expr) * vm->sp);
+    fiber->running = vm->module;
+    fiber->ip = vm->ip;
+    fiber->sp = vm->sp;
+    fiber->base = vm->base;
+
+    switch (status) {
+        case VM_YIELDED:
+            enqueue(loop, fiber);
+            break;
+        case VM_SUSPENDED:
+            /* finish puts it back in line */
+            vm->suspended = false;
+            break;
+        case VM_OK:
+        case VM_HALTED:
+            fiber->status = status;
+            fiber->result = vm->result;
+            loop->unfinished -= 1;
+            break;
+    }
+}
+
+/* io_uring */
+
+/* Returns false if the ring is full */
+static bool submit(struct loop* loop, struct loop_op* op) {
+    struct io_uring_sqe* sqe = uring_get_sqe(&loop->ring);
+
+    if (!sqe) return false;
+
+    switch (op->stage) {
+        case LOOP_STAGE_OPEN:
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = (u64)(uintptr_t)op->path;
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            break;
+        case LOOP_STAGE_READ:
+            op_reserve(op);
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = op->fd;
+            sqe->addr = (u64)(uintptr_t)(op->buffer + op->length);
+            sqe->len = op->capacity - op->length;
+            sqe->off = op->length;
+            break;
+        case LOOP_STAGE_CLOSE:
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = op->fd;
+            break;
+        case LOOP_STAGE_TIMEOUT:
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->addr = (u64)(uintptr_t)&op->timeout;
+            sqe->len = 1;
+            break;
+    }
+
+    sqe->user_data = (u64)(uintptr_t)op;
+
+    return true;
+}
+
+static void queue(struct loop* loop, struct loop_op* op) {
+    if (submit(loop, op)) return;
+
+    op->next = loop->backlog;
+    loop->backlog = op;
+}
+
+/* Takes an operation on to its next step once the last one completed with res */
+static void step(struct loop* loop, struct loop_op* op, i32 res) {
+    switch (op->stage) {
+        case LOOP_STAGE_OPEN:
+            if (res < 0) {
+                op->failed = true;
+                finish(loop, op);
+                return;
+            }
+
+            op->fd = res;
+            op->stage = LOOP_STAGE_READ;
+            break;
+        case LOOP_STAGE_READ:
+            /* keep reading until the end of the file, or the first error */
+            if (res > 0) {
+                op->length += res;
+                break;
+            }
+
+            op->failed = res < 0;
+            op->stage = LOOP_STAGE_CLOSE;
+            break;
+        case LOOP_STAGE_CLOSE:
+        case LOOP_STAGE_TIMEOUT:
+            finish(loop, op);
+            return;
+    }
+
+    queue(loop, op);
+}
+
+static void wait_uring(struct loop* loop) {
+    struct io_uring_cqe* cqe;
+    struct loop_op* backlog = loop->backlog;
+    struct loop_op* op;
+    i32 res;
+
+    loop->backlog = NULL;
+
+    while (backlog) {
+        op = backlog;
+        backlog = backlog->next;
+        queue(loop, op);
+    }
+
+    /* fibers that can still run should not wait on the kernel */
+    if (loop->ring.queued > 0 || !loop->head) {
+        uring_enter(&loop->ring, loop->head ? 0 : 1);
+        loop->syscalls += 1;
+    }
+
+    while ((cqe = uring_peek(&loop->ring))) {
+        op = (struct loop_op*)(uintptr_t)cqe->user_data;
+        res = cqe->res;
+        uring_advance(&loop->ring);
+
+        step(loop, op, res);
+    }
+}
+
+/* epoll */
+
+static void wait_epoll(struct loop* loop) {
+    struct epoll_event event;
+    struct loop_op** link;
+    struct loop_op* op;
+    f64 now, earliest = 0;
+    i32 timeout;
+
+    while ((op = loop->done)) {
+        loop->done = op->next;
+        finish(loop, op);
+    }
+
+    if (!loop->timers) return;
+
+    for (op = loop->timers; op; op = op->next) {
+        if (earliest == 0 || op->deadline < earliest) earliest = op->deadline;
+    }
+
+    if (!loop->head) {
+        now = monotonic_now();
+        timeout = earliest > now ? (i32)((earliest - now) * 1e3 + 1) : 0;
+
+        epoll_wait(loop->epoll, &event, 1, timeout);
+        loop->syscalls += 1;
+    }
+
+    now = monotonic_now();
+    link = &loop->timers;
+
+    while ((op = *link)) {
+        if (op->deadline > now) {
+            link = &op->next;
+            continue;
+        }
+
+        *link = op->next;
+        finish(loop, op);
+    }
+}
+
+/* Loop */
+
+void loop_init(struct loop* loop, struct vm* vm, enum loop_backend backend) {
+    *loop = (struct loop){0};
+    loop->vm = vm;
+    loop->epoll = -1;
+
+    if (backend != LOOP_BACKEND_EPOLL && uring_init(&loop->ring, LOOP_RING_ENTRIES)) {
+        loop->backend = LOOP_BACKEND_URING;
+        return;
+    }
+
+    loop->backend = LOOP_BACKEND_EPOLL;
+    loop->epoll = epoll_create1(EPOLL_CLOEXEC);
+    assert(loop->epoll >= 0);
+}
+
+void loop_destroy(struct loop* loop) {
+    if (loop->backend == LOOP_BACKEND_URING) uring_destroy(&loop->ring);
+    else close(loop->epoll);
+}
+
+void loop_spawn(struct loop* loop, struct fiber* fiber) {
+    struct compiler compiler = {0};
+
+    compiler_init(&compiler, reader_create_borrowed(fiber->text), &fiber->module);
+    fiber->compile_status = compile(&compiler);
+    compiler_destroy(&compiler);
+
+    if (fiber->compile_status != COMPILE_OK) {
+        fiber->status = VM_HALTED;
+        return;
+    }
+
+    fiber->running = &fiber->module;
+    fiber->ip = fiber->module.code.at;
+
+    loop->unfinished += 1;
+    enqueue(loop, fiber);
+}
+
+void loop_run(struct loop* loop) {
+    struct vm* vm = loop->vm;
+    struct loop* outer = loop_current;
+    struct expr stack[STACK_MAX];
+    struct module* module = vm->module;
+    struct fiber* fiber;
+    struct fiber* next;
+    u8* ip = vm->ip;
+    u32 sp = vm->sp;
+    u32 base = vm->base;
+
+    /* the fibers take over the vm, whatever it was in the middle of comes back after */
+    memcpy(stack, vm->stack, sizeof(struct expr) * sp);
+    loop_current = loop;
+
+    while (loop->unfinished > 0) {
+        /* one turn for everything in line, fibers that yield line up for the next pass */
+        fiber = loop->head;
+        loop->head = loop->tail = NULL;
+
+        while (fiber) {
+            next = fiber->next;
+            run_fiber(loop, fiber);
+            fiber = next;
+        }
+
+        if (loop->waiting == 0) continue;
+
+        if (loop->backend == LOOP_BACKEND_URING) wait_uring(loop);
+        else wait_epoll(loop);
+    }
+
+    loop_current = outer;
+    memcpy(vm->stack, stack, sizeof(struct expr) * sp);
+    vm->module = module;
+    vm->ip = ip;
+    vm->sp = sp;
+    vm->base = base;
+}
+
+/* Async natives */
+
+static void suspend(struct loop* loop, struct loop_op* op) {
+    op->fiber = loop->current;
+    loop->current->op = op;
+    loop->vm->suspended = true;
+    loop->waiting += 1;
+}
+
+struct expr loop_read_file(struct slice(char) path) {
+    struct loop* loop = loop_current;
+    struct loop_op* op = op_create(LOOP_STAGE_OPEN);
+    struct expr value;
+    u64 syscalls = 0;
+
+    op->path = malloc(path.length + 1);
+    assert(op->path);
+    memcpy(op->path, path.ptr, path.length);
+    op->path[path.length] = '\0';
+
+    if (!loop || !loop->current) {
+        read_blocking(op, &syscalls);
+        value = file_contents(op);
+        op_destroy(op);
+        return value;
+    }
+
+    suspend(loop, op);
+
+    if (loop->backend == LOOP_BACKEND_URING) {
+        queue(loop, op);
+    } else {
+        read_blocking(op, &loop->syscalls);
+        op->next = loop->done;
+        loop->done = op;
+    }
+
+    return expr_create_nil();
+}
+
+struct expr loop_sleep(i64 ms) {
+    struct loop* loop = loop_current;
+    struct timespec ts;
+    struct loop_op* op;
+
+    if (ms < 0) ms = 0;
+
+    if (!loop || !loop->current) {
+        ts.tv_sec = ms / 1000;
+        ts.tv_nsec = ms % 1000 * 1000000;
+        while (nanosleep(&ts, &ts) < 0 && errno == EINTR);
+        return expr_create_integer(ms);
+    }
+
+    op = op_create(LOOP_STAGE_TIMEOUT);
+    op->value = expr_create_integer(ms);
+    op->timeout.tv_sec = ms / 1000;
+    op->timeout.tv_nsec = ms % 1000 * 1000000;
+    op->deadline = monotonic_now() + ms / 1e3;
+
+    suspend(loop, op);
+
+    if (loop->backend == LOOP_BACKEND_URING) {
+        queue(loop, op);
+    } else {
+        op->next = loop->timers;
+        loop->timers = op;
+    }
+
+    return expr_create_nil();
+}
@@ -0,0 +1,110 @@
+#ifndef __LOOP_H
+#define __LOOP_H
+
+#include "common.h"
+#include "module.h"
+#include "uring.h"
+#include "vm.h"
+
+/* How many instructions a fiber gets to run before the next one gets a turn */
+#define LOOP_QUANTUM 4096
+
+/* How many operations can be queued for the kernel between two system calls */
+#define LOOP_RING_ENTRIES 4096
+
+/* How much of a file is asked for at a time, files that fill it get a bigger one */
+#define LOOP_READ_CHUNK (KILOBYTES(1))
+
+enum loop_backend {
+    LOOP_BACKEND_AUTO,  /* io_uring if the kernel lets us, epoll otherwise */
+    LOOP_BACKEND_URING, /* every operation batched through one ring */
+    LOOP_BACKEND_EPOLL, /* files are read on the spot, epoll only waits for timers */
+};
+
+struct loop_op;
+
+/*
+ * One script running on the loop's vm. Fibers share the vm's globals and heap,
+ * but each one has its own stack and place in its module, which get swapped
+ * in and out of the vm around every turn.
+ * */
+struct fiber {
+    struct module module;
+    struct slice(char) text; /* borrowed until the fiber is done */
+    u8 compile_status;
+
+    /*
+     * What the vm was doing when the fiber last gave it up. Only the live
+     * part of the stack is kept, which is usually a handful of values, so
+     * thousands of fibers don't cost thousands of full stacks.
+     * */
+    struct expr* stack;
+    u32 stack_capacity;
+    struct module* running;
+    u8* ip;
+    u32 sp;
+    u32 base;
+
+    /* filled in once the fiber is done */
+    enum vm_status status;
+    struct expr result;
+
+    struct loop_op* op; /* what the fiber is waiting on, NULL if it isn't */
+    struct fiber* next;
+};
+
+/*
+ * Runs many fibers on one vm from one thread.
+ *
+ * A fiber runs until it finishes, uses up its quantum, or calls an async
+ * native. An async native queues an operation and suspends the fiber, which
+ * goes back in line once the operation completes with its result in place of
+ * the native's. The loop only talks to the kernel once every fiber that can
+ * run has had its turn, so a thousand fibers reading files at once queue a
+ * thousand reads and hand them over in one go.
+ *
+ * With io_uring each step of an operation (open, read, close, or a timeout) is
+ * an entry in the ring. Without it, files are read on the spot before the
+ * fiber even suspends and only timers are waited on, with epoll_wait.
+ * */
+struct loop {
+    struct vm* vm;
+    enum loop_backend backend;
+    struct uring ring;
+    i32 epoll;
+
+    struct fiber* head;
+    struct fiber* tail;
+    struct fiber* current;
+    usize unfinished;
+    usize waiting;
+
+    struct loop_op* backlog; /* operations that did not fit in the ring yet */
+    struct loop_op* done;    /* completed on the spot, delivered next time around */
+    struct loop_op* timers;  /* the sleeps the epoll backend is waiting on */
+
+    u64 syscalls; /* every system call made on behalf of a fiber */
+};
+
+/* The vm has to be initialized and its isolate entered by the calling thread */
+void loop_init(struct loop* loop, struct vm* vm, enum loop_backend backend);
+void loop_destroy(struct loop* loop);
+
+void fiber_init(struct fiber* fiber, struct slice(char) text);
+void fiber_destroy(struct fiber* fiber);
+
+/* Compiles the fiber and queues it up, nothing runs until loop_run */
+void loop_spawn(struct loop* loop, struct fiber* fiber);
+
+/* Runs until every fiber spawned so far is done */
+void loop_run(struct loop* loop);
+
+/*
+ * The async natives. Called from a fiber they suspend it, anywhere else they
+ * just block. A file's contents come back as a string, nil if it could not be
+ * read.
+ * */
+struct expr loop_read_file(struct slice(char) path);
+struct expr loop_sleep(i64 ms);
+
+#endif  /*__LOOP_H*/
@@ -1,7 +1,10 @@
+#define _DEFAULT_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <unistd.h>
 
 #include "common.h"
 #include "expr.h"
@@ -11,6 +14,11 @@
 #include "compiler.h"
 #include "builtin.h"
 #include "arena.h"
+#include "source.h"
+#include "run.h"
+#include "batch.h"
+#include "serve.h"
+#include "loop.h"
 
 #define INPUT_BUFFER_CAP (KILOBYTES(1))
 
@@ -24,9 +32,8 @@ void repl() {
     struct module module = {0};
     struct compiler compiler = {0};
 
-    expr_new_nil();
-
     vm_init(&vm);
+    isolate_enter(&vm.isolate);
 
     printf("(hoax)>> ");
     while (vm.running && fgets(input_buffer, INPUT_BUFFER_CAP, stdin)) {
@@ -36,10 +43,10 @@ void repl() {
             continue;
         }
 
-        DYNARRAY_CLEAR(&module.code);
-        DYNARRAY_CLEAR(&module.constants);
+        module_clear(&module);
 
-        compiler_init(&compiler, input, &module);
+        compiler_init(&compiler, reader_create(input), &module);
+        compiler.constants = &vm.constants;
 
         if (compile(&compiler) == COMPILE_OK) {
             if (vm.debug)
@@ -50,6 +57,9 @@ void repl() {
             if (!nilp(expr)) expr_println(expr);
         }
 
+        /* the line index of this input is useless for the next one */
+        reader_destroy(&compiler.reader);
+
         if (vm.debug)
             vm_dump_globals(&vm);
 
@@ -66,67 +76,225 @@ void repl() {
         module_destroy(compiler.module);
 
     compiler_destroy(&compiler);
-    DYNARRAY_FREE(&exprs);
-    arena_destroy(&expr_arena);
+    isolate_leave(&vm.isolate);
     vm_destroy(&vm);
 }
 
-void file(char* filename) {
-    struct slice(char) src;
-    char* file_contents;
-    FILE* fp;
-    usize file_size;
-
+/* threads is how many threads read the file, 0 lets the size of it decide */
+void file(char* filename, usize threads, enum run_mode mode, bool stats) {
+    struct source source = {0};
     struct vm vm = {0};
-    struct module module = {0};
-    struct compiler compiler = {0};
 
-    fp = fopen(filename, "r");
-    if (!fp) {
-        fprintf(stderr, "[file] error: failed to open file %s\n", filename);
+    if (!source_open(&source, filename)) {
         exit(1);
     }
 
-    fseek(fp, 0, SEEK_END);
-    file_size = ftell(fp);
-    rewind(fp);
+    vm_init(&vm);
+    isolate_enter(&vm.isolate);
+    vm.stats = stats;
 
-    file_contents = malloc(file_size);
-    assert(file_contents && "OOM or something");
-    
-    assert(file_size == fread(file_contents, 1, file_size, fp));
+    run_source(&vm, source.text, threads, mode);
 
-    src = (struct slice(char)){.ptr = file_contents, .length = file_size};
+    isolate_leave(&vm.isolate);
+    vm_destroy(&vm);
+    source_close(&source);
+}
+
+/* Runs every file as a fiber of one vm, so their I/O overlaps */
+i32 fibers(char** filenames, usize count) {
+    struct source* sources = calloc(count, sizeof(struct source));
+    struct fiber* fibers = calloc(count, sizeof(struct fiber));
+    struct loop loop;
+    struct vm vm = {0};
+    usize opened = 0;
+    i32 ret = 0;
+    usize i;
 
-    expr_new_nil();
+    assert(sources && fibers);
 
     vm_init(&vm);
+    isolate_enter(&vm.isolate);
+    loop_init(&loop, &vm, LOOP_BACKEND_AUTO);
+
+    for (opened = 0; opened < count; ++opened) {
+        if (!source_open(&sources[opened], filenames[opened])) {
+            ret = 1;
+            break;
+        }
 
-    compiler_init(&compiler, src, &module);
+        fiber_init(&fibers[opened], sources[opened].text);
+        loop_spawn(&loop, &fibers[opened]);
 
-    if (compile(&compiler) == COMPILE_OK) {
-        free(file_contents);
-        vm_run(&vm, compiler.module);
+        if (fibers[opened].compile_status != COMPILE_OK) ret = 1;
     }
 
-    module_destroy(compiler.module);
-    compiler_destroy(&compiler);
-    DYNARRAY_FREE(&exprs);
-    arena_destroy(&expr_arena);
+    if (ret == 0) loop_run(&loop);
+
+    for (i = 0; i < opened; ++i) {
+        fiber_destroy(&fibers[i]);
+        source_close(&sources[i]);
+    }
+
+    loop_destroy(&loop);
+    isolate_leave(&vm.isolate);
     vm_destroy(&vm);
+    free(fibers);
+    free(sources);
+
+    return ret;
+}
+
+/* Sends a file, or stdin, to a server and prints what came back */
+i32 connect_client(char* path, char* filename) {
+    struct serve_response response;
+    struct source source = {0};
+    bool ok;
+    i32 fd, ret;
+
+    if (!source_open(&source, filename ? filename : "/dev/stdin")) return 1;
+
+    fd = serve_connect(path);
+    if (fd < 0) {
+        fprintf(stderr, "[connect] error: nothing is listening on %s\n", path);
+        source_close(&source);
+        return 1;
+    }
+
+    ok = serve_request(fd, source.text, &response);
+
+    close(fd);
+    source_close(&source);
+
+    if (!ok) {
+        fprintf(stderr, "[connect] error: the server dropped the request\n");
+        serve_response_free(&response);
+        return 1;
+    }
+
+    fwrite(response.output.ptr, 1, response.output.length, stdout);
+    if (response.result.length > 0) printf("%.*s\n", STRINGF(response.result));
+
+    if (response.status == SERVE_TIMEOUT) {
+        fprintf(stderr, "[connect] error: the request ran out of time\n");
+    }
+
+    ret = response.status == SERVE_OK ? 0 : 1;
+    serve_response_free(&response);
+
+    return ret;
+}
+
+void usage(char* program) {
+    fprintf(stderr, "usage: %s [--threads N] [--pipeline | --stream] [--stats] [file]\n", program);
+    fprintf(stderr, "       %s --jobs N [--prelude file] [--ordered] [files...]\n", program);
+    fprintf(stderr, "       %s --serve sock [--jobs N] [--prelude file] [--timeout ms]\n", program);
+    fprintf(stderr, "       %s --connect sock [file]\n", program);
+    fprintf(stderr, "       %s --loop files...\n", program);
+    exit(1);
 }
 
 i32 main(i32 argc, char** argv) {
-    UNUSED(argc);
-    UNUSED(argv);
+    struct batch_options batch = {0};
+    struct serve_options serve = {0};
+    char* connect = NULL;
+    bool loop = false;
+    bool stats = false;
+    long cpus;
+    usize j;
+    i32 ret;
+    usize threads = 0;
+    enum run_mode mode = RUN_WHOLE;
+    i32 i = 1;
+    char* end;
+
+    while (i < argc && strncmp(argv[i], "--", 2) == 0) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = strtoul(argv[i + 1], &end, 10);
+            if (*end != '\0' || threads == 0) usage(argv[0]);
+            i += 2;
+        } else if (strcmp(argv[i], "--pipeline") == 0) {
+            mode = RUN_PIPELINED;
+            i += 1;
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            mode = RUN_STREAMING;
+            i += 1;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            stats = true;
+            i += 1;
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            batch.jobs = strtoul(argv[i + 1], &end, 10);
+            if (*end != '\0' || batch.jobs == 0) usage(argv[0]);
+            i += 2;
+        } else if (strcmp(argv[i], "--prelude") == 0 && i + 1 < argc) {
+            batch.prelude = argv[i + 1];
+            serve.prelude = argv[i + 1];
+            i += 2;
+        } else if (strcmp(argv[i], "--ordered") == 0) {
+            batch.ordered = true;
+            i += 1;
+        } else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            serve.path = argv[i + 1];
+            i += 2;
+        } else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) {
+            serve.timeout_ms = strtoull(argv[i + 1], &end, 10);
+            if (*end != '\0' || serve.timeout_ms == 0) usage(argv[0]);
+            i += 2;
+        } else if (strcmp(argv[i], "--loop") == 0) {
+            loop = true;
+            i += 1;
+        } else if (strcmp(argv[i], "--connect") == 0 && i + 1 < argc) {
+            connect = argv[i + 1];
+            i += 2;
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    /* Keep warm vms around and run whatever clients send them */
+    if (serve.path) {
+        if (i < argc) usage(argv[0]);
+
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        serve.workers = batch.jobs > 0 ? batch.jobs : cpus > 0 ? (usize)cpus : 1;
+        if (serve.timeout_ms == 0) serve.timeout_ms = SERVE_TIMEOUT_DEFAULT_MS;
+
+        return serve_run(&serve);
+    }
+
+    if (connect) {
+        if (argc - i > 1) usage(argv[0]);
+        return connect_client(connect, i < argc ? argv[i] : NULL);
+    }
+
+    if (loop) {
+        if (i == argc) usage(argv[0]);
+        return fibers(argv + i, argc - i);
+    }
+
+    /* Run every file given, or every path on stdin, as a batch of jobs */
+    if (batch.jobs > 0) {
+        if (i < argc) {
+            batch.paths = argv + i;
+            batch.count = argc - i;
+            return batch_run(&batch);
+        }
+
+        batch.paths = batch_read_paths(stdin, &batch.count);
+        ret = batch_run(&batch);
+
+        for (j = 0; j < batch.count; ++j) free(batch.paths[j]);
+        free(batch.paths);
+
+        return ret;
+    }
 
     /* Fire up the repl */
-    if (argc == 1) {
+    if (i == argc) {
         repl();
         return 0;
     }
 
-    file(argv[1]);
+    file(argv[i], threads, mode, stats);
 
     return 0;
 }
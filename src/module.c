@@ -5,10 +5,28 @@
 #include "module.h"
 
 DYNARRAY_IMPL(u8);
+DYNARRAY_IMPL_S(quote);
 
 void module_destroy(struct module* module) {
+    module_clear(module);
+
     DYNARRAY_FREE(&module->code);
     DYNARRAY_FREE(&module->constants);
+    DYNARRAY_FREE(&module->deps);
+    DYNARRAY_FREE(&module->quotes);
+}
+
+void module_clear(struct module* module) {
+    struct quote* quote;
+
+    DYNARRAY_FOR_EACH(&module->quotes, quote) {
+        free(quote->packed);
+    }
+
+    DYNARRAY_CLEAR(&module->code);
+    DYNARRAY_CLEAR(&module->constants);
+    DYNARRAY_CLEAR(&module->deps);
+    DYNARRAY_CLEAR(&module->quotes);
 }
 
 void module_write_byte(struct module* module, u8 byte) {
@@ -21,6 +39,12 @@ u8 module_write_const(struct module* module, struct expr expr) {
     return (u8) (module->constants.length - 1);
 }
 
+u8 module_write_quote(struct module* module, struct expr list) {
+    dynarray__quote_push(&module->quotes, (struct quote){expr_pack(list)});
+
+    return (u8) (module->quotes.length - 1);
+}
+
 static inline u16 __module_get_u16(struct module* module, u32 offset) {
     return ((u16)module->code.at[offset] << 8) | module->code.at[offset + 1];
 }
@@ -51,6 +75,15 @@ void module_disassemble(struct module* module) {
             case OP_DIV:
                 puts("OP_DIV");
                 break;
+            case OP_ADD_UNCHECKED:
+                puts("OP_ADD_UNCHECKED");
+                break;
+            case OP_SUB_UNCHECKED:
+                puts("OP_SUB_UNCHECKED");
+                break;
+            case OP_MUL_UNCHECKED:
+                puts("OP_MUL_UNCHECKED");
+                break;
             case OP_JMP:
                 offset += 1;
                 printf("OP_JMP %d\n", __module_get_u16(module, offset));
@@ -64,6 +97,19 @@ void module_disassemble(struct module* module) {
             case OP_CALL:
                 puts("OP_CALL");
                 break;
+            case OP_CALL_UNCHECKED:
+                offset += 1;
+                printf("OP_CALL_UNCHECKED %d\n", module->code.at[offset]);
+                break;
+            case OP_CALL_NATIVE:
+            case OP_CALL_NATIVE_UNCHECKED:
+                offset += 1;
+                const_index = module->code.at[offset];
+                printf("%s %d (", module->code.at[offset - 1] == OP_CALL_NATIVE
+                       ? "OP_CALL_NATIVE" : "OP_CALL_NATIVE_UNCHECKED", const_index);
+                expr_print(module->constants.at[const_index]);
+                printf(")\n");
+                break;
             case OP_TRUE:
                 puts("OP_TRUE");
                 break;
@@ -82,9 +128,51 @@ void module_disassemble(struct module* module) {
             case OP_CDR:
                 puts("OP_CDR");
                 break;
+            case OP_CAR_UNCHECKED:
+                puts("OP_CAR_UNCHECKED");
+                break;
+            case OP_CDR_UNCHECKED:
+                puts("OP_CDR_UNCHECKED");
+                break;
+            case OP_MAKE_VECTOR:
+                puts("OP_MAKE_VECTOR");
+                break;
+            case OP_VECTOR_REF:
+                puts("OP_VECTOR_REF");
+                break;
+            case OP_VECTOR_SET:
+                puts("OP_VECTOR_SET");
+                break;
+            case OP_VECTOR_LENGTH:
+                puts("OP_VECTOR_LENGTH");
+                break;
+            case OP_MAKE_TABLE:
+                puts("OP_MAKE_TABLE");
+                break;
+            case OP_TABLE_GET:
+                puts("OP_TABLE_GET");
+                break;
+            case OP_TABLE_PUT:
+                puts("OP_TABLE_PUT");
+                break;
+            case OP_TABLE_DEL:
+                puts("OP_TABLE_DEL");
+                break;
+            case OP_TABLE_COUNT:
+                puts("OP_TABLE_COUNT");
+                break;
             case OP_TOGGLE_DEBUG:
                 puts("OP_TOGGLE_DEBUG");
                 break;
+            case OP_POP:
+                puts("OP_POP");
+                break;
+            case OP_RELOAD:
+                puts("OP_RELOAD");
+                break;
+            case OP_LOAD_NATIVE:
+                puts("OP_LOAD_NATIVE");
+                break;
             case OP_LOAD_VAR:
                 puts("OP_LOAD_VAR");
                 break;
@@ -98,8 +186,19 @@ void module_disassemble(struct module* module) {
                 expr_print(module->constants.at[const_index]);
                 printf(")\n");
                 break;
+            case OP_QUOTE:
+                offset += 1;
+                const_index = module->code.at[offset];
+                printf("OP_QUOTE %d (", const_index);
+                expr_print(module->quotes.at[const_index].packed->cells[1]);
+                printf(")\n");
+                break;
         }
 
         offset += 1;
     }
 }
+
+void module_fprint_stats(FILE* stream, struct module* module) {
+    fprintf(stream, "[stats] %u of %u type checks eliminated\n", module->checks_elided, module->checks);
+}
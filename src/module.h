@@ -7,6 +7,7 @@
 
 #include "common.h"
 #include "expr.h"
+#include "pack.h"
 
 DYNARRAY_DECL(u8);
 
@@ -17,17 +18,40 @@ enum op_code {
     OP_MUL,
     OP_DIV,
 
+    /* the same, for operands the compiler proved are integers */
+    OP_ADD_UNCHECKED,
+    OP_SUB_UNCHECKED,
+    OP_MUL_UNCHECKED,
+
     /* control flow */
     OP_JMP, /* unconditional jump */
     OP_JMF, /* jump if the top of the stack is falsy */
 
     /* function whatsnots */
     OP_CALL,
+    OP_CALL_UNCHECKED, /* followed by the index of the native in the builtin table */
+    OP_CALL_NATIVE,    /* followed by the index of the constant holding the native or extern */
+    OP_CALL_NATIVE_UNCHECKED,
 
     /* cons / heap stuff */
     OP_CONS,
     OP_CAR,
     OP_CDR,
+    OP_CAR_UNCHECKED,
+    OP_CDR_UNCHECKED,
+
+    /* vectors */
+    OP_MAKE_VECTOR,
+    OP_VECTOR_REF,
+    OP_VECTOR_SET,
+    OP_VECTOR_LENGTH,
+
+    /* tables */
+    OP_MAKE_TABLE,
+    OP_TABLE_GET,
+    OP_TABLE_PUT,
+    OP_TABLE_DEL,
+    OP_TABLE_COUNT,
     
     /* constant values */
     OP_TRUE,
@@ -36,29 +60,55 @@ enum op_code {
 
     /* loading a constant value */
     OP_CONSTANT,
+    OP_QUOTE, /* followed by the index of the quoted list, which gets unpacked into the heap */
 
     /* loading a variable from a symbol */
     OP_LOAD_VAR,
     OP_STORE_VAR,
 
+    /* drops the top of the stack */
+    OP_POP,
+
     /* Stopping the vm in some way */
     OP_RETURN,
     OP_HALT,
 
     /* virtual machine interactions */
     OP_TOGGLE_DEBUG,
+    OP_RELOAD,
+    OP_LOAD_NATIVE,
+};
+
+/* A quoted list, packed so it outlives the heap it was read into */
+struct quote {
+    struct packed_expr* packed;
 };
 
+DYNARRAY_DECL_S(quote);
+
 struct module {
     struct dynarray(u8) code;
     struct dynarray(expr) constants;
+    struct dynarray(quote) quotes;
+    u32 checks;        /* argument type checks the calls compiled into the module need */
+    u32 checks_elided; /* how many of those the compiler proved away */
+    struct dynarray(u32) deps; /* the entries of the vm's constant registry inlined into the code */
 };
 
 void module_destroy(struct module* module);
 
+/* Empties the module so it can be compiled into again */
+void module_clear(struct module* module);
+
 void module_write_byte(struct module* module, u8 byte);
 u8 module_write_const(struct module* module, struct expr expr);
 
+/* Packs the list for an OP_QUOTE, the module frees it */
+u8 module_write_quote(struct module* module, struct expr list);
+
 void module_disassemble(struct module* module);
 
+/* Prints how many of the module's type checks were eliminated, for --stats */
+void module_fprint_stats(FILE* stream, struct module* module);
+
 #endif  /* __MODULE_H */
@@ -1,6 +1,12 @@
 #include "common.h"
 #include "native.h"
 #include "expr.h"
+#include "channel.h"
+#include "pmap.h"
+#include "loop.h"
+#include "vector.h"
+#include "builder.h"
+#include "list.h"
 
 struct expr native_display(struct expr args) {
     expr_println(CAR(args));
@@ -13,13 +19,214 @@ struct expr native_hello(struct expr args) {
     return expr_create_nil();
 }
 
+/*
+ * The types of the arguments of the natives in builtin.def are checked against
+ * their signatures by whoever calls them, see vm_function_call. The asserts
+ * left in here are about the values.
+ * */
+
 struct expr native_add(struct expr args) {
     struct expr a, b;
 
-    assert(integerp(CAR(args)) && integerp(CAR(CDR(args))));
-
     a = CAR(args);
     b = CAR(CDR(args));
 
     return expr_create_integer(a.integer + b.integer);
 }
+
+struct expr native_chan(struct expr args) {
+    assert(CAR(args).integer > 0);
+    assert((u64)CAR(args).integer <= CHANNEL_CAPACITY_MAX);
+
+    return expr_create_channel(channel_create(CAR(args).integer));
+}
+
+/* Returns the value that was sent, the receiver gets a copy of it */
+struct expr native_send(struct expr args) {
+    channel_send(CAR(args).channel, CAR(CDR(args)));
+
+    return CAR(CDR(args));
+}
+
+struct expr native_recv(struct expr args) {
+    return channel_recv(CAR(args).channel);
+}
+
+struct expr native_pmap(struct expr args) {
+    assert(CAR(args).arity == 1);
+
+    return pmap(CAR(args), CAR(CDR(args)));
+}
+
+/* Async, suspends the calling fiber when there is an event loop running */
+struct expr native_read_file(struct expr args) {
+    struct expr path = CAR(args);
+
+    return loop_read_file(expr_string(&path));
+}
+
+/* Async, returns the number of milliseconds slept */
+struct expr native_sleep(struct expr args) {
+    return loop_sleep(CAR(args).integer);
+}
+
+/* The bulk operations on vectors, see vector.h for the kernels behind them */
+
+struct expr native_vector_sum(struct expr args) {
+    return vector_sum(CAR(args).vector);
+}
+
+struct expr native_vector_dot(struct expr args) {
+    return vector_dot(CAR(args).vector, CAR(CDR(args)).vector);
+}
+
+/* Returns a new vector, like the rest that make one */
+struct expr native_vector_scale(struct expr args) {
+    return expr_create_vector(vector_scale(CAR(args).vector, CAR(CDR(args))));
+}
+
+struct expr native_vector_add(struct expr args) {
+    return expr_create_vector(vector_add(CAR(args).vector, CAR(CDR(args)).vector));
+}
+
+struct expr native_vector_mul(struct expr args) {
+    return expr_create_vector(vector_mul(CAR(args).vector, CAR(CDR(args)).vector));
+}
+
+struct expr native_vector_min(struct expr args) {
+    return vector_min(CAR(args).vector);
+}
+
+struct expr native_vector_max(struct expr args) {
+    return vector_max(CAR(args).vector);
+}
+
+/*
+ * Strings never change, so a substring of one that isn't small points into
+ * the same bytes instead of copying them. Substrings short enough to be small
+ * get copied into the expr like any other small string.
+ * */
+
+struct expr native_string_length(struct expr args) {
+    struct expr string = CAR(args);
+
+    return expr_create_integer(expr_string(&string).length);
+}
+
+/* (#substring string start end), from start up to but not including end */
+struct expr native_substring(struct expr args) {
+    struct expr string = CAR(args);
+    struct slice(char) text = expr_string(&string);
+    i64 start = CAR(CDR(args)).integer;
+    i64 end = CAR(CDR(CDR(args))).integer;
+
+    assert(0 <= start && start <= end && (u64)end <= text.length && "#substring: out of bounds");
+
+    return expr_create_string_borrowed(text.ptr + start, end - start);
+}
+
+/* Copies both, use a builder to put together more than a couple of pieces */
+struct expr native_string_append(struct expr args) {
+    struct expr a = CAR(args);
+    struct expr b = CAR(CDR(args));
+    struct slice(char) x = expr_string(&a);
+    struct slice(char) y = expr_string(&b);
+    char small[EXPR_SMALL_STRING_MAX];
+    char* text = small;
+
+    assert((u64)x.length + y.length <= UINT32_MAX && "#string-append: string too long");
+
+    if (x.length + y.length > EXPR_SMALL_STRING_MAX) text = arena_alloc(&expr_arena, x.length + y.length);
+
+    memcpy(text, x.ptr, x.length);
+    memcpy(text + x.length, y.ptr, y.length);
+
+    return expr_create_string_borrowed(text, x.length + y.length);
+}
+
+struct expr native_string_equal(struct expr args) {
+    struct expr a = CAR(args);
+    struct expr b = CAR(CDR(args));
+    struct slice(char) x = expr_string(&a);
+    struct slice(char) y = expr_string(&b);
+
+    return expr_create_boolean(x.length == y.length && memcmp(x.ptr, y.ptr, x.length) == 0);
+}
+
+struct expr native_string_symbol(struct expr args) {
+    struct expr string = CAR(args);
+    struct slice(char) text = expr_string(&string);
+    char* symbol;
+
+    assert(text.length > 0 && text.length <= EXPR_LENGTH_MAX && "#string->symbol: bad length");
+
+    symbol = arena_alloc(&expr_arena, text.length);
+    memcpy(symbol, text.ptr, text.length);
+
+    return expr_create_symbol(symbol, text.length);
+}
+
+/* Symbols never change either, so the string shares their text */
+struct expr native_symbol_string(struct expr args) {
+    return expr_create_string_borrowed(CAR(args).symbol, CAR(args).length);
+}
+
+struct expr native_builder(struct expr args) {
+    UNUSED(args);
+
+    return expr_create_builder(builder_create());
+}
+
+/* Takes strings, symbols, integers and floats, returns the builder */
+struct expr native_builder_append(struct expr args) {
+    if (!builder_append_expr(CAR(args).builder, CAR(CDR(args))))
+        assert(0 && "#builder-append!: takes strings, symbols, integers and floats");
+
+    return CAR(args);
+}
+
+struct expr native_builder_string(struct expr args) {
+    return builder_string(CAR(args).builder);
+}
+
+/*
+ * The list natives, see list.h. They take the heap index of each list, which
+ * is the car of its argument cell, so the lists they return can share cells
+ * with the ones they were given.
+ * */
+
+struct expr native_length(struct expr args) {
+    return expr_create_integer(list_length(args.car));
+}
+
+struct expr native_append(struct expr args) {
+    return EXPR(list_append(args.car, CDR(args).car));
+}
+
+struct expr native_reverse(struct expr args) {
+    return EXPR(list_reverse(args.car));
+}
+
+/* (#nth list n), nil past the end */
+struct expr native_nth(struct expr args) {
+    assert(CAR(CDR(args)).integer >= 0 && "#nth: negative index");
+
+    return list_nth(args.car, CAR(CDR(args)).integer);
+}
+
+struct expr native_last(struct expr args) {
+    return list_last(args.car);
+}
+
+struct expr native_list_vector(struct expr args) {
+    return expr_create_vector(list_to_vector(args.car));
+}
+
+/* (#filter pred list) */
+struct expr native_filter(struct expr args) {
+    return EXPR(list_filter(CDR(args).car, CAR(args)));
+}
+
+struct expr native_sort(struct expr args) {
+    return EXPR(list_sort(args.car));
+}
@@ -8,5 +8,35 @@ typedef struct expr(*native_fn)(struct expr args);
 struct expr native_display(struct expr args);
 struct expr native_hello(struct expr args);
 struct expr native_add(struct expr args);
+struct expr native_chan(struct expr args);
+struct expr native_send(struct expr args);
+struct expr native_recv(struct expr args);
+struct expr native_pmap(struct expr args);
+struct expr native_read_file(struct expr args);
+struct expr native_sleep(struct expr args);
+struct expr native_vector_sum(struct expr args);
+struct expr native_vector_dot(struct expr args);
+struct expr native_vector_scale(struct expr args);
+struct expr native_vector_add(struct expr args);
+struct expr native_vector_mul(struct expr args);
+struct expr native_vector_min(struct expr args);
+struct expr native_vector_max(struct expr args);
+struct expr native_string_length(struct expr args);
+struct expr native_substring(struct expr args);
+struct expr native_string_append(struct expr args);
+struct expr native_string_equal(struct expr args);
+struct expr native_string_symbol(struct expr args);
+struct expr native_symbol_string(struct expr args);
+struct expr native_builder(struct expr args);
+struct expr native_builder_append(struct expr args);
+struct expr native_builder_string(struct expr args);
+struct expr native_length(struct expr args);
+struct expr native_append(struct expr args);
+struct expr native_reverse(struct expr args);
+struct expr native_nth(struct expr args);
+struct expr native_last(struct expr args);
+struct expr native_list_vector(struct expr args);
+struct expr native_filter(struct expr args);
+struct expr native_sort(struct expr args);
 
 #endif  /* __NATIVE_H */
@@ -0,0 +1,105 @@
+#include "pack.h"
+
+/* Where a cell points to text outside of itself, symbols and strings that aren't small */
+static char** text_of(struct expr* cell, u32* length) {
+    if (cell->type == EXPR_SYMBOL) {
+        *length = cell->length;
+        return &cell->symbol;
+    }
+
+    if (cell->type == EXPR_STRING && cell->small_length == EXPR_STRING_SLICE) {
+        *length = cell->size;
+        return &cell->string;
+    }
+
+    return NULL;
+}
+
+/* Copies the text of a cell into the arena, so it outlives where it came from */
+static void rehome_text(struct expr* cell) {
+    char** text;
+    char* copy;
+    u32 length;
+
+    if (!(text = text_of(cell, &length))) return;
+
+    copy = arena_alloc(&expr_arena, length);
+    memcpy(copy, *text, length);
+    *text = copy;
+}
+
+/*
+ * Flattens value in breadth first order, so every cons points further along.
+ * Nothing can mutate a cons, so there are no cycles to worry about, shared
+ * tails just get copied twice.
+ * */
+struct packed_expr* expr_pack(struct expr value) {
+    struct dynarray(expr) cells = {0};
+    struct packed_expr* packed;
+    usize text = 0;
+    usize size, i;
+    u32 car, cdr, length;
+    char* cursor;
+    char** bytes;
+
+    dynarray__expr_push(&cells, expr_create_nil());
+    dynarray__expr_push(&cells, value);
+
+    for (i = 1; i < cells.length; ++i) {
+        if (text_of(&cells.at[i], &length)) text += length;
+        if (cells.at[i].type != EXPR_CONS) continue;
+
+        /* pushing can move the cells around */
+        car = cells.at[i].car;
+        cdr = cells.at[i].cdr;
+
+        if (car) {
+            dynarray__expr_push(&cells, EXPR(car));
+            cells.at[i].car = cells.length - 1;
+        }
+
+        if (cdr) {
+            dynarray__expr_push(&cells, EXPR(cdr));
+            cells.at[i].cdr = cells.length - 1;
+        }
+    }
+
+    size = sizeof(struct packed_expr) + sizeof(struct expr) * cells.length + text;
+    packed = malloc(size);
+    assert(packed);
+
+    packed->size = size;
+    packed->length = cells.length;
+    memcpy(packed->cells, cells.at, sizeof(struct expr) * cells.length);
+
+    cursor = (char*)(packed->cells + cells.length);
+
+    for (i = 1; i < packed->length; ++i) {
+        if (!(bytes = text_of(&packed->cells[i], &length))) continue;
+
+        memcpy(cursor, *bytes, length);
+        *bytes = cursor;
+        cursor += length;
+    }
+
+    DYNARRAY_FREE(&cells);
+
+    return packed;
+}
+
+struct expr expr_unpack(const struct packed_expr* packed) {
+    struct expr value = packed->cells[1];
+    u32 base, i;
+
+    /* the packed value can be freed, so text needs a home of its own */
+    if (packed->length == 2) {
+        rehome_text(&value);
+        return value;
+    }
+
+    base = expr_heap_copy(packed->cells, packed->length);
+
+    for (i = base + 1; i < exprs.length; ++i) rehome_text(&EXPR(i));
+
+    return EXPR(base + 1);
+}
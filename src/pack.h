@@ -0,0 +1,31 @@
+#ifndef __PACK_H
+#define __PACK_H
+
+#include "common.h"
+#include "expr.h"
+
+/*
+ * A value copied out of whatever heap it was built in, so it can be handed to
+ * a vm with another heap. It's one allocation: the cells laid out like a heap
+ * with nil first and the value second, then the text of every symbol and
+ * string in it that isn't stored in its cell.
+ * */
+struct packed_expr {
+    usize size;
+    u32 length; /* of cells */
+    struct expr cells[];
+};
+
+/* Whether value points into the current heap or arena, anything else can be handed over as is */
+static inline bool expr_needs_pack(struct expr value) {
+    if (value.type == EXPR_STRING) return value.small_length == EXPR_STRING_SLICE;
+    return value.type == EXPR_CONS || value.type == EXPR_SYMBOL;
+}
+
+/* Copies value out of the current heap, free the result with free */
+struct packed_expr* expr_pack(struct expr value);
+
+/* Copies a packed value into the current heap and arena */
+struct expr expr_unpack(const struct packed_expr* packed);
+
+#endif  /*__PACK_H*/
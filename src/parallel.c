@@ -0,0 +1,235 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "parallel.h"
+#include "reader.h"
+#include "scan.h"
+
+/* A slice of the source that starts and ends between top-level forms */
+struct chunk {
+    usize start;
+    usize end;
+
+    /* filled in by whichever thread reads the chunk */
+    struct dynarray(expr) heap;
+    struct arena arena; /* the strings decoded into the heap */
+    struct dynarray(u32) forms;
+    u32 error_code;
+    bool stopped; /* an empty list ended reading before the end of the chunk */
+};
+
+DYNARRAY_DECL_S(chunk);
+DYNARRAY_IMPL_S(chunk);
+
+struct parallel_job {
+    struct slice(char) src;
+    struct dynarray(chunk) chunks;
+    usize next_chunk;
+};
+
+usize parallel_default_threads(usize src_length) {
+    long cpus;
+
+    if (src_length < PARALLEL_READ_MIN_SIZE) return 1;
+
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (usize)cpus : 1;
+}
+
+/*
+ * Cuts src into roughly count chunks by tracking the paren depth, stepping
+ * over comments and strings so parens inside of them don't count. A cut is only made right
+ * after whitespace at depth zero, so no form or token is ever split, and every
+ * chunk but the last ends in whitespace.
+ * */
+static void prescan(struct slice(char) src, usize count, struct dynarray(chunk)* chunks) {
+    usize chunk_size = src.length / count + 1;
+    usize next_cut = chunk_size;
+    struct chunk chunk = {0};
+    usize depth = 0;
+    usize i = 0;
+
+    while (i < src.length) {
+        switch (src.ptr[i]) {
+            case '(':
+                depth += 1;
+                break;
+            case ')':
+                /* unbalanced parens are left for the reader to complain about */
+                if (depth > 0) depth -= 1;
+                break;
+            case '"':
+                /* neither do parens or spaces in a string */
+                i = scan_string_end(src.ptr, i, src.length);
+                break;
+            case ';':
+                if (i + 1 < src.length && src.ptr[i + 1] == ';') {
+                    i = scan_find_newline(src.ptr, i, src.length);
+                    continue;
+                }
+                break;
+            case '\n':
+            case ' ':
+            case '\t':
+            case '\r':
+                if (depth == 0 && i >= next_cut) {
+                    chunk.end = i + 1;
+                    dynarray__chunk_push(chunks, chunk);
+
+                    chunk = (struct chunk){0};
+                    chunk.start = i + 1;
+                    next_cut = i + chunk_size;
+                }
+                break;
+        }
+
+        i += 1;
+    }
+
+    chunk.end = src.length;
+    dynarray__chunk_push(chunks, chunk);
+}
+
+/* Reads a chunk into whatever heap the current thread has */
+static void read_chunk(struct slice(char) src, struct chunk* chunk, bool quiet) {
+    struct reader reader;
+    u32 ptr;
+
+    reader = reader_create_borrowed((struct slice(char)){src.ptr, chunk->end});
+    reader.cursor = chunk->start;
+    reader.quiet = quiet;
+
+    while ((ptr = read_expr(&reader)) != 0) {
+        if (ptr == READER_ERROR) {
+            chunk->error_code = reader.error_code;
+            break;
+        }
+
+        dynarray__u32_push(&chunk->forms, ptr);
+    }
+
+    /*
+     * read_expr also returns 0 for '()', which ends reading just like it does
+     * for the serial reader. Since chunks end in whitespace, reaching the real
+     * end of the chunk always leaves the cursor at its end.
+     * */
+    if (ptr == 0) chunk->stopped = reader.cursor < chunk->end;
+
+    reader_destroy(&reader);
+}
+
+static void* read_worker(void* arg) {
+    struct parallel_job* job = arg;
+    struct dynarray(expr) saved = exprs;
+    struct arena saved_arena = expr_arena;
+    struct chunk* chunk;
+    usize i;
+
+    while ((i = __atomic_fetch_add(&job->next_chunk, 1, __ATOMIC_RELAXED)) < job->chunks.length) {
+        chunk = &job->chunks.at[i];
+
+        /* every heap starts with nil at index 0, just like the main one */
+        exprs = (struct dynarray(expr)){0};
+        expr_arena = (struct arena){0};
+        expr_new_nil();
+
+        read_chunk(job->src, chunk, true);
+
+        chunk->heap = exprs;
+        chunk->arena = expr_arena;
+    }
+
+    exprs = saved;
+    expr_arena = saved_arena;
+
+    return NULL;
+}
+
+static u32 read_serial(struct slice(char) src, struct dynarray(u32)* forms) {
+    struct reader reader = reader_create_borrowed(src);
+    u32 ptr;
+
+    u32 error_code = 0;
+
+    while ((ptr = read_expr(&reader)) != 0) {
+        if (ptr == READER_ERROR) {
+            error_code = reader.error_code;
+            break;
+        }
+
+        dynarray__u32_push(forms, ptr);
+    }
+
+    reader_destroy(&reader);
+
+    return error_code;
+}
+
+u32 parallel_read_forms(struct slice(char) src, usize threads, struct dynarray(u32)* forms) {
+    struct parallel_job job = {0};
+    struct chunk* chunk;
+    pthread_t* helpers;
+    usize helpers_started = 0;
+    u32 error_code = 0;
+    bool done = false;
+    usize i, j;
+    u32 base;
+
+    if (threads <= 1) return read_serial(src, forms);
+
+    /* pick the scanning level up front instead of racing to it in the workers */
+    scan_get_level();
+
+    job.src = src;
+    prescan(src, threads * PARALLEL_CHUNKS_PER_THREAD, &job.chunks);
+
+    helpers = malloc(sizeof(pthread_t) * (threads - 1));
+    assert(helpers);
+
+    for (i = 0; i < threads - 1; ++i) {
+        if (pthread_create(&helpers[helpers_started], NULL, read_worker, &job) != 0) break;
+        helpers_started += 1;
+    }
+
+    /* the calling thread pitches in too */
+    read_worker(&job);
+
+    for (i = 0; i < helpers_started; ++i) {
+        pthread_join(helpers[i], NULL);
+    }
+
+    free(helpers);
+
+    for (i = 0; i < job.chunks.length; ++i) {
+        chunk = &job.chunks.at[i];
+
+        if (!done && chunk->error_code != 0) {
+            /* read it again out loud so the first error gets reported */
+            DYNARRAY_FREE(&chunk->forms);
+            chunk->forms = (struct dynarray(u32)){0};
+            read_chunk(src, chunk, false);
+            error_code = chunk->error_code;
+            done = true;
+        }
+
+        if (!done) {
+            base = expr_heap_adopt(&chunk->heap);
+            arena_adopt(&expr_arena, &chunk->arena);
+            for (j = 0; j < chunk->forms.length; ++j) {
+                dynarray__u32_push(forms, chunk->forms.at[j] + base);
+            }
+
+            done = chunk->stopped;
+        }
+
+        DYNARRAY_FREE(&chunk->heap);
+        DYNARRAY_FREE(&chunk->forms);
+        arena_destroy(&chunk->arena);
+    }
+
+    DYNARRAY_FREE(&job.chunks);
+
+    return error_code;
+}
@@ -0,0 +1,30 @@
+#ifndef __PARALLEL_H
+#define __PARALLEL_H
+
+#include "common.h"
+#include "expr.h"
+
+/* Sources smaller than this are read on one thread unless asked otherwise */
+#define PARALLEL_READ_MIN_SIZE (MEGABYTES(4))
+
+/* How many chunks each thread gets, so uneven chunks even out */
+#define PARALLEL_CHUNKS_PER_THREAD 4
+
+/* The thread count to use when the user did not pick one */
+usize parallel_default_threads(usize src_length);
+
+/*
+ * Reads every top-level form in src and pushes their roots onto forms in source
+ * order, the same forms read_expr would have returned one at a time.
+ *
+ * With more than one thread, a pre-scan cuts the source into chunks at
+ * top-level boundaries, each chunk is read into a thread local heap, and the
+ * heaps are stitched onto the end of the calling thread's heap in order with
+ * their indices relocated.
+ *
+ * Symbols are borrowed from src. Returns 0, or the reader error code of the
+ * first error in the source after printing it.
+ * */
+u32 parallel_read_forms(struct slice(char) src, usize threads, struct dynarray(u32)* forms);
+
+#endif  /*__PARALLEL_H*/
@@ -0,0 +1,173 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "pipeline.h"
+#include "compiler.h"
+#include "reader.h"
+#include "scan.h"
+
+/* How many times to spin on the queue before yielding the cpu */
+#define PIPELINE_SPINS 64
+
+struct pipeline_batch {
+    struct dynarray(expr) heap;
+    struct arena arena; /* the strings decoded into the heap */
+    struct dynarray(u32) forms;
+    u32 error_code;
+    bool last;
+};
+
+/* 
+ * A ring of batches where only the reader thread moves the tail and only the
+ * vm thread moves the head. Both only ever grow, the slot is the index masked
+ * by the capacity.
+ * */
+struct pipeline_queue {
+    struct pipeline_batch slots[PIPELINE_QUEUE_CAPACITY];
+    usize head;
+    usize tail;
+};
+
+struct pipeline {
+    struct slice(char) src;
+    struct pipeline_queue queue;
+    bool stop; /* set by the vm thread when it won't take any more batches */
+};
+
+static inline void backoff(u32* spins) {
+    if (*spins < PIPELINE_SPINS) *spins += 1;
+    else sched_yield();
+}
+
+/* Returns false if the vm thread stopped instead of making room */
+static bool queue_push(struct pipeline* pipeline, struct pipeline_batch* batch) {
+    struct pipeline_queue* queue = &pipeline->queue;
+    usize tail = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    u32 spins = 0;
+
+    while (tail - __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) == PIPELINE_QUEUE_CAPACITY) {
+        if (__atomic_load_n(&pipeline->stop, __ATOMIC_RELAXED)) return false;
+        backoff(&spins);
+    }
+
+    queue->slots[tail & (PIPELINE_QUEUE_CAPACITY - 1)] = *batch;
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/* Returns false if the queue is empty and wait is false */
+static bool queue_pop(struct pipeline_queue* queue, struct pipeline_batch* batch, bool wait) {
+    usize head = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    u32 spins = 0;
+
+    while (__atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) == head) {
+        if (!wait) return false;
+        backoff(&spins);
+    }
+
+    *batch = queue->slots[head & (PIPELINE_QUEUE_CAPACITY - 1)];
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+static void* pipeline_reader(void* arg) {
+    struct pipeline* pipeline = arg;
+    struct reader reader = reader_create_borrowed(pipeline->src);
+    struct pipeline_batch batch = {0};
+    u32 ptr;
+
+    exprs = (struct dynarray(expr)){0};
+    expr_new_nil();
+
+    for (;;) {
+        ptr = read_expr(&reader);
+
+        if (ptr == READER_ERROR) batch.error_code = reader.error_code;
+        else if (ptr != 0) dynarray__u32_push(&batch.forms, ptr);
+
+        batch.last = ptr == 0 || ptr == READER_ERROR;
+        if (!batch.last && exprs.length < PIPELINE_BATCH_CELLS) continue;
+
+        /* the batch takes the heap with it, the next one starts a new heap */
+        batch.heap = exprs;
+        batch.arena = expr_arena;
+        exprs = (struct dynarray(expr)){0};
+        expr_arena = (struct arena){0};
+
+        if (!queue_push(pipeline, &batch)) {
+            DYNARRAY_FREE(&batch.heap);
+            arena_destroy(&batch.arena);
+            DYNARRAY_FREE(&batch.forms);
+            break;
+        }
+
+        if (batch.last) break;
+
+        batch = (struct pipeline_batch){0};
+        expr_new_nil();
+    }
+
+    reader_destroy(&reader);
+
+    return NULL;
+}
+
+u8 pipeline_run(struct vm* vm, struct slice(char) src) {
+    struct pipeline pipeline = {0};
+    struct pipeline_batch batch;
+    struct module module = {0};
+    struct compiler compiler = {0};
+    pthread_t reader_thread;
+    u8 ret = COMPILE_OK;
+    u32 base, i;
+
+    pipeline.src = src;
+
+    /* pick the scanning level here instead of in the middle of the reader thread */
+    scan_get_level();
+
+    if (pthread_create(&reader_thread, NULL, pipeline_reader, &pipeline) != 0) {
+        fprintf(stderr, "[pipeline] error: failed to start the reader thread\n");
+        return COMPILE_READER_ERROR;
+    }
+
+    /* the compiler's reader is only there to give errors their locations */
+    compiler_init(&compiler, reader_create_borrowed(src), &module);
+
+    do {
+        queue_pop(&pipeline.queue, &batch, true);
+        base = expr_heap_adopt(&batch.heap);
+        arena_adopt(&expr_arena, &batch.arena);
+
+        for (i = 0; i < batch.forms.length && ret == COMPILE_OK && vm->running; ++i) {
+            module_clear(&module);
+
+            ret = compile_form(&compiler, EXPR(batch.forms.at[i] + base));
+
+            if (ret == COMPILE_OK) vm_run(vm, &module);
+        }
+
+        if (ret == COMPILE_OK && batch.error_code != 0) ret = COMPILE_READER_ERROR;
+
+        DYNARRAY_FREE(&batch.forms);
+    } while (!batch.last && ret == COMPILE_OK && vm->running);
+
+    /* let the reader give up on a full queue, then throw away what it got to */
+    __atomic_store_n(&pipeline.stop, true, __ATOMIC_RELAXED);
+    pthread_join(reader_thread, NULL);
+
+    while (queue_pop(&pipeline.queue, &batch, false)) {
+        DYNARRAY_FREE(&batch.heap);
+        DYNARRAY_FREE(&batch.forms);
+        arena_destroy(&batch.arena);
+    }
+
+    module_destroy(&module);
+    compiler_destroy(&compiler);
+
+    return ret;
+}
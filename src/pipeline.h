@@ -0,0 +1,28 @@
+#ifndef __PIPELINE_H
+#define __PIPELINE_H
+
+#include "common.h"
+#include "vm.h"
+
+/* How many cells a batch of forms grows to before the reader hands it over */
+#define PIPELINE_BATCH_CELLS 4096
+
+/* How many batches the reader can get ahead of the vm, a power of two */
+#define PIPELINE_QUEUE_CAPACITY 64
+
+/*
+ * Reads, compiles, and runs every top-level form of src, with the reading done
+ * on a thread of its own so parsing overlaps with execution.
+ *
+ * The reader thread parses batches of forms into a heap per batch and passes
+ * them through a bounded single producer, single consumer queue. The calling
+ * thread adopts each heap into its own and compiles and runs the forms one at
+ * a time, in order.
+ *
+ * Unlike compiling the whole file up front, every form before a reader or
+ * compile error has already run by the time the error stops the pipeline.
+ * Returns COMPILE_OK or the error that stopped it.
+ * */
+u8 pipeline_run(struct vm* vm, struct slice(char) src);
+
+#endif  /*__PIPELINE_H*/
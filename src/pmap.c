@@ -0,0 +1,343 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <sched.h>
+#include <unistd.h>
+
+#include "pmap.h"
+#include "builtin.h"
+#include "pack.h"
+
+#define PMAP_EMPTY UINT64_MAX
+
+struct pmap_job {
+    native_fn fn;
+    usize count;
+    usize grain;
+
+    struct expr* in;
+    struct packed_expr** in_packed; /* for elements that need copying into a worker's heap */
+    struct expr* out;
+    struct packed_expr** out_packed;
+
+    struct pmap_deque* deques; /* one per worker and one for the caller */
+    usize deque_count;
+    usize remaining;           /* elements not mapped yet */
+    usize checked_out;         /* workers that are done looking at the job */
+};
+
+static inline u64 range_pack(u32 start, u32 end) {
+    return ((u64)start << 32) | end;
+}
+
+/* Deques */
+
+static void deque_push(struct pmap_deque* deque, u64 range) {
+    isize bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+
+    assert(bottom - __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE) < PMAP_DEQUE_CAPACITY);
+
+    __atomic_store_n(&deque->ranges[bottom & (PMAP_DEQUE_CAPACITY - 1)], range, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+}
+
+static u64 deque_take(struct pmap_deque* deque) {
+    isize bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    isize top;
+    u64 range;
+
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+    if (top > bottom) {
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return PMAP_EMPTY;
+    }
+
+    range = __atomic_load_n(&deque->ranges[bottom & (PMAP_DEQUE_CAPACITY - 1)], __ATOMIC_RELAXED);
+
+    /* the last one, a thief might be going for it too */
+    if (top == bottom) {
+        if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            range = PMAP_EMPTY;
+
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+
+    return range;
+}
+
+static u64 deque_steal(struct pmap_deque* deque) {
+    isize top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    isize bottom;
+    u64 range;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+
+    if (top >= bottom) return PMAP_EMPTY;
+
+    range = __atomic_load_n(&deque->ranges[top & (PMAP_DEQUE_CAPACITY - 1)], __ATOMIC_RELAXED);
+
+    if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return PMAP_EMPTY;
+
+    return range;
+}
+
+/* Mapping */
+
+static struct expr call(native_fn fn, struct expr element) {
+    /* the heap can move while making the cell, so only index into it after */
+    u32 args = expr_new_cons(expr_box(element), 0);
+
+    return fn(EXPR(args));
+}
+
+static void map_range(struct pmap_job* job, u32 start, u32 end, bool caller) {
+    u32 mark = exprs.length;
+    struct expr element, result;
+    u32 i;
+
+    for (i = start; i < end; ++i) {
+        /* the caller's heap is where the elements came from */
+        element = caller || !job->in_packed[i] ? job->in[i] : expr_unpack(job->in_packed[i]);
+        result = call(job->fn, element);
+
+        if (!caller && expr_needs_pack(result)) job->out_packed[i] = expr_pack(result);
+        else job->out[i] = result;
+    }
+
+    if (!caller) exprs.length = mark;
+}
+
+static void work(struct pmap_job* job, usize self) {
+    struct pmap_deque* deque = &job->deques[self];
+    usize victim = self;
+    u64 range;
+    u32 start, end, middle;
+    u32 spins = 0;
+
+    while (__atomic_load_n(&job->remaining, __ATOMIC_ACQUIRE) > 0) {
+        range = deque_take(deque);
+
+        if (range == PMAP_EMPTY) {
+            victim = (victim + 1) % job->deque_count;
+            if (victim != self) range = deque_steal(&job->deques[victim]);
+        }
+
+        if (range == PMAP_EMPTY) {
+            if (++spins > 64) sched_yield();
+            continue;
+        }
+
+        spins = 0;
+        start = range >> 32;
+        end = (u32)range;
+
+        /* leave the back half for someone else */
+        while (end - start > job->grain) {
+            middle = start + (end - start) / 2;
+            deque_push(deque, range_pack(middle, end));
+            end = middle;
+        }
+
+        map_range(job, start, end, self == 0);
+        __atomic_sub_fetch(&job->remaining, end - start, __ATOMIC_RELEASE);
+    }
+}
+
+static void* worker_main(void* arg) {
+    struct pmap_worker* worker = arg;
+    struct pmap_pool* pool = worker->pool;
+    struct pmap_job* job;
+    u64 generation = 0;
+
+    isolate_enter(&worker->isolate);
+
+    for (;;) {
+        pthread_mutex_lock(&pool->wake_lock);
+        while (pool->generation == generation && !pool->stopping) {
+            pthread_cond_wait(&pool->wake, &pool->wake_lock);
+        }
+
+        if (pool->stopping) {
+            pthread_mutex_unlock(&pool->wake_lock);
+            break;
+        }
+
+        generation = pool->generation;
+        job = pool->job;
+        pthread_mutex_unlock(&pool->wake_lock);
+
+        work(job, worker->index);
+
+        /* every result got packed, so nothing in here is needed anymore */
+        arena_clear(&expr_arena);
+
+        __atomic_add_fetch(&job->checked_out, 1, __ATOMIC_RELEASE);
+    }
+
+    isolate_leave(&worker->isolate);
+
+    return NULL;
+}
+
+void pmap_pool_init(struct pmap_pool* pool, usize threads) {
+    usize i;
+
+    *pool = (struct pmap_pool){0};
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_mutex_init(&pool->wake_lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+
+    if (threads == 0) return;
+
+    pool->workers = calloc(threads, sizeof(struct pmap_worker));
+    assert(pool->workers);
+
+    for (i = 0; i < threads; ++i) {
+        pool->workers[pool->count] = (struct pmap_worker){ .pool = pool, .index = pool->count + 1 };
+        if (pthread_create(&pool->workers[pool->count].thread, NULL, worker_main, &pool->workers[pool->count]) != 0) break;
+        pool->count += 1;
+    }
+}
+
+void pmap_pool_destroy(struct pmap_pool* pool) {
+    usize i;
+
+    pthread_mutex_lock(&pool->wake_lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->wake_lock);
+
+    for (i = 0; i < pool->count; ++i) {
+        pthread_join(pool->workers[i].thread, NULL);
+        isolate_destroy(&pool->workers[i].isolate);
+    }
+
+    free(pool->workers);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->wake_lock);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+static struct expr map_sequential(native_fn fn, struct expr* elements, usize count) {
+    struct expr* results = malloc(sizeof(struct expr) * (count ? count : 1));
+    u32 list = 0;
+    usize i;
+
+    assert(results);
+
+    for (i = 0; i < count; ++i) {
+        results[i] = call(fn, elements[i]);
+    }
+
+    for (i = count; i > 0; --i) {
+        list = expr_new_cons(expr_box(results[i - 1]), list);
+    }
+
+    free(results);
+
+    return EXPR(list);
+}
+
+static struct expr map_parallel(struct pmap_pool* pool, native_fn fn, struct expr* elements, usize count) {
+    struct pmap_job job = {0};
+    u32 list = 0;
+    usize i;
+
+    job.fn = fn;
+    job.count = count;
+    job.in = elements;
+    job.in_packed = calloc(count, sizeof(struct packed_expr*));
+    job.out = calloc(count, sizeof(struct expr));
+    job.out_packed = calloc(count, sizeof(struct packed_expr*));
+    job.deque_count = pool->count + 1;
+    job.deques = calloc(job.deque_count, sizeof(struct pmap_deque));
+    job.remaining = count;
+
+    assert(job.in_packed && job.out && job.out_packed && job.deques);
+
+    /* enough ranges that everyone gets a few to balance out */
+    job.grain = count / (job.deque_count * 8);
+    if (job.grain < PMAP_GRAIN_MIN) job.grain = PMAP_GRAIN_MIN;
+
+    for (i = 0; i < count; ++i) {
+        if (expr_needs_pack(elements[i])) job.in_packed[i] = expr_pack(elements[i]);
+    }
+
+    deque_push(&job.deques[0], range_pack(0, count));
+
+    pthread_mutex_lock(&pool->wake_lock);
+    pool->job = &job;
+    pool->generation += 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->wake_lock);
+
+    work(&job, 0);
+
+    /* they might still be looking at the deques */
+    while (__atomic_load_n(&job.checked_out, __ATOMIC_ACQUIRE) < pool->count) sched_yield();
+
+    for (i = count; i > 0; --i) {
+        if (job.out_packed[i - 1]) {
+            job.out[i - 1] = expr_unpack(job.out_packed[i - 1]);
+            free(job.out_packed[i - 1]);
+        }
+
+        list = expr_new_cons(expr_box(job.out[i - 1]), list);
+    }
+
+    for (i = 0; i < count; ++i) free(job.in_packed[i]);
+
+    free(job.in_packed);
+    free(job.out);
+    free(job.out_packed);
+    free(job.deques);
+
+    return EXPR(list);
+}
+
+struct expr pmap_pool_run(struct pmap_pool* pool, struct expr fn, struct expr list) {
+    struct dynarray(expr) elements = {0};
+    struct expr result;
+
+    assert(nativep(fn) && fn.arity == 1);
+
+    for (; consp(list); list = CDR(list)) {
+        assert(builtin_check_arg(fn, 0, CAR(list)) && "The element doesn't fit the native's signature");
+        dynarray__expr_push(&elements, CAR(list));
+    }
+
+    if (pool->count == 0 || elements.length < PMAP_SEQUENTIAL_MAX || pthread_mutex_trylock(&pool->lock) != 0) {
+        result = map_sequential(fn.native, elements.at, elements.length);
+    } else {
+        result = map_parallel(pool, fn.native, elements.at, elements.length);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    DYNARRAY_FREE(&elements);
+
+    return result;
+}
+
+static struct pmap_pool default_pool;
+static pthread_once_t default_once = PTHREAD_ONCE_INIT;
+
+static void default_pool_init(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    /* the caller makes one more */
+    pmap_pool_init(&default_pool, cpus > 1 ? cpus - 1 : 0);
+}
+
+struct expr pmap(struct expr fn, struct expr list) {
+    pthread_once(&default_once, default_pool_init);
+
+    return pmap_pool_run(&default_pool, fn, list);
+}
@@ -0,0 +1,77 @@
+#ifndef __PMAP_H
+#define __PMAP_H
+
+#include <pthread.h>
+
+#include "common.h"
+#include "expr.h"
+#include "isolate.h"
+
+/* Lists shorter than this get mapped on the calling thread */
+#define PMAP_SEQUENTIAL_MAX 2048
+
+/* The fewest elements a worker splits a range down to */
+#define PMAP_GRAIN_MIN 64
+
+/* How many ranges a deque holds, halving a u32 range can't nest deeper */
+#define PMAP_DEQUE_CAPACITY 64
+
+struct pmap_job;
+
+/*
+ * A Chase-Lev deque of ranges of elements. The owner pushes and takes at the
+ * bottom without contention, thieves take from the top with a compare and
+ * swap. Ranges are packed into a u64 so they can be read atomically.
+ * */
+struct pmap_deque {
+    isize top;
+    char pad[64];
+    isize bottom;
+    u64 ranges[PMAP_DEQUE_CAPACITY];
+};
+
+struct pmap_worker {
+    pthread_t thread;
+    struct isolate isolate; /* elements get unpacked and mapped in here */
+    struct pmap_pool* pool;
+    usize index;            /* its deque, the caller always has deque 0 */
+};
+
+/*
+ * A pool of threads that map natives over lists. Every worker has a heap of
+ * its own, the caller pitches in with its own heap too.
+ *
+ * Work starts out as one range in the caller's deque. Whoever takes a range
+ * keeps splitting it in half, pushing the back half for others to steal,
+ * until it's down to the grain, then maps it. So idle workers end up stealing
+ * big ranges and the busy ones keep the small ones for themselves.
+ * */
+struct pmap_pool {
+    struct pmap_worker* workers;
+    usize count;
+
+    pthread_mutex_t lock;   /* one job at a time */
+    pthread_mutex_t wake_lock;
+    pthread_cond_t wake;
+    struct pmap_job* job;
+    u64 generation;         /* bumped for every job */
+    bool stopping;
+};
+
+/* A pool with no threads maps everything on the caller */
+void pmap_pool_init(struct pmap_pool* pool, usize threads);
+void pmap_pool_destroy(struct pmap_pool* pool);
+
+/*
+ * Calls fn, a native taking one argument, on every element of list and
+ * returns a list of the results in the same order, in the current heap.
+ * Conses and symbols are copied into a worker's heap to be mapped and their
+ * results copied back. Falls back to mapping on the caller for short lists,
+ * or when the pool is busy with another job, pmap inside of pmap included.
+ * */
+struct expr pmap_pool_run(struct pmap_pool* pool, struct expr fn, struct expr list);
+
+/* The same, with a pool of one thread per cpu made on first use */
+struct expr pmap(struct expr fn, struct expr list);
+
+#endif  /*__PMAP_H*/
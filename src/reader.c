@@ -4,77 +4,42 @@
 
 #include "expr.h"
 #include "reader.h"
+#include "scan.h"
 
 struct reader reader_create(struct slice(char) src) {
-    return (struct reader){ src, (struct file_location){ 1, 1 }, 0, 0 };
+    return (struct reader){ src, 0, 0, false, false, line_index_create(src), 0 };
 }
 
-static inline void advance(struct reader* reader) {
-    reader->current_location.column += 1;
-
-    if (reader->src.ptr[reader->cursor] == '\n') {
-        reader->current_location.line += 1;
-        reader->current_location.column = 1;
-    }
+struct reader reader_create_borrowed(struct slice(char) src) {
+    return (struct reader){ src, 0, 0, true, false, line_index_create(src), 0 };
+}
 
-    reader->cursor += 1;
+void reader_destroy(struct reader* reader) {
+    line_index_destroy(&reader->lines);
 }
 
-static inline bool is_space(char c) {
-    switch (c) {
-        case ' ':
-        case '\n':
-        case '\t':
-        case '\r':
-            return true;
-    }
+struct file_location reader_location(struct reader* reader, u32 offset) {
+    struct file_location loc = line_index_lookup(&reader->lines, offset);
 
-    return false;
-}
+    loc.line += reader->line_base;
 
-static inline bool is_digit(char c) { return '0' <= c && c <= '9'; }
-
-static inline bool is_alpha(char c) {
-    return (('A' <= c && c <= 'Z') || ('a' <= c && c <= 'z') || c == '_');
-}
-
-static inline bool is_special_char(char c) {
-    switch (c) {
-        case '?':
-        case '!':
-        case '.':
-        case '+':
-        case '-':
-        case '*':
-        case '/':
-        case '<':
-        case '=':
-        case '>':
-        case ':':
-        case '$':
-        case '%':
-        case '^':
-        case '&':
-        case '_':
-        case '~':
-        case '#':
-            return true;
-        default:
-            return false;
-    }
+    return loc;
 }
 
-static inline bool is_symbol(char c) {
-    return is_digit(c) || is_alpha(c) || is_special_char(c);
+static inline void advance(struct reader* reader) {
+    reader->cursor += 1;
 }
 
+static inline bool is_digit(char c) { return SCAN_IS(c, SCAN_CLASS_DIGIT); }
+
+static inline bool is_symbol(char c) { return SCAN_IS(c, SCAN_CLASS_SYMBOL); }
+
 static inline u8 bound(struct reader* reader) {
     return reader->cursor < reader->src.length;
 }
 
 static inline void skip_space(struct reader* reader) {
-    while (bound(reader) && is_space(reader->src.ptr[reader->cursor]))
-        advance(reader);
+    reader->cursor = scan_skip_space(reader->src.ptr, reader->cursor, reader->src.length);
 }
 
 static inline char char_at(struct reader* reader) {
@@ -87,63 +52,211 @@ static inline char char_peek(struct reader* reader) {
 }
 
 static inline void skip_comment(struct reader* reader) {
-    while (bound(reader) && char_at(reader) != '\n') {
-        advance(reader);
-    }
+    reader->cursor = scan_find_newline(reader->src.ptr, reader->cursor, reader->src.length);
 
-    advance(reader);
+    /* step over the newline itself */
+    if (bound(reader)) advance(reader);
 }
 
-u32 read_expr(struct reader* reader) {
-read_expr_begin:
-    struct file_location loc;
-    u32 ptr;
+/* An open list while reading, lists are built front to back through the tail */
+struct reader_frame {
+    u32 head;
+    u32 tail;
+    u32 length;
+    u32 offset;
+};
 
-    skip_space(reader);
+/* Lists nested deeper than this spill their frames onto the heap */
+/* How far reader_slide looks back for the start of a line */
+#define READER_SLIDE_LINE_MAX KILOBYTES(64)
 
-    /* we've reached the end of the string */
-    if (!bound(reader)) return 0;
+#define READER_FRAMES_INLINE 64
 
-    loc = reader->current_location;
+static inline void skip_trivia(struct reader* reader) {
+    for (;;) {
+        skip_space(reader);
+
+        if (!bound(reader) || char_at(reader) != ';' || char_peek(reader) != ';') return;
 
-    if (char_at(reader) == ';' && char_peek(reader) == ';') {
         advance(reader);
         advance(reader);
         skip_comment(reader);
-        goto read_expr_begin;
     }
+}
 
-    if (char_at(reader) == '(') {
-        advance(reader);
-        ptr = read_cons(reader);
-    } else {
-        ptr = read_atom(reader);
+/* 
+ * Every cell of the spine gets the length of the list from that cell onwards,
+ * which is known once the list is closed.
+ * */
+static u32 close_list(struct reader_frame* frame) {
+    u32 remaining = frame->length;
+    u32 cell = frame->head;
+
+    while (cell != 0) {
+        EXPR(cell).length = remaining < EXPR_LENGTH_MAX ? remaining : EXPR_LENGTH_MAX;
+        remaining -= 1;
+        cell = EXPR(cell).cdr;
     }
 
-    if (ptr != READER_ERROR) {
-        EXPR(ptr).loc = loc;
+    if (frame->head != 0) EXPR(frame->head).offset = frame->offset;
+
+    return frame->head;
+}
+
+bool reader_check_length(struct slice(char) src) {
+    if (src.length <= READER_SRC_MAX) return true;
+
+    fprintf(stderr, "error: the source is %lu bytes, scripts can't be longer than 4 GiB\n",
+            (unsigned long)src.length);
+    return false;
+}
+
+void reader_slide(struct reader* reader, const char* end) {
+    u32 start = reader->cursor;
+    u32 floor = start > READER_SLIDE_LINE_MAX ? start - READER_SLIDE_LINE_MAX : 0;
+    char* newline = reader->src.ptr;
+    usize length;
+
+    /* from the start of the line so columns stay right, unless it's an absurdly long one */
+    while (start > floor && reader->src.ptr[start - 1] != '\n') start -= 1;
+
+    while ((newline = memchr(newline, '\n', reader->src.ptr + start - newline)) != NULL) {
+        reader->line_base += 1;
+        newline += 1;
     }
+
+    reader->src.ptr += start;
+    reader->cursor -= start;
+
+    length = end - reader->src.ptr;
+    reader->src.length = length < READER_SRC_MAX ? length : READER_SRC_MAX;
+
+    line_index_destroy(&reader->lines);
+    reader->lines = line_index_create(reader->src);
+}
+
+/* 
+ * Reads one expression without recursing. Open lists live on an explicit
+ * stack of frames, and every element is appended through the frame's tail
+ * pointer, so reading is linear in the size of the input no matter how long
+ * or how deeply nested the lists are.
+ * */
+
+u32 read_expr(struct reader* reader) {
+    struct reader_frame inline_frames[READER_FRAMES_INLINE];
+    struct reader_frame* frames = inline_frames;
+    struct reader_frame* frame;
+    usize capacity = READER_FRAMES_INLINE;
+    usize depth = 0;
+    struct file_location loc;
+    u32 offset, ptr, cell;
+
+    /* the cursor would wrap around instead */
+    if (reader->src.length > READER_SRC_MAX) {
+        if (!reader->quiet) reader_check_length(reader->src);
+        reader->error_code = READER_ERROR_SOURCE_TOO_LONG;
+        return READER_ERROR;
+    }
+
+    for (;;) {
+        skip_trivia(reader);
+
+        /* we've reached the end of the string */
+        if (!bound(reader)) {
+            if (depth == 0) {
+                ptr = 0;
+                break;
+            }
+
+            /* 
+             * @TODO: Somehow figure out where the missing closing paren is
+             *        supossed to go.
+             * */
+            if (!reader->quiet) {
+                loc = reader_location(reader, reader->cursor);
+                fprintf(stderr, "(%u:%u): error: expected ')', found EOF instead\n",
+                        loc.line, loc.column);
+            }
+            reader->error_code = READER_ERROR_UNEXPECTED_EOF;
+            ptr = READER_ERROR;
+            break;
+        }
+
+        offset = reader->cursor;
+
+        if (char_at(reader) == '(') {
+            advance(reader);
+
+            if (depth == capacity) {
+                capacity *= 2;
+                if (frames == inline_frames) {
+                    frames = malloc(capacity * sizeof(*frames));
+                    assert(frames);
+                    memcpy(frames, inline_frames, sizeof(inline_frames));
+                } else {
+                    frames = realloc(frames, capacity * sizeof(*frames));
+                    assert(frames);
+                }
+            }
+
+            frames[depth++] = (struct reader_frame){0, 0, 0, offset};
+            continue;
+        }
+
+        if (char_at(reader) == ')' && depth > 0) {
+            advance(reader);
+            ptr = close_list(&frames[--depth]);
+        } else {
+            ptr = read_atom(reader);
+            if (ptr == READER_ERROR) break;
+
+            /* the offset of a string is where its bytes are */
+            if (!stringp(EXPR(ptr))) EXPR(ptr).offset = offset;
+        }
+
+        if (depth == 0) break;
+
+        frame = &frames[depth - 1];
+        cell = expr_new_cons(ptr, 0);
+
+        if (frame->tail != 0) EXPR(frame->tail).cdr = cell;
+        else frame->head = cell;
+
+        frame->tail = cell;
+        frame->length += 1;
+    }
+
+    if (frames != inline_frames) free(frames);
+
     return ptr;
 }
 
 u32 read_atom(struct reader* reader) {
+    struct file_location loc;
+
     if (is_digit(char_at(reader))) {
-        return read_integer(reader);
+        return read_number(reader);
     }
 
     if (is_symbol(char_at(reader))) {
         return read_symbol(reader);
     }
 
-    if (char_at(reader) == ')') {
-        fprintf(stderr, "(%d:%d) error: unexpected ')'\n", 
-                reader->current_location.line, reader->current_location.column);
-        reader->error_code = READER_ERROR_UNEXPECTED_CLOSING_PAREN;
+    if (char_at(reader) == '"') {
+        return read_string(reader);
     }
-    else {
-        fprintf(stderr, "(%d:%d) error: unknown character: '%c'\n",
-                reader->current_location.line, reader->current_location.column, char_at(reader));
-        reader->error_code = READER_ERROR_UNEXPECTED_CHARACTER;
+
+    if (char_at(reader) == ')') reader->error_code = READER_ERROR_UNEXPECTED_CLOSING_PAREN;
+    else reader->error_code = READER_ERROR_UNEXPECTED_CHARACTER;
+
+    if (!reader->quiet) {
+        loc = reader_location(reader, reader->cursor);
+
+        if (reader->error_code == READER_ERROR_UNEXPECTED_CLOSING_PAREN)
+            fprintf(stderr, "(%u:%u) error: unexpected ')'\n", loc.line, loc.column);
+        else
+            fprintf(stderr, "(%u:%u) error: unknown character: '%c'\n",
+                    loc.line, loc.column, char_at(reader));
     }
 
     advance(reader);
@@ -151,77 +264,111 @@ u32 read_atom(struct reader* reader) {
     return READER_ERROR;
 }
 
-u32 read_integer(struct reader* reader) {
-    char buf[32] = {0};
-    usize buf_ptr = 0;
-    i64 integer;
-
-    buf[buf_ptr++] = char_at(reader);
-    advance(reader);
+/* Longer floats than this are nothing but digits that don't change the double */
+#define READER_FLOAT_MAX 64
 
-    while (is_digit(char_at(reader)) && bound(reader)) {
-        buf[buf_ptr++] = char_at(reader);
-        advance(reader);
+/*
+ * Digits followed by a point or an exponent make a float, 1.5 or 2e10, any
+ * other digits an integer. Floats are parsed off a nul-terminated copy, the
+ * source isn't terminated.
+ * */
+u32 read_number(struct reader* reader) {
+    char buffer[READER_FLOAT_MAX];
+    usize digits, end, length;
+    u64 integer = 0;
+    char* parsed;
+    char next;
+    f64 real;
+
+    digits = scan_class_end(reader->src.ptr, reader->cursor, reader->src.length, SCAN_CLASS_DIGIT);
+
+    next = digits < reader->src.length ? reader->src.ptr[digits] : '\0';
+
+    if (next == '.' || next == 'e' || next == 'E') {
+        end = scan_class_end(reader->src.ptr, digits, reader->src.length, SCAN_CLASS_SYMBOL);
+        length = end - reader->cursor;
+
+        if (length < READER_FLOAT_MAX) {
+            memcpy(buffer, reader->src.ptr + reader->cursor, length);
+            buffer[length] = '\0';
+            real = strtod(buffer, &parsed);
+
+            /* 12.foo is left to be read as 12 and a symbol, like 12foo always was */
+            if (parsed == buffer + length) {
+                reader->cursor = end;
+                return expr_new_float(real);
+            }
+        }
     }
 
-    integer = atoll(buf);
+    /* wraps around on overflow instead of reading past a fixed size buffer */
+    for (; reader->cursor < digits; ++reader->cursor) {
+        integer = integer * 10 + (u64)(char_at(reader) - '0');
+    }
 
-    return expr_new_integer(integer);
+    return expr_new_integer((i64)integer);
 }
 
 u32 read_symbol(struct reader* reader) {
-    char symbol_buffer[256] = {0};
-    u8 length = 0;
+    u32 start = reader->cursor;
+    u32 length;
     char* symbol;
 
-    while (is_symbol(char_at(reader)) && bound(reader)) {
-        symbol_buffer[length] = char_at(reader);
-        advance(reader);
-        length += 1;
-    }
+    reader->cursor = scan_class_end(reader->src.ptr, reader->cursor, reader->src.length, SCAN_CLASS_SYMBOL);
 
-    symbol = arena_alloc(&expr_arena, length);
-    memcpy(symbol, symbol_buffer, length);
+    length = reader->cursor - start;
+    symbol = reader->src.ptr + start;
+
+    if (!reader->borrow_symbols) {
+        symbol = arena_alloc(&expr_arena, length);
+        memcpy(symbol, reader->src.ptr + start, length);
+    }
 
     return expr_new_symbol(symbol, length);
 }
 
-/* 
- * @TODO: See if there is a better way to calculate the length of a list without
- *  having to traverse the list multiple times.
+/*
+ * Strings without escapes are borrowed from the source like symbols are, the
+ * rest get decoded into the expr arena. \n and \t are the only escapes that
+ * turn into something else, a backslash before any other byte is dropped.
  * */
-u32 read_cons(struct reader* reader) {
-    u32 car;
-    u32 cons;
-
-    skip_space(reader);
-
-    if (char_at(reader) == ')') {
-        advance(reader);
-        return 0;
-    }
-
-    /* 
-     * @TODO: Somehow figure out where the missing closing paren is supossed to
-     *       go.
-     * */
-    if (!bound(reader)) {
-        fprintf(stderr, "(%d:%d): error: expected ')', found EOF instead\n",
-                reader->current_location.line,
-                reader->current_location.column);
+u32 read_string(struct reader* reader) {
+    u32 start = reader->cursor + 1;
+    u32 close = scan_string_end(reader->src.ptr, reader->cursor, reader->src.length);
+    struct file_location loc;
+    char* text;
+    u32 length, i;
+
+    if (close == reader->src.length) {
+        if (!reader->quiet) {
+            loc = reader_location(reader, reader->cursor);
+            fprintf(stderr, "(%u:%u): error: expected '\"', found EOF instead\n",
+                    loc.line, loc.column);
+        }
         reader->error_code = READER_ERROR_UNEXPECTED_EOF;
+        reader->cursor = close;
         return READER_ERROR;
     }
 
-    car = read_expr(reader);
+    reader->cursor = close + 1;
+    text = reader->src.ptr + start;
 
-    if (car == READER_ERROR) return car;
-
-    cons = expr_new_cons(car, read_cons(reader));
-
-    if (reader->error_code != 0) return READER_ERROR;
+    if (reader->borrow_symbols && !memchr(text, '\\', close - start)) {
+        return expr_box(expr_create_string_borrowed(text, close - start));
+    }
 
-    EXPR(cons).length = expr_cons_length(EXPR(cons));
+    text = arena_alloc(&expr_arena, close - start);
+
+    for (i = start, length = 0; i < close; ++i) {
+        if (reader->src.ptr[i] == '\\') {
+            i += 1;
+            if (reader->src.ptr[i] == 'n') text[length++] = '\n';
+            else if (reader->src.ptr[i] == 't') text[length++] = '\t';
+            else text[length++] = reader->src.ptr[i];
+        } else {
+            text[length++] = reader->src.ptr[i];
+        }
+    }
 
-    return cons;
+    return expr_box(expr_create_string_borrowed(text, length));
 }
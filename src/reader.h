@@ -2,28 +2,58 @@
 #define __READER_H
 
 #include "common.h"
+#include "source.h"
 
 #define READER_ERROR UINT32_MAX
 
+/* Offsets into the source are u32 to fit in an expr, longer sources are read through reader_slide or refused */
+#define READER_SRC_MAX ((usize)UINT32_MAX)
+
 enum reader_error_code {
     READER_ERROR_UNEXPECTED_CLOSING_PAREN = 1,
     READER_ERROR_UNEXPECTED_CHARACTER,
     READER_ERROR_UNEXPECTED_EOF,
+    READER_ERROR_SOURCE_TOO_LONG,
 };
 
 struct reader {
     struct slice(char) src;
-    struct file_location current_location;
     u32 cursor;
     u32 error_code;
+    bool borrow_symbols;
+    bool quiet; /* don't print errors, only record them in error_code */
+    struct line_index lines; /* resolves offsets in src for error messages */
+    u32 line_base;           /* lines before src, once reader_slide has moved it */
 };
 
 struct reader reader_create(struct slice(char) src);
 
+/*
+ * A borrowing reader points symbols and strings without escapes straight into
+ * src instead of copying them into the expr arena, so src must outlive every
+ * expr read from it.
+ * */
+struct reader reader_create_borrowed(struct slice(char) src);
+
+void reader_destroy(struct reader* reader);
+
+/* Whether src is short enough to read, printing an error if it isn't */
+bool reader_check_length(struct slice(char) src);
+
+/*
+ * Moves src up to the start of the line the cursor is on, and out to end or
+ * as far as READER_SRC_MAX allows, so text past 4 GiB can be read a window at
+ * a time. Exprs already read keep the offsets of the old window.
+ * */
+void reader_slide(struct reader* reader, const char* end);
+
+/* The line and column of an offset into the reader's source */
+struct file_location reader_location(struct reader* reader, u32 offset);
+
 u32 read_expr(struct reader* reader);
 u32 read_atom(struct reader* reader);
-u32 read_integer(struct reader* reader);
+u32 read_number(struct reader* reader);
 u32 read_symbol(struct reader* reader);
-u32 read_cons(struct reader* reader);
+u32 read_string(struct reader* reader);
 
 #endif  /* __READER_H */
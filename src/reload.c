@@ -0,0 +1,263 @@
+#include <stdio.h>
+
+#include "reload.h"
+#include "compiler.h"
+#include "reader.h"
+#include "scan.h"
+#include "vm.h"
+
+DYNARRAY_IMPL_S(reload_form);
+DYNARRAY_IMPL_S(source);
+DYNARRAY_IMPL_S(reload_file);
+
+/* How big the form table of a file starts out */
+#define RELOAD_SLOTS_MIN 64
+
+static usize skip_trivia(struct slice(char) src, usize cursor) {
+    for (;;) {
+        cursor = scan_skip_space(src.ptr, cursor, src.length);
+
+        if (cursor + 1 >= src.length || src.ptr[cursor] != ';' || src.ptr[cursor + 1] != ';')
+            return cursor;
+
+        cursor = scan_find_newline(src.ptr, cursor, src.length);
+    }
+}
+
+/*
+ * Finds where the top-level form at cursor ends without reading it. Anything
+ * malformed gets cut somewhere and left for the reader to complain about if
+ * the form turns out to need compiling.
+ * */
+static usize form_end(struct slice(char) src, usize cursor) {
+    usize depth = 0;
+    usize end;
+
+    if (src.ptr[cursor] == '"') {
+        end = scan_string_end(src.ptr, cursor, src.length);
+        return end < src.length ? end + 1 : end;
+    }
+
+    if (src.ptr[cursor] != '(') {
+        end = scan_class_end(src.ptr, cursor, src.length, SCAN_CLASS_SYMBOL);
+        return end > cursor ? end : cursor + 1;
+    }
+
+    while (cursor < src.length) {
+        switch (src.ptr[cursor]) {
+            case '(':
+                depth += 1;
+                break;
+            case ')':
+                depth -= 1;
+                if (depth == 0) return cursor + 1;
+                break;
+            case '"':
+                /* parens in a string don't count */
+                cursor = scan_string_end(src.ptr, cursor, src.length);
+                break;
+            case ';':
+                if (cursor + 1 < src.length && src.ptr[cursor + 1] == ';') {
+                    cursor = scan_find_newline(src.ptr, cursor, src.length);
+                    continue;
+                }
+                break;
+        }
+
+        cursor += 1;
+    }
+
+    return src.length;
+}
+
+/* Returns the index of the file, since running forms can move the array around */
+static usize find_file(struct reload_registry* registry, struct slice(char) path) {
+    struct reload_file file = {0};
+    usize i;
+
+    for (i = 0; i < registry->files.length; ++i) {
+        file = registry->files.at[i];
+        if (strlen(file.path) == path.length && memcmp(file.path, path.ptr, path.length) == 0)
+            return i;
+    }
+
+    file = (struct reload_file){0};
+    file.path = malloc(path.length + 1);
+    assert(file.path);
+    memcpy(file.path, path.ptr, path.length);
+    file.path[path.length] = '\0';
+
+    dynarray__reload_file_push(&registry->files, file);
+
+    return registry->files.length - 1;
+}
+
+static void grow_slots(struct reload_file* file) {
+    u32 capacity = file->slots_capacity ? file->slots_capacity * 2 : RELOAD_SLOTS_MIN;
+    u32 mask = capacity - 1;
+    u32 slot;
+    u32 i;
+
+    free(file->slots);
+    file->slots = calloc(capacity, sizeof(u32));
+    assert(file->slots);
+    file->slots_capacity = capacity;
+
+    for (i = 0; i < file->forms.length; ++i) {
+        slot = file->forms.at[i].hash & mask;
+        while (file->slots[slot] != 0) slot = (slot + 1) & mask;
+        file->slots[slot] = i + 1;
+    }
+}
+
+/* Finds the form with exactly this text, adding it if there is none */
+static struct reload_form* find_form(struct reload_file* file, struct slice(char) text, bool* added) {
+    struct reload_form* form;
+    u64 hash = string_hash(text);
+    u32 mask, slot;
+
+    if ((file->forms.length + 1) * 2 > file->slots_capacity) grow_slots(file);
+
+    mask = file->slots_capacity - 1;
+
+    for (slot = hash & mask; file->slots[slot] != 0; slot = (slot + 1) & mask) {
+        form = &file->forms.at[file->slots[slot] - 1];
+
+        if (form->hash == hash && string_equal(form->text, text)) {
+            *added = false;
+            return form;
+        }
+    }
+
+    dynarray__reload_form_push(&file->forms, (struct reload_form){ .hash = hash, .text = text });
+    file->slots[slot] = file->forms.length;
+
+    *added = true;
+    return &file->forms.at[file->forms.length - 1];
+}
+
+/* Reads and compiles one form into its module without keeping the syntax tree */
+static u8 compile_reload_form(struct vm* vm, struct reload_form* form, struct slice(char) src, usize offset) {
+    struct dynarray(expr) heap = exprs;
+    struct compiler compiler = {0};
+    u8 ret;
+    u32 ptr;
+
+    exprs = (struct dynarray(expr)){0};
+    expr_new_nil();
+
+    compiler_init(&compiler, reader_create_borrowed(src), &form->module);
+    compiler.reader.cursor = offset;
+    if (!vm->shared) compiler.constants = &vm->constants;
+
+    ptr = read_expr(&compiler.reader);
+    ret = ptr == READER_ERROR ? COMPILE_READER_ERROR : compile_form(&compiler, EXPR(ptr));
+
+    compiler_destroy(&compiler);
+    DYNARRAY_FREE(&exprs);
+    exprs = heap;
+
+    return ret;
+}
+
+struct expr reload_file(struct vm* vm, struct slice(char) path) {
+    struct reload_file* file;
+    struct reload_form* form;
+    struct source source;
+    struct module* module;
+    u8* ip;
+    usize index, cursor, end;
+    i64 ran = 0;
+    bool added, used = false, failed = false;
+
+    index = find_file(&vm->reloads, path);
+    file = &vm->reloads.files.at[index];
+
+    if (!source_open(&source, file->path)) return expr_create_nil();
+
+    file->generation += 1;
+
+    /* we're in the middle of running the #reload itself */
+    module = vm->module;
+    ip = vm->ip;
+
+    cursor = skip_trivia(source.text, 0);
+    while (cursor < source.text.length && vm->running) {
+        end = form_end(source.text, cursor);
+        form = find_form(file, (struct slice(char)){source.text.ptr + cursor, end - cursor}, &added);
+        used |= added;
+
+        if (form->generation != file->generation) {
+            form->last_seen = form->generation + 1 == file->generation ? form->seen : 0;
+            form->seen = 0;
+            form->generation = file->generation;
+        }
+
+        form->seen += 1;
+
+        /* a copy of this form was there last time, leave what it did alone */
+        if (form->seen <= form->last_seen) {
+            cursor = skip_trivia(source.text, end);
+            continue;
+        }
+
+        /* the bytecode inlined a global that has been assigned since */
+        if (!constant_deps_valid(&vm->constants, &form->module)) {
+            module_clear(&form->module);
+        }
+
+        if (form->module.code.length == 0) {
+            /* the symbols it gets compiled with are borrowed from the new mapping */
+            used = true;
+
+            if (compile_reload_form(vm, form, source.text, cursor) != COMPILE_OK) {
+                /* make sure it gets another go next time */
+                form->seen -= 1;
+                module_clear(&form->module);
+                failed = true;
+                break;
+            }
+        }
+
+        vm_run(vm, &form->module);
+        ran += 1;
+
+        /* the form might have reloaded something itself */
+        file = &vm->reloads.files.at[index];
+
+        cursor = skip_trivia(source.text, end);
+    }
+
+    vm->module = module;
+    vm->ip = ip;
+
+    /* nothing points into the new mapping unless a form was added or compiled from it */
+    if (used) dynarray__source_push(&file->sources, source);
+    else source_close(&source);
+
+    return failed ? expr_create_nil() : expr_create_integer(ran);
+}
+
+void reload_registry_destroy(struct reload_registry* registry) {
+    struct reload_file* file;
+    usize i, j;
+
+    for (i = 0; i < registry->files.length; ++i) {
+        file = &registry->files.at[i];
+
+        for (j = 0; j < file->forms.length; ++j) {
+            module_destroy(&file->forms.at[j].module);
+        }
+
+        for (j = 0; j < file->sources.length; ++j) {
+            source_close(&file->sources.at[j]);
+        }
+
+        DYNARRAY_FREE(&file->forms);
+        DYNARRAY_FREE(&file->sources);
+        free(file->slots);
+        free(file->path);
+    }
+
+    DYNARRAY_FREE(&registry->files);
+}
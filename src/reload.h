@@ -0,0 +1,64 @@
+#ifndef __RELOAD_H
+#define __RELOAD_H
+
+#include "common.h"
+#include "expr.h"
+#include "module.h"
+#include "source.h"
+
+struct vm;
+
+/* 
+ * A top-level form as it was last seen in a file, along with its bytecode.
+ * Forms are identified by their exact text, the hash is only there to find
+ * them. seen counts the copies of the form in the current generation of the
+ * file and last_seen the copies in the one before it.
+ * */
+struct reload_form {
+    u64 hash;
+    struct slice(char) text;
+    struct module module;
+    u32 generation;
+    u32 seen;
+    u32 last_seen;
+};
+
+DYNARRAY_DECL_S(reload_form);
+DYNARRAY_DECL_S(source);
+
+struct reload_file {
+    char* path;
+    struct dynarray(reload_form) forms;
+    u32* slots;         /* open addressing over forms, holding index + 1 */
+    u32 slots_capacity; /* a power of two, kept at least twice the form count */
+    u32 generation;     /* bumped on every reload */
+
+    /* 
+     * Every mapping a form's text or constants came from. Old ones stay open
+     * since the globals and the cached bytecode still point into them.
+     * */
+    struct dynarray(source) sources;
+};
+
+DYNARRAY_DECL_S(reload_file);
+
+struct reload_registry {
+    struct dynarray(reload_file) files;
+};
+
+/*
+ * Reloads a source file into the vm. Each top-level form's text is hashed and
+ * looked up among the forms the file had the last time it was reloaded. Forms
+ * that were there are skipped, so the globals they defined keep their current
+ * values. New or changed forms are compiled, or reuse bytecode cached from an
+ * older generation of the file, and run in file order.
+ *
+ * The first reload of a file runs every form in it. Returns the number of
+ * forms that were run, or nil if the file could not be loaded or a form failed
+ * to compile.
+ * */
+struct expr reload_file(struct vm* vm, struct slice(char) path);
+
+void reload_registry_destroy(struct reload_registry* registry);
+
+#endif  /*__RELOAD_H*/
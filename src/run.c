@@ -0,0 +1,46 @@
+#include "run.h"
+#include "compiler.h"
+#include "parallel.h"
+#include "pipeline.h"
+#include "reader.h"
+#include "stream.h"
+
+u8 run_source(struct vm* vm, struct slice(char) text, usize threads, enum run_mode mode) {
+    struct dynarray(u32) forms = {0};
+    struct module module = {0};
+    struct compiler compiler = {0};
+    u8 ret;
+
+    /* streaming reads through a window, the rest split the source at u32 offsets */
+    if (mode == RUN_STREAMING) return stream_run(vm, text);
+    if (!reader_check_length(text)) return COMPILE_READER_ERROR;
+
+    if (mode == RUN_PIPELINED) return pipeline_run(vm, text);
+
+    if (threads == 0) threads = parallel_default_threads(text.length);
+
+    compiler_init(&compiler, reader_create_borrowed(text), &module);
+
+    /* globals shared with other vms can be assigned by them at any time */
+    if (!vm->shared) compiler.constants = &vm->constants;
+
+    if (threads > 1) {
+        ret = parallel_read_forms(text, threads, &forms) == 0
+            ? compile_forms(&compiler, &forms)
+            : COMPILE_READER_ERROR;
+    } else {
+        ret = compile(&compiler);
+    }
+
+    if (vm->stats) module_fprint_stats(stderr, &module);
+
+    if (ret == COMPILE_OK) {
+        vm_run(vm, &module);
+    }
+
+    module_destroy(&module);
+    DYNARRAY_FREE(&forms);
+    compiler_destroy(&compiler);
+
+    return ret;
+}
@@ -0,0 +1,24 @@
+#ifndef __RUN_H
+#define __RUN_H
+
+#include "common.h"
+#include "vm.h"
+
+enum run_mode {
+    RUN_WHOLE,     /* read and compile the whole file, then run it */
+    RUN_PIPELINED, /* run forms on this thread while another one reads them */
+    RUN_STREAMING, /* read, compile, and run one form at a time */
+};
+
+/*
+ * Compiles and runs the text of a source file in a vm whose isolate the thread
+ * is in. threads is how many threads read the text in RUN_WHOLE mode, 0 lets
+ * the size of it decide.
+ *
+ * Symbols are sliced straight out of text, so it has to stay alive until the
+ * vm and the globals keyed by those symbols are gone. Returns COMPILE_OK or
+ * the error that stopped it.
+ * */
+u8 run_source(struct vm* vm, struct slice(char) text, usize threads, enum run_mode mode);
+
+#endif  /*__RUN_H*/
@@ -0,0 +1,247 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+
+#include "scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_X86
+#endif
+
+#define S  SCAN_CLASS_SPACE
+#define D  (SCAN_CLASS_DIGIT | SCAN_CLASS_SYMBOL)
+#define Y  SCAN_CLASS_SYMBOL
+
+const u8 scan_classes[256] = {
+    [' '] = S, ['\t'] = S, ['\r'] = S, ['\n'] = S,
+
+    ['0'] = D, ['1'] = D, ['2'] = D, ['3'] = D, ['4'] = D,
+    ['5'] = D, ['6'] = D, ['7'] = D, ['8'] = D, ['9'] = D,
+
+    ['A'] = Y, ['B'] = Y, ['C'] = Y, ['D'] = Y, ['E'] = Y, ['F'] = Y, ['G'] = Y,
+    ['H'] = Y, ['I'] = Y, ['J'] = Y, ['K'] = Y, ['L'] = Y, ['M'] = Y, ['N'] = Y,
+    ['O'] = Y, ['P'] = Y, ['Q'] = Y, ['R'] = Y, ['S'] = Y, ['T'] = Y, ['U'] = Y,
+    ['V'] = Y, ['W'] = Y, ['X'] = Y, ['Y'] = Y, ['Z'] = Y,
+
+    ['a'] = Y, ['b'] = Y, ['c'] = Y, ['d'] = Y, ['e'] = Y, ['f'] = Y, ['g'] = Y,
+    ['h'] = Y, ['i'] = Y, ['j'] = Y, ['k'] = Y, ['l'] = Y, ['m'] = Y, ['n'] = Y,
+    ['o'] = Y, ['p'] = Y, ['q'] = Y, ['r'] = Y, ['s'] = Y, ['t'] = Y, ['u'] = Y,
+    ['v'] = Y, ['w'] = Y, ['x'] = Y, ['y'] = Y, ['z'] = Y,
+
+    ['?'] = Y, ['!'] = Y, ['.'] = Y, ['+'] = Y, ['-'] = Y, ['*'] = Y,
+    ['/'] = Y, ['<'] = Y, ['='] = Y, ['>'] = Y, [':'] = Y, ['$'] = Y,
+    ['%'] = Y, ['^'] = Y, ['&'] = Y, ['_'] = Y, ['~'] = Y, ['#'] = Y,
+};
+
+#undef S
+#undef D
+#undef Y
+
+/* How far the scalar prologue of scan_skip_space goes before vectorizing */
+#define SCAN_SHORT_RUN 8
+
+struct scan_impl {
+    usize (*skip_space)(const char*, usize, usize);
+    usize (*find_newline)(const char*, usize, usize);
+};
+
+static enum scan_level scan_level;
+static struct scan_impl scan_impl;
+static pthread_once_t level_once = PTHREAD_ONCE_INIT;
+
+/* Scalar */
+
+static usize skip_space_scalar(const char* src, usize cursor, usize end) {
+    while (cursor < end && SCAN_IS(src[cursor], SCAN_CLASS_SPACE)) cursor += 1;
+    return cursor;
+}
+
+static usize find_newline_scalar(const char* src, usize cursor, usize end) {
+    while (cursor < end && src[cursor] != '\n') cursor += 1;
+    return cursor;
+}
+
+/* Vectorized */
+
+#ifdef SCAN_X86
+
+#ifdef __SSE2__
+
+static usize skip_space_sse2(const char* src, usize cursor, usize end) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i nl = _mm_set1_epi8('\n');
+    __m128i block, is_space;
+    u32 stop;
+
+    while (cursor + 16 <= end) {
+        block = _mm_loadu_si128((const __m128i*)(src + cursor));
+
+        is_space = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab)),
+                                _mm_or_si128(_mm_cmpeq_epi8(block, cr), _mm_cmpeq_epi8(block, nl)));
+
+        stop = ~(u32)_mm_movemask_epi8(is_space) & 0xFFFF;
+        if (stop) return cursor + __builtin_ctz(stop);
+
+        cursor += 16;
+    }
+
+    return skip_space_scalar(src, cursor, end);
+}
+
+static usize find_newline_sse2(const char* src, usize cursor, usize end) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    u32 newlines;
+
+    while (cursor + 16 <= end) {
+        newlines = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(src + cursor)), nl));
+        if (newlines) return cursor + __builtin_ctz(newlines);
+        cursor += 16;
+    }
+
+    return find_newline_scalar(src, cursor, end);
+}
+
+#endif  /* __SSE2__ */
+
+__attribute__((target("avx2")))
+static usize skip_space_avx2(const char* src, usize cursor, usize end) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i nl = _mm256_set1_epi8('\n');
+    __m256i block, is_space;
+    u32 stop;
+
+    while (cursor + 32 <= end) {
+        block = _mm256_loadu_si256((const __m256i*)(src + cursor));
+
+        is_space = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(block, tab)),
+                                   _mm256_or_si256(_mm256_cmpeq_epi8(block, cr), _mm256_cmpeq_epi8(block, nl)));
+
+        stop = ~(u32)_mm256_movemask_epi8(is_space);
+        if (stop) return cursor + __builtin_ctz(stop);
+
+        cursor += 32;
+    }
+
+    return skip_space_scalar(src, cursor, end);
+}
+
+__attribute__((target("avx2")))
+static usize find_newline_avx2(const char* src, usize cursor, usize end) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    u32 newlines;
+
+    while (cursor + 32 <= end) {
+        newlines = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(src + cursor)), nl));
+        if (newlines) return cursor + __builtin_ctz(newlines);
+        cursor += 32;
+    }
+
+    return find_newline_scalar(src, cursor, end);
+}
+
+#endif  /* SCAN_X86 */
+
+enum scan_level scan_best_level(void) {
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SCAN_LEVEL_AVX2;
+#ifdef __SSE2__
+    return SCAN_LEVEL_SSE2;
+#endif
+#endif
+    return SCAN_LEVEL_SCALAR;
+}
+
+/* Fills in the implementation of a level, only ever called once the level is settled */
+static void use_level(enum scan_level level) {
+    scan_level = SCAN_LEVEL_SCALAR;
+    scan_impl = (struct scan_impl){skip_space_scalar, find_newline_scalar};
+
+#ifdef SCAN_X86
+    if (level == SCAN_LEVEL_AVX2 && __builtin_cpu_supports("avx2")) {
+        scan_level = SCAN_LEVEL_AVX2;
+        scan_impl = (struct scan_impl){skip_space_avx2, find_newline_avx2};
+        return;
+    }
+#ifdef __SSE2__
+    if (level >= SCAN_LEVEL_SSE2) {
+        scan_level = SCAN_LEVEL_SSE2;
+        scan_impl = (struct scan_impl){skip_space_sse2, find_newline_sse2};
+    }
+#endif
+#endif
+}
+
+/* The parallel reader scans from several threads at once, so whoever's first picks for everyone */
+static void use_best_level(void) {
+    use_level(scan_best_level());
+}
+
+void scan_set_level(enum scan_level level) {
+    pthread_once(&level_once, use_best_level);
+    use_level(level);
+}
+
+enum scan_level scan_get_level(void) {
+    pthread_once(&level_once, use_best_level);
+    return scan_level;
+}
+
+usize scan_skip_space(const char* src, usize cursor, usize end) {
+    usize short_end = cursor + SCAN_SHORT_RUN < end ? cursor + SCAN_SHORT_RUN : end;
+
+    /* 
+     * Most runs of whitespace are a single space or a newline and some
+     * indentation, so only hand off to the vectorized loop once the run has
+     * proven itself to be long.
+     * */
+    while (cursor < short_end) {
+        if (!SCAN_IS(src[cursor], SCAN_CLASS_SPACE)) return cursor;
+        cursor += 1;
+    }
+
+    pthread_once(&level_once, use_best_level);
+    return scan_impl.skip_space(src, cursor, end);
+}
+
+usize scan_find_newline(const char* src, usize cursor, usize end) {
+    pthread_once(&level_once, use_best_level);
+    return scan_impl.find_newline(src, cursor, end);
+}
+
+usize scan_class_end(const char* src, usize cursor, usize end, u8 class) {
+    /* tokens are short, so unrolling beats setting up vectors for them */
+    while (cursor + 4 <= end) {
+        if (!SCAN_IS(src[cursor],     class)) return cursor;
+        if (!SCAN_IS(src[cursor + 1], class)) return cursor + 1;
+        if (!SCAN_IS(src[cursor + 2], class)) return cursor + 2;
+        if (!SCAN_IS(src[cursor + 3], class)) return cursor + 3;
+        cursor += 4;
+    }
+
+    while (cursor < end && SCAN_IS(src[cursor], class)) cursor += 1;
+
+    return cursor;
+}
+
+usize scan_string_end(const char* src, usize cursor, usize end) {
+    const char* quote;
+    const char* run;
+
+    for (cursor += 1; cursor < end; cursor = quote - src + 1) {
+        quote = memchr(src + cursor, '"', end - cursor);
+        if (!quote) break;
+
+        /* a quote is escaped by an odd run of backslashes right before it */
+        for (run = quote; run > src + cursor && run[-1] == '\\'; --run);
+
+        if ((quote - run) % 2 == 0) return quote - src;
+    }
+
+    return end;
+}
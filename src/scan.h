@@ -0,0 +1,58 @@
+#ifndef __SCAN_H
+#define __SCAN_H
+
+#include "common.h"
+
+/*
+ * The scanning layer underneath the reader. These functions find the end of
+ * runs of bytes (whitespace, comment bodies, tokens) many bytes at a time
+ * instead of the reader stepping over them one by one.
+ *
+ * Whitespace and newline searches are vectorized with SSE2 or AVX2 depending
+ * on what the CPU supports, with a scalar fallback everywhere else. Tokens are
+ * matched against a 256 entry class table.
+ * */
+
+enum scan_class {
+    SCAN_CLASS_SPACE   = 1 << 0,
+    SCAN_CLASS_DIGIT   = 1 << 1,
+    SCAN_CLASS_SYMBOL  = 1 << 2, /* every character allowed in a symbol, digits included */
+};
+
+enum scan_level {
+    SCAN_LEVEL_SCALAR,
+    SCAN_LEVEL_SSE2,
+    SCAN_LEVEL_AVX2,
+};
+
+extern const u8 scan_classes[256];
+
+#define SCAN_IS(c, class) ((scan_classes[(u8)(c)] & (class)) != 0)
+
+/* Picks the widest level the CPU supports, used unless scan_set_level is called */
+enum scan_level scan_best_level(void);
+
+/*
+ * Forces a level, mostly so benchmarks can compare the implementations. Only
+ * call it while nothing else is scanning, the level is picked once otherwise.
+ * */
+void scan_set_level(enum scan_level level);
+enum scan_level scan_get_level(void);
+
+/* Returns the offset of the first non-whitespace byte at or after cursor, or end */
+usize scan_skip_space(const char* src, usize cursor, usize end);
+
+/* Returns the offset of the first '\n' at or after cursor, or end */
+usize scan_find_newline(const char* src, usize cursor, usize end);
+
+/* Returns the offset of the first byte at or after cursor not in class */
+usize scan_class_end(const char* src, usize cursor, usize end, u8 class);
+
+/*
+ * Takes the offset of the '"' opening a string literal and returns the offset
+ * of the '"' closing it, or end if it never gets closed. Backslashes escape
+ * the byte after them.
+ * */
+usize scan_string_end(const char* src, usize cursor, usize end);
+
+#endif  /*__SCAN_H*/
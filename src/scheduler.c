@@ -0,0 +1,164 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "scheduler.h"
+#include "compiler.h"
+#include "reader.h"
+#include "scan.h"
+
+void scheduler_task_init(struct scheduler_task* task, struct slice(char) text) {
+    *task = (struct scheduler_task){0};
+    task->text = text;
+
+    vm_init(&task->vm);
+}
+
+void scheduler_task_destroy(struct scheduler_task* task) {
+    module_destroy(&task->module);
+    vm_destroy(&task->vm);
+}
+
+static void compile_task(struct scheduler_task* task) {
+    struct compiler compiler = {0};
+
+    compiler_init(&compiler, reader_create_borrowed(task->text), &task->module);
+    task->compile_status = compile(&compiler);
+    compiler_destroy(&compiler);
+
+    task->compiled = true;
+}
+
+/* Runs one quantum of the task, returns true if it's done */
+static bool run_task(struct scheduler* scheduler, struct scheduler_task* task) {
+    isolate_enter(&task->vm.isolate);
+
+    if (!task->compiled) compile_task(task);
+
+    if (task->compile_status != COMPILE_OK) {
+        task->status = VM_HALTED;
+        isolate_leave(&task->vm.isolate);
+        return true;
+    }
+
+    if (!task->loaded) {
+        vm_load(&task->vm, &task->module);
+        task->loaded = true;
+    }
+
+    task->status = vm_run_for(&task->vm, scheduler->quantum);
+    task->slices += 1;
+
+    isolate_leave(&task->vm.isolate);
+
+    return task->status != VM_YIELDED;
+}
+
+static void enqueue(struct scheduler* scheduler, struct scheduler_task* task) {
+    task->next = NULL;
+
+    if (scheduler->tail) scheduler->tail->next = task;
+    else scheduler->head = task;
+
+    scheduler->tail = task;
+}
+
+static void* scheduler_worker(void* arg) {
+    struct scheduler* scheduler = arg;
+    struct scheduler_task* task;
+
+    for (;;) {
+        pthread_mutex_lock(&scheduler->lock);
+
+        while (!scheduler->head && !scheduler->stopping) {
+            pthread_cond_wait(&scheduler->ready, &scheduler->lock);
+        }
+
+        task = scheduler->head;
+        if (!task) {
+            pthread_mutex_unlock(&scheduler->lock);
+            return NULL;
+        }
+
+        scheduler->head = task->next;
+        if (!scheduler->head) scheduler->tail = NULL;
+
+        pthread_mutex_unlock(&scheduler->lock);
+
+        if (!run_task(scheduler, task)) {
+            pthread_mutex_lock(&scheduler->lock);
+            enqueue(scheduler, task);
+            pthread_mutex_unlock(&scheduler->lock);
+            continue;
+        }
+
+        if (scheduler->done) scheduler->done(task, scheduler->data);
+
+        pthread_mutex_lock(&scheduler->lock);
+        scheduler->unfinished -= 1;
+        if (scheduler->unfinished == 0) pthread_cond_broadcast(&scheduler->drained);
+        pthread_mutex_unlock(&scheduler->lock);
+    }
+}
+
+void scheduler_init(struct scheduler* scheduler, usize threads, u64 quantum) {
+    usize i;
+
+    *scheduler = (struct scheduler){0};
+    scheduler->quantum = quantum ? quantum : SCHEDULER_QUANTUM;
+
+    pthread_mutex_init(&scheduler->lock, NULL);
+    pthread_cond_init(&scheduler->ready, NULL);
+    pthread_cond_init(&scheduler->drained, NULL);
+
+    /* pick the scanning level up front instead of racing to it in the workers */
+    scan_get_level();
+
+    if (threads == 0) threads = 1;
+
+    scheduler->threads = malloc(sizeof(pthread_t) * threads);
+    assert(scheduler->threads);
+
+    for (i = 0; i < threads; ++i) {
+        if (pthread_create(&scheduler->threads[scheduler->thread_count], NULL, scheduler_worker, scheduler) != 0) break;
+        scheduler->thread_count += 1;
+    }
+
+    assert(scheduler->thread_count > 0);
+}
+
+void scheduler_destroy(struct scheduler* scheduler) {
+    usize i;
+
+    pthread_mutex_lock(&scheduler->lock);
+    scheduler->stopping = true;
+    pthread_cond_broadcast(&scheduler->ready);
+    pthread_mutex_unlock(&scheduler->lock);
+
+    for (i = 0; i < scheduler->thread_count; ++i) {
+        pthread_join(scheduler->threads[i], NULL);
+    }
+
+    free(scheduler->threads);
+    pthread_cond_destroy(&scheduler->drained);
+    pthread_cond_destroy(&scheduler->ready);
+    pthread_mutex_destroy(&scheduler->lock);
+}
+
+void scheduler_submit(struct scheduler* scheduler, struct scheduler_task* task) {
+    pthread_mutex_lock(&scheduler->lock);
+
+    enqueue(scheduler, task);
+    scheduler->unfinished += 1;
+    pthread_cond_signal(&scheduler->ready);
+
+    pthread_mutex_unlock(&scheduler->lock);
+}
+
+void scheduler_wait(struct scheduler* scheduler) {
+    pthread_mutex_lock(&scheduler->lock);
+
+    while (scheduler->unfinished > 0) {
+        pthread_cond_wait(&scheduler->drained, &scheduler->lock);
+    }
+
+    pthread_mutex_unlock(&scheduler->lock);
+}
@@ -0,0 +1,76 @@
+#ifndef __SCHEDULER_H
+#define __SCHEDULER_H
+
+#include <pthread.h>
+
+#include "common.h"
+#include "module.h"
+#include "vm.h"
+
+/* How many instructions a task gets to run before it goes to the back of the line */
+#define SCHEDULER_QUANTUM 4096
+
+struct scheduler_task;
+
+typedef void (*scheduler_done_fn)(struct scheduler_task* task, void* data);
+
+/* One script with a vm and heap of its own */
+struct scheduler_task {
+    struct vm vm;
+    struct module module;
+    struct slice(char) text; /* borrowed until the task is done */
+    bool compiled;           /* set it after filling in module by hand to skip compiling text */
+    bool loaded;
+
+    /* filled in as the task runs */
+    u8 compile_status;
+    enum vm_status status;
+    u64 slices; /* how many quanta it took */
+
+    struct scheduler_task* next;
+};
+
+/*
+ * Round-robins tasks over a fixed pool of threads. A thread takes the task at
+ * the front of the run queue, enters its isolate, runs it for one quantum, and
+ * puts it at the back if it isn't done yet. Tasks are compiled on their first
+ * turn, so submitting is cheap.
+ *
+ * No task holds a thread for longer than a quantum, so a short script submitted
+ * behind heavy ones only waits for one quantum of each task ahead of it instead
+ * of for all of them to finish.
+ * */
+struct scheduler {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;   /* a task was queued, or we're shutting down */
+    pthread_cond_t drained; /* the last unfinished task finished */
+
+    struct scheduler_task* head;
+    struct scheduler_task* tail;
+    usize unfinished;
+    bool stopping;
+
+    pthread_t* threads;
+    usize thread_count;
+    u64 quantum;
+
+    /* called on the thread that finished a task, outside of any isolate */
+    scheduler_done_fn done;
+    void* data;
+};
+
+void scheduler_task_init(struct scheduler_task* task, struct slice(char) text);
+void scheduler_task_destroy(struct scheduler_task* task);
+
+/* A quantum of VM_BUDGET_UNLIMITED runs every task to the end in one go */
+void scheduler_init(struct scheduler* scheduler, usize threads, u64 quantum);
+
+/* Stops the threads once the queue is empty and frees them */
+void scheduler_destroy(struct scheduler* scheduler);
+
+void scheduler_submit(struct scheduler* scheduler, struct scheduler_task* task);
+
+/* Blocks until every task submitted so far is done */
+void scheduler_wait(struct scheduler* scheduler);
+
+#endif  /*__SCHEDULER_H*/
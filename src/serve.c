@@ -0,0 +1,448 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "serve.h"
+#include "compiler.h"
+#include "reader.h"
+#include "run.h"
+#include "source.h"
+#include "vm.h"
+
+/* How many connections wait for a free worker before clients get refused */
+#define SERVE_BACKLOG 64
+
+/* The state every request starts from, taken once the worker is forked */
+struct serve_worker {
+    struct vm* vm;
+    struct smap(expr) globals; /* a copy of the vm's as the prelude left them */
+    u32 heap_length;
+    struct arena_mark arena; /* where expr_arena was, so the text requests allocate goes too */
+    u32 sp;
+    FILE* capture; /* stdout and stderr point here while the worker lives */
+    u64 timeout_ms;
+};
+
+static volatile sig_atomic_t serve_stopping;
+
+static bool read_all(i32 fd, void* buffer, usize size) {
+    u8* at = buffer;
+    isize n;
+
+    while (size > 0) {
+        n = read(fd, at, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+
+        at += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+static bool write_all(i32 fd, const void* buffer, usize size) {
+    const u8* at = buffer;
+    isize n;
+
+    while (size > 0) {
+        n = write(fd, at, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+
+        at += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+static bool read_u32(i32 fd, u32* value) {
+    u8 bytes[4];
+
+    if (!read_all(fd, bytes, sizeof(bytes))) return false;
+
+    *value = ((u32)bytes[0] << 24) | ((u32)bytes[1] << 16) | ((u32)bytes[2] << 8) | bytes[3];
+    return true;
+}
+
+static bool write_u32(i32 fd, u32 value) {
+    u8 bytes[4] = {value >> 24, value >> 16, value >> 8, value};
+    return write_all(fd, bytes, sizeof(bytes));
+}
+
+/* Server */
+
+static void on_stop(i32 signal) {
+    UNUSED(signal);
+    serve_stopping = 1;
+}
+
+/* Runs the loaded module a slice at a time until it finishes or runs out of time */
+static enum serve_status run_module(struct serve_worker* worker, struct module* module) {
+    f64 deadline = monotonic_now() + worker->timeout_ms / 1e3;
+    enum serve_status status = SERVE_OK;
+
+    vm_load(worker->vm, module);
+
+    /* the last resort for a request stuck somewhere the clock never gets checked */
+    alarm(worker->timeout_ms / 1000 + 2);
+
+    while (vm_run_for(worker->vm, SERVE_SLICE) == VM_YIELDED) {
+        if (monotonic_now() >= deadline) {
+            status = SERVE_TIMEOUT;
+            break;
+        }
+    }
+
+    alarm(0);
+
+    return status;
+}
+
+/* Rolls the vm back to where the prelude left it */
+static void reset_worker(struct serve_worker* worker) {
+    struct vm* vm = worker->vm;
+
+    /* the request may have grown the map */
+    if (vm->global_map.size != worker->globals.size) {
+        SMAP_DESTROY(&vm->global_map);
+        smap__expr_init(&vm->global_map, worker->globals.size);
+    }
+
+    memcpy(vm->global_map.slots, worker->globals.slots, sizeof(struct smap_slot(expr)) * worker->globals.size);
+    vm->global_map.count = worker->globals.count;
+    exprs.length = worker->heap_length;
+    arena_rewind(&expr_arena, worker->arena);
+    vm->sp = worker->sp;
+    vm->running = true;
+}
+
+static bool serve_one(struct serve_worker* worker, i32 fd, struct slice(char) text) {
+    struct compiler compiler = {0};
+    struct module module = {0};
+    enum serve_status status = SERVE_ERROR;
+    i32 capture = fileno(worker->capture);
+    char* output = NULL;
+    char* result = NULL;
+    usize output_length = 0, result_length = 0;
+    FILE* stream;
+    off_t end;
+    bool sent;
+    u8 byte;
+
+    compiler_init(&compiler, reader_create_borrowed(text), &module);
+
+    if (compile(&compiler) == COMPILE_OK) {
+        status = run_module(worker, &module);
+    }
+
+    if (status == SERVE_OK && !nilp(worker->vm->result)) {
+        stream = open_memstream(&result, &result_length);
+        assert(stream);
+        expr_fprint(stream, worker->vm->result);
+        fclose(stream);
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+
+    end = lseek(capture, 0, SEEK_CUR);
+    if (end > 0) {
+        output = malloc(end);
+        assert(output);
+        output_length = pread(capture, output, end, 0) == end ? (usize)end : 0;
+    }
+
+    if (ftruncate(capture, 0) < 0 || lseek(capture, 0, SEEK_SET) < 0) _exit(1);
+
+    byte = status;
+    sent = write_all(fd, &byte, 1)
+        && write_u32(fd, output_length) && write_all(fd, output, output_length)
+        && write_u32(fd, result_length) && write_all(fd, result, result_length);
+
+    free(output);
+    free(result);
+    module_destroy(&module);
+    compiler_destroy(&compiler);
+
+    reset_worker(worker);
+
+    return sent;
+}
+
+static void serve_connection(struct serve_worker* worker, i32 fd) {
+    char* text;
+    u32 length;
+
+    while (read_u32(fd, &length) && length <= SERVE_REQUEST_MAX) {
+        text = malloc(length + 1);
+        assert(text);
+
+        /* symbols are borrowed from the text, so it outlives the rollback */
+        if (!read_all(fd, text, length) || !serve_one(worker, fd, (struct slice(char)){text, length})) {
+            free(text);
+            break;
+        }
+
+        free(text);
+    }
+
+    close(fd);
+}
+
+static void reset_signals(void) {
+    struct sigaction action = {0};
+
+    action.sa_handler = SIG_DFL;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    /* a client hanging up should only end its own connection */
+    action.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &action, NULL);
+}
+
+static void worker(struct vm* vm, i32 listener, u64 timeout_ms) {
+    struct serve_worker worker = {0};
+    usize size;
+    i32 fd;
+
+    worker.vm = vm;
+    worker.timeout_ms = timeout_ms;
+    worker.capture = tmpfile();
+    if (!worker.capture) _exit(1);
+
+    dup2(fileno(worker.capture), STDOUT_FILENO);
+    dup2(fileno(worker.capture), STDERR_FILENO);
+
+    /* make sure there is a table to snapshot even if nothing is defined yet */
+    if (vm->global_map.size == 0) smap__expr_init(&vm->global_map, SMAP_DEFAULT_SIZE);
+
+    size = sizeof(struct smap_slot(expr)) * vm->global_map.size;
+    worker.globals = vm->global_map;
+    worker.globals.slots = malloc(size);
+    assert(worker.globals.slots);
+    memcpy(worker.globals.slots, vm->global_map.slots, size);
+
+    worker.heap_length = exprs.length;
+    worker.arena = arena_get_mark(&expr_arena);
+    worker.sp = vm->sp;
+
+    for (;;) {
+        fd = accept(listener, NULL, NULL);
+
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            _exit(1);
+        }
+
+        serve_connection(&worker, fd);
+    }
+}
+
+static pid_t spawn_worker(struct vm* vm, i32 listener, u64 timeout_ms) {
+    sigset_t stop, saved;
+    pid_t pid;
+
+    /* held off until the worker has put the default handlers back */
+    sigemptyset(&stop);
+    sigaddset(&stop, SIGINT);
+    sigaddset(&stop, SIGTERM);
+    sigprocmask(SIG_BLOCK, &stop, &saved);
+
+    pid = fork();
+    if (pid == 0) {
+        reset_signals();
+        sigprocmask(SIG_SETMASK, &saved, NULL);
+        worker(vm, listener, timeout_ms);
+    }
+
+    sigprocmask(SIG_SETMASK, &saved, NULL);
+
+    return pid;
+}
+
+static i32 listen_on(const char* path) {
+    struct sockaddr_un address = {0};
+    i32 fd;
+
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "[serve] error: the socket path %s is too long\n", path);
+        return -1;
+    }
+
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        fprintf(stderr, "[serve] error: failed to create a socket\n");
+        return -1;
+    }
+
+    unlink(path);
+
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(fd, SERVE_BACKLOG) < 0) {
+        fprintf(stderr, "[serve] error: failed to listen on %s\n", path);
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+i32 serve_run(struct serve_options* options) {
+    struct source prelude = {0};
+    struct sigaction action = {0};
+    struct vm vm = {0};
+    pid_t* workers;
+    pid_t pid;
+    i32 listener, status;
+    usize started = 0;
+    usize i;
+
+    vm_init(&vm);
+    isolate_enter(&vm.isolate);
+
+    if (options->prelude) {
+        if (!source_open(&prelude, options->prelude)) return 1;
+
+        if (run_source(&vm, prelude.text, 0, RUN_WHOLE) != COMPILE_OK) {
+            fprintf(stderr, "[serve] error: the prelude %s failed to run\n", options->prelude);
+            return 1;
+        }
+    }
+
+    /* anything still buffered would be sent back by every worker */
+    fflush(stdout);
+
+    listener = listen_on(options->path);
+    if (listener < 0) return 1;
+
+    /* no SA_RESTART, so waiting on the workers gets interrupted */
+    action.sa_handler = on_stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    workers = malloc(sizeof(pid_t) * options->workers);
+    assert(workers);
+
+    for (i = 0; i < options->workers; ++i) {
+        workers[started] = spawn_worker(&vm, listener, options->timeout_ms);
+        if (workers[started] < 0) break;
+        started += 1;
+    }
+
+    if (started == 0) {
+        fprintf(stderr, "[serve] error: failed to start any workers\n");
+        serve_stopping = 1;
+    } else {
+        fprintf(stderr, "[serve] listening on %s with %lu workers\n", options->path, (unsigned long)started);
+    }
+
+    while (!serve_stopping) {
+        pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (i = 0; i < started && workers[i] != pid; ++i);
+        if (i == started) continue;
+
+        if (serve_stopping) {
+            workers[i] = -1;
+            break;
+        }
+
+        if (WIFSIGNALED(status)) {
+            fprintf(stderr, "[serve] error: worker %d died of signal %d, restarting it\n",
+                    (i32)pid, WTERMSIG(status));
+        } else {
+            fprintf(stderr, "[serve] error: worker %d exited with %d, restarting it\n",
+                    (i32)pid, WEXITSTATUS(status));
+        }
+
+        workers[i] = spawn_worker(&vm, listener, options->timeout_ms);
+    }
+
+    for (i = 0; i < started; ++i) {
+        if (workers[i] > 0) kill(workers[i], SIGTERM);
+    }
+
+    for (i = 0; i < started; ++i) {
+        if (workers[i] > 0) while (waitpid(workers[i], NULL, 0) < 0 && errno == EINTR);
+    }
+
+    close(listener);
+    unlink(options->path);
+    free(workers);
+
+    isolate_leave(&vm.isolate);
+    vm_destroy(&vm);
+    if (options->prelude) source_close(&prelude);
+
+    return started == 0;
+}
+
+/* Client */
+
+i32 serve_connect(const char* path) {
+    struct sockaddr_un address = {0};
+    i32 fd;
+
+    if (strlen(path) >= sizeof(address.sun_path)) return -1;
+
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static bool read_frame(i32 fd, struct slice(char)* frame) {
+    u32 length;
+
+    if (!read_u32(fd, &length)) return false;
+
+    frame->ptr = malloc(length + 1);
+    assert(frame->ptr);
+    frame->length = length;
+
+    return read_all(fd, frame->ptr, length);
+}
+
+bool serve_request(i32 fd, struct slice(char) text, struct serve_response* response) {
+    u8 status;
+
+    *response = (struct serve_response){0};
+
+    if (text.length > SERVE_REQUEST_MAX) return false;
+
+    if (!write_u32(fd, text.length) || !write_all(fd, text.ptr, text.length)) return false;
+    if (!read_all(fd, &status, 1)) return false;
+
+    response->status = status;
+
+    return read_frame(fd, &response->output) && read_frame(fd, &response->result);
+}
+
+void serve_response_free(struct serve_response* response) {
+    free(response->output.ptr);
+    free(response->result.ptr);
+    *response = (struct serve_response){0};
+}
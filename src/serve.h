@@ -0,0 +1,71 @@
+#ifndef __SERVE_H
+#define __SERVE_H
+
+#include "common.h"
+
+/* Requests bigger than this are refused without being read */
+#define SERVE_REQUEST_MAX (MEGABYTES(16))
+
+/* How long a request gets to run when the user did not pick a timeout */
+#define SERVE_TIMEOUT_DEFAULT_MS 5000
+
+/* How many instructions run between checks of the clock */
+#define SERVE_SLICE 65536
+
+enum serve_status {
+    SERVE_OK,      /* ran to the end, the result is in the response */
+    SERVE_ERROR,   /* did not read or compile, the error is in the output */
+    SERVE_TIMEOUT, /* was stopped after running out of time */
+};
+
+struct serve_options {
+    char* path;     /* where the socket is bound, anything already there is replaced */
+    char* prelude;  /* run once before forking, NULL for none */
+    usize workers;  /* how many warm processes serve connections at once */
+    u64 timeout_ms; /* how long a single request gets to run */
+};
+
+/*
+ * Serves evaluation requests over a Unix domain socket until SIGINT or SIGTERM.
+ *
+ * Like a batch, the prelude is run once and the workers are forked from the
+ * warm process afterwards. Each worker accepts connections off the shared
+ * socket and serves every request on a connection in turn, so as many clients
+ * as there are workers are served at once and the rest wait in the backlog.
+ *
+ * Every request runs from the state the prelude left behind: whatever it
+ * defined and allocated is rolled back once the response is sent. Its stdout
+ * and stderr are captured and sent back along with the printed result.
+ * Requests are run in slices of SERVE_SLICE instructions and stopped once they
+ * run past the timeout. Anything that blocks inside of a native is stopped by
+ * an alarm a second later, which takes its worker down with it. Workers that
+ * die for whatever reason are replaced.
+ *
+ * Both directions use length-prefixed frames with big endian lengths:
+ *
+ *   request:  u32 length, source text
+ *   response: u8 status, u32 length, output, u32 length, printed result
+ *
+ * The result is empty when it is nil or the request did not finish. Returns
+ * nonzero if the server could not be started.
+ * */
+i32 serve_run(struct serve_options* options);
+
+struct serve_response {
+    enum serve_status status;
+    struct slice(char) output;
+    struct slice(char) result;
+};
+
+/* Returns a connection to the server at path, -1 if nobody is listening there */
+i32 serve_connect(const char* path);
+
+/*
+ * Sends the text of one request and waits for its response, whose output and
+ * result are freshly allocated. Returns false if the connection broke first.
+ * */
+bool serve_request(i32 fd, struct slice(char) text, struct serve_response* response);
+
+void serve_response_free(struct serve_response* response);
+
+#endif  /*__SERVE_H*/
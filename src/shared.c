@@ -0,0 +1,477 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "shared.h"
+#include "epoch.h"
+#include "isolate.h"
+#include "pack.h"
+
+/* Text goes in chunks this big, unless it needs more on its own */
+#define SHARED_TEXT_CHUNK KILOBYTES(64)
+
+/* A chunk of the shared arena, freed once none of the text in it is live */
+struct shared_text {
+    struct shared_text* prev;
+    struct shared_text* next;
+    usize live;
+    usize used;
+    usize capacity;
+    char bytes[];
+};
+
+/* A value and where its cells and text sit in the shared heap and arena */
+struct shared_value {
+    struct expr expr;
+    u32 first;  /* the index of its first cell, without EXPR_SHARED_BIT */
+    u32 length; /* of cells, the value itself is in expr */
+    struct shared_text* text;
+    usize text_length;
+};
+
+/* Never changes once published, the name's text follows the struct */
+struct shared_entry {
+    u64 hash;
+    struct slice(char) name;
+    struct shared_value value;
+    usize size;
+};
+
+/* The cells of live values in each page, a page is freed when it gets to 0 */
+static u32 page_live[EXPR_SHARED_PAGES];
+
+/* Cells are handed out from the end of the current page, text from the end of the current chunk */
+static struct {
+    pthread_mutex_t lock;
+    struct dynarray(u32) unused; /* pages that were freed, to be reused */
+    u32 pages;                   /* pages ever used */
+    u32 page;                    /* the current one, EXPR_SHARED_PAGES for none */
+    u32 used;                    /* cells of it handed out */
+    struct shared_text* text;
+    struct shared_text* texts;   /* every chunk that isn't freed, for telling shared text apart */
+} heap = { .lock = PTHREAD_MUTEX_INITIALIZER, .page = EXPR_SHARED_PAGES };
+
+static void page_map(u32 page, u32 live) {
+    expr_shared_pages[page] = malloc(sizeof(struct expr) * EXPR_SHARED_PAGE_CELLS);
+    assert(expr_shared_pages[page]);
+
+    page_live[page] = live;
+}
+
+static void page_unmap(u32 page) {
+    free(expr_shared_pages[page]);
+    expr_shared_pages[page] = NULL;
+
+    dynarray__u32_push(&heap.unused, page);
+}
+
+/* Returns the index of the first of length cells in a row, the heap lock is held */
+static u32 cells_alloc(u32 length) {
+    u32 pages, page, first, i;
+
+    if (heap.page != EXPR_SHARED_PAGES && heap.used + length <= EXPR_SHARED_PAGE_CELLS) {
+        first = heap.page * EXPR_SHARED_PAGE_CELLS + heap.used;
+
+        heap.used += length;
+        page_live[heap.page] += length;
+
+        return first;
+    }
+
+    if (length <= EXPR_SHARED_PAGE_CELLS) {
+        /* the page being left behind might have nothing live left in it already */
+        if (heap.page != EXPR_SHARED_PAGES && page_live[heap.page] == 0) page_unmap(heap.page);
+
+        if (heap.unused.length > 0) {
+            page = heap.unused.at[--heap.unused.length];
+        } else {
+            assert(heap.pages < EXPR_SHARED_PAGES && "The shared heap is full");
+            page = heap.pages++;
+        }
+
+        page_map(page, length);
+
+        heap.page = page;
+        heap.used = length;
+
+        return page * EXPR_SHARED_PAGE_CELLS;
+    }
+
+    /* too big for a page, it gets fresh pages in a row to itself */
+    pages = (length + EXPR_SHARED_PAGE_CELLS - 1) / EXPR_SHARED_PAGE_CELLS;
+    assert(heap.pages + pages <= EXPR_SHARED_PAGES && "The shared heap is full");
+
+    first = heap.pages * EXPR_SHARED_PAGE_CELLS;
+
+    for (i = 0; i < pages; ++i) {
+        page_map(heap.pages + i, i + 1 < pages ? EXPR_SHARED_PAGE_CELLS : length - i * EXPR_SHARED_PAGE_CELLS);
+    }
+
+    heap.pages += pages;
+
+    return first;
+}
+
+static void cells_release(u32 first, u32 length) {
+    u32 end = first + length;
+    u32 index, next, page;
+
+    for (index = first; index < end; index = next) {
+        page = index >> EXPR_SHARED_PAGE_BITS;
+        next = (page + 1) * EXPR_SHARED_PAGE_CELLS < end ? (page + 1) * EXPR_SHARED_PAGE_CELLS : end;
+
+        page_live[page] -= next - index;
+        if (page_live[page] == 0 && page != heap.page) page_unmap(page);
+    }
+}
+
+static void text_free(struct shared_text* text) {
+    if (text->prev) text->prev->next = text->next;
+    else heap.texts = text->next;
+    if (text->next) text->next->prev = text->prev;
+
+    free(text);
+}
+
+/* length bytes of the arena, the heap lock is held */
+static char* text_alloc(usize length, struct shared_text** chunk) {
+    struct shared_text* text = heap.text;
+    usize capacity;
+
+    if (!text || text->used + length > text->capacity) {
+        if (text && text->live == 0) text_free(text);
+
+        capacity = length > SHARED_TEXT_CHUNK ? length : SHARED_TEXT_CHUNK;
+        text = malloc(sizeof(struct shared_text) + capacity);
+        assert(text);
+
+        *text = (struct shared_text){ .capacity = capacity, .next = heap.texts };
+        if (heap.texts) heap.texts->prev = text;
+        heap.texts = text;
+        heap.text = text;
+    }
+
+    text->used += length;
+    text->live += length;
+    *chunk = text;
+
+    return text->bytes + text->used - length;
+}
+
+static void text_release(struct shared_text* text, usize length) {
+    text->live -= length;
+    if (text->live == 0 && text != heap.text) text_free(text);
+}
+
+/* Whether ptr is in a chunk of the shared arena, the heap lock is held */
+static bool text_shared(const char* ptr) {
+    struct shared_text* text;
+
+    for (text = heap.texts; text; text = text->next) {
+        if (ptr >= text->bytes && ptr < text->bytes + text->used) return true;
+    }
+
+    return false;
+}
+
+/* Packed cells point further along and start at 2 once nil and the value are left out */
+static inline u32 relocate(u32 ptr, u32 first) {
+    return ptr ? EXPR_SHARED_BIT | (first + ptr - 2) : 0;
+}
+
+/* Copies expr into the shared heap and arena by way of expr_pack, which already lays it out */
+static struct shared_value value_create(struct expr expr) {
+    struct shared_value value = { .expr = expr };
+    struct packed_expr* packed;
+    struct expr cell;
+    char *from, *text = NULL;
+    u32 i;
+
+    if (!expr_needs_pack(expr)) return value;
+
+    packed = expr_pack(expr);
+    from = (char*)(packed->cells + packed->length);
+
+    value.length = packed->length - 2;
+    value.text_length = (char*)packed + packed->size - from;
+
+    pthread_mutex_lock(&heap.lock);
+    if (value.length > 0) value.first = cells_alloc(value.length);
+    if (value.text_length > 0) text = text_alloc(value.text_length, &value.text);
+    pthread_mutex_unlock(&heap.lock);
+
+    /* nobody else can see these cells or bytes until the entry is published */
+    if (value.text_length > 0) memcpy(text, from, value.text_length);
+
+    for (i = 1; i < packed->length; ++i) {
+        cell = packed->cells[i];
+
+        if (cell.type == EXPR_CONS) {
+            cell.car = relocate(cell.car, value.first);
+            cell.cdr = relocate(cell.cdr, value.first);
+        } else if (cell.type == EXPR_SYMBOL) {
+            cell.symbol = text + (cell.symbol - from);
+        } else if (cell.type == EXPR_STRING && cell.small_length == EXPR_STRING_SLICE) {
+            cell.string = text + (cell.string - from);
+        }
+
+        if (i == 1) value.expr = cell;
+        else EXPR(relocate(i, value.first)) = cell;
+    }
+
+    free(packed);
+
+    return value;
+}
+
+static void value_release(struct shared_value* value) {
+    if (!value->length && !value->text) return;
+
+    pthread_mutex_lock(&heap.lock);
+    if (value->length > 0) cells_release(value->first, value->length);
+    if (value->text) text_release(value->text, value->text_length);
+    pthread_mutex_unlock(&heap.lock);
+}
+
+static struct shared_table* table_create(u32 capacity) {
+    struct shared_table* table = calloc(1, sizeof(struct shared_table) + sizeof(struct shared_entry*) * capacity);
+    assert(table);
+
+    table->capacity = capacity;
+
+    return table;
+}
+
+static struct shared_entry* entry_create(struct slice(char) name, struct expr value) {
+    struct shared_entry* entry = malloc(sizeof(struct shared_entry) + name.length);
+    assert(entry);
+
+    entry->name = (struct slice(char)){(char*)(entry + 1), name.length};
+    memcpy(entry->name.ptr, name.ptr, name.length);
+    entry->hash = string_hash(entry->name);
+
+    entry->value = value_create(value);
+    entry->size = sizeof(struct shared_entry) + name.length
+                + sizeof(struct expr) * entry->value.length + entry->value.text_length;
+
+    return entry;
+}
+
+static void entry_free(void* entry) {
+    value_release(&((struct shared_entry*)entry)->value);
+    free(entry);
+}
+
+/* Set while a thread outside of any isolate holds values it read */
+static __thread bool thread_pinned;
+
+/* Whatever heap a value gets read into can point at it until shared_release */
+static void pin(void) {
+    struct isolate* isolate = current_isolate;
+
+    if (isolate) {
+        if (isolate->pinned) return;
+
+        /* the records stay with the isolate, so pinning again is just a store */
+        if (isolate->pin) epoch_repin(isolate->pin);
+        else isolate->pin = epoch_pin();
+
+        isolate->pinned = true;
+        return;
+    }
+
+    if (!thread_pinned) {
+        thread_pinned = true;
+        epoch_enter();
+    }
+}
+
+bool shared_pinned(void) {
+    return current_isolate ? current_isolate->pinned || current_isolate->holding : thread_pinned;
+}
+
+void shared_release(bool hold) {
+    struct isolate* isolate = current_isolate;
+    struct epoch_record* swap;
+
+    if (!isolate) {
+        /* a thread's epoch can't be handed on, so holding keeps all of it */
+        if (thread_pinned && !hold) {
+            thread_pinned = false;
+            epoch_leave();
+        }
+
+        return;
+    }
+
+    /* nothing new was read, so whatever is held is all there is to keep */
+    if (hold && !isolate->pinned) return;
+
+    if (hold) {
+        /* the pin of what was just read takes over from the one held */
+        swap = isolate->held;
+        isolate->held = isolate->pin;
+        isolate->pin = swap;
+
+        if (isolate->pin && isolate->holding) epoch_idle(isolate->pin);
+
+        isolate->holding = true;
+        isolate->pinned = false;
+        return;
+    }
+
+    if (isolate->pinned) epoch_idle(isolate->pin);
+    if (isolate->holding) epoch_idle(isolate->held);
+
+    isolate->pinned = false;
+    isolate->holding = false;
+}
+
+/* Whether expr reaches a cell of the shared heap or text in the shared arena */
+bool shared_refers(struct expr expr) {
+    struct dynarray(u32) pending = {0};
+    bool found = false;
+    u32 ptr;
+
+    if (!expr_needs_pack(expr)) return false;
+
+    pthread_mutex_lock(&heap.lock);
+
+    for (;;) {
+        if (expr.type == EXPR_CONS) {
+            if ((expr.car | expr.cdr) & EXPR_SHARED_BIT) {
+                found = true;
+                break;
+            }
+
+            if (expr.car) dynarray__u32_push(&pending, expr.car);
+            if (expr.cdr) dynarray__u32_push(&pending, expr.cdr);
+        } else if (expr.type == EXPR_SYMBOL || (expr.type == EXPR_STRING && expr.small_length == EXPR_STRING_SLICE)) {
+            if (text_shared(expr.type == EXPR_SYMBOL ? expr.symbol : expr.string)) {
+                found = true;
+                break;
+            }
+        }
+
+        if (pending.length == 0) break;
+
+        ptr = pending.at[--pending.length];
+        expr = EXPR(ptr);
+    }
+
+    pthread_mutex_unlock(&heap.lock);
+    DYNARRAY_FREE(&pending);
+
+    return found;
+}
+
+struct expr shared_detach(struct expr expr) {
+    struct packed_expr* packed;
+
+    if (!shared_refers(expr)) return expr;
+
+    packed = expr_pack(expr);
+    expr = expr_unpack(packed);
+    free(packed);
+
+    return expr;
+}
+
+void shared_env_init(struct shared_env* env) {
+    *env = (struct shared_env){0};
+
+    env->table = table_create(SHARED_ENV_SLOTS_MIN);
+    pthread_mutex_init(&env->lock, NULL);
+}
+
+void shared_env_destroy(struct shared_env* env) {
+    u32 i;
+
+    /* heaps that read from it can still be pointing at its values */
+    for (i = 0; i < env->table->capacity; ++i) {
+        if (env->table->slots[i]) epoch_retire(env->table->slots[i], entry_free);
+    }
+
+    free(env->table);
+    pthread_mutex_destroy(&env->lock);
+
+    /* anything retired by this environment that readers have since let go of */
+    epoch_reclaim();
+}
+
+struct option(expr) shared_env_get(struct shared_env* env, struct slice(char) name) {
+    struct option(expr) result = {0};
+    struct shared_table* table;
+    struct shared_entry* entry;
+    u64 hash = string_hash(name);
+    u32 mask, slot;
+
+    /* the pin keeps the table from going away too */
+    pin();
+
+    table = __atomic_load_n(&env->table, __ATOMIC_ACQUIRE);
+    mask = table->capacity - 1;
+
+    for (slot = hash & mask; (entry = __atomic_load_n(&table->slots[slot], __ATOMIC_ACQUIRE)); slot = (slot + 1) & mask) {
+        if (entry->hash == hash && string_equal(entry->name, name)) {
+            result.is_some = true;
+            result.item = entry->value.expr;
+            break;
+        }
+    }
+
+    return result;
+}
+
+static void table_insert(struct shared_table* table, struct shared_entry* entry) {
+    u32 mask = table->capacity - 1;
+    u32 slot = entry->hash & mask;
+
+    while (table->slots[slot]) slot = (slot + 1) & mask;
+
+    table->slots[slot] = entry;
+    table->count += 1;
+}
+
+/* Readers of the old table keep going with it until they leave */
+static void grow(struct shared_env* env) {
+    struct shared_table* old = env->table;
+    struct shared_table* table = table_create(old->capacity * 2);
+    u32 i;
+
+    for (i = 0; i < old->capacity; ++i) {
+        if (old->slots[i]) table_insert(table, old->slots[i]);
+    }
+
+    __atomic_store_n(&env->table, table, __ATOMIC_RELEASE);
+    epoch_retire(old, free);
+}
+
+void shared_env_set(struct shared_env* env, struct slice(char) name, struct expr value) {
+    struct shared_entry* entry = entry_create(name, value);
+    struct shared_entry* old;
+    struct shared_table* table;
+    u32 mask, slot;
+
+    pthread_mutex_lock(&env->lock);
+
+    if ((env->table->count + 1) * 2 > env->table->capacity) grow(env);
+
+    table = env->table;
+    mask = table->capacity - 1;
+
+    for (slot = entry->hash & mask; (old = table->slots[slot]); slot = (slot + 1) & mask) {
+        if (old->hash == entry->hash && string_equal(old->name, entry->name)) break;
+    }
+
+    env->bytes += entry->size;
+
+    if (!old) {
+        table->count += 1;
+        __atomic_store_n(&table->slots[slot], entry, __ATOMIC_RELEASE);
+    } else {
+        env->bytes -= old->size;
+        __atomic_store_n(&table->slots[slot], entry, __ATOMIC_RELEASE);
+        epoch_retire(old, entry_free);
+    }
+
+    pthread_mutex_unlock(&env->lock);
+}
@@ -0,0 +1,74 @@
+#ifndef __SHARED_H
+#define __SHARED_H
+
+#include <pthread.h>
+
+#include "common.h"
+#include "expr.h"
+
+/* How many slots a shared environment starts out with, a power of two */
+#define SHARED_ENV_SLOTS_MIN 64
+
+struct shared_entry;
+
+/* The slots of a shared environment, replaced as a whole when it grows */
+struct shared_table {
+    u32 capacity;
+    u32 count;
+    struct shared_entry* slots[];
+};
+
+/*
+ * Globals that any number of vms on any number of threads can read without
+ * locking, so a large configuration is only held in memory once per process.
+ *
+ * Every binding is an immutable entry that owns a copy of its name and value.
+ * Readers find entries with plain loads inside an epoch. Writers take the lock,
+ * swing a slot over to a fresh entry, and retire the old one so it's freed once
+ * no reader can still be looking at it.
+ *
+ * Values can't point into any one vm's heap, so setting one copies its cells
+ * into the process wide heap of expr.h and its text into the arena next to it.
+ * Reading hands back the value as it sits in there, so a read costs the same
+ * whatever the value holds, and EXPR() follows its conses like any others.
+ *
+ * The first read pins the epoch for the isolate the thread is in, or for the
+ * thread itself outside of one, and values read stay good until it's let go
+ * of with shared_release. A vm does that whenever its outermost vm_run
+ * returns, after copying whatever its stack keeps of them into its own heap
+ * with shared_detach, and globals copy them as they're set. The result of the
+ * run stays where it is, and good until the next run returns. So a vm that keeps running only holds back
+ * what was replaced during its last run. A value that was replaced is freed
+ * once nothing pinned before then is left.
+ * */
+struct shared_env {
+    struct shared_table* table;
+    pthread_mutex_t lock; /* only writers take it */
+    usize bytes;          /* held by the live entries, for the curious */
+};
+
+void shared_env_init(struct shared_env* env);
+void shared_env_destroy(struct shared_env* env);
+
+/* The value of name if it's bound, see above for how long it lasts */
+struct option(expr) shared_env_get(struct shared_env* env, struct slice(char) name);
+
+/* Binds name to a copy of value, readers see either the old value or the new one */
+void shared_env_set(struct shared_env* env, struct slice(char) name, struct expr value);
+
+/* Whether the isolate the thread is in, or the thread, holds values it read */
+bool shared_pinned(void);
+
+/*
+ * Lets go of every value read by the isolate the thread is in, or the thread.
+ * With hold, the ones read since the last release stay good until the next.
+ * */
+void shared_release(bool hold);
+
+/* Whether expr reaches a cell of the shared heap or text in the shared arena */
+bool shared_refers(struct expr expr);
+
+/* expr itself, or a copy in the thread's heap if any of it is in the shared one */
+struct expr shared_detach(struct expr expr);
+
+#endif  /*__SHARED_H*/
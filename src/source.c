@@ -0,0 +1,140 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "source.h"
+
+#define SOURCE_READ_CHUNK (KILOBYTES(64))
+
+static char source_empty[1] = {0};
+
+/* Reads everything left in fd into a heap buffer */
+static bool source_read(struct source* source, i32 fd) {
+    char* buffer = NULL;
+    usize capacity = 0;
+    usize length = 0;
+    isize n;
+
+    do {
+        if (length + SOURCE_READ_CHUNK > capacity) {
+            capacity = capacity ? capacity * 2 : SOURCE_READ_CHUNK;
+            buffer = realloc(buffer, capacity);
+            assert(buffer && "OOM or something");
+        }
+
+        n = read(fd, buffer + length, capacity - length);
+        if (n < 0) {
+            free(buffer);
+            return false;
+        }
+
+        length += n;
+    } while (n > 0);
+
+    source->text = (struct slice(char)){buffer, length};
+    source->mapped = false;
+
+    return true;
+}
+
+bool source_open(struct source* source, const char* path) {
+    struct stat st;
+    void* mem;
+    i32 fd;
+    bool ok;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "[source] error: failed to open file %s\n", path);
+        return false;
+    }
+
+    if (fstat(fd, &st) < 0) {
+        fprintf(stderr, "[source] error: failed to stat file %s\n", path);
+        close(fd);
+        return false;
+    }
+
+    /* mmap refuses zero length mappings, and there is nothing to read anyway */
+    if (S_ISREG(st.st_mode) && st.st_size == 0) {
+        close(fd);
+        source->text = (struct slice(char)){source_empty, 0};
+        source->mapped = false;
+        return true;
+    }
+
+    if (S_ISREG(st.st_mode)) {
+        mem = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (mem != MAP_FAILED) {
+            /* the reader only ever walks forward through the file */
+            madvise(mem, st.st_size, MADV_SEQUENTIAL);
+            close(fd);
+
+            source->text = (struct slice(char)){mem, st.st_size};
+            source->mapped = true;
+            return true;
+        }
+    }
+
+    ok = source_read(source, fd);
+    close(fd);
+
+    if (!ok) fprintf(stderr, "[source] error: failed to read file %s\n", path);
+
+    return ok;
+}
+
+void source_close(struct source* source) {
+    if (source->mapped) {
+        munmap(source->text.ptr, source->text.length);
+    } else if (source->text.ptr != source_empty) {
+        free(source->text.ptr);
+    }
+
+    source->text = (struct slice(char)){0};
+    source->mapped = false;
+}
+
+struct line_index line_index_create(struct slice(char) text) {
+    return (struct line_index){ text, {0} };
+}
+
+static void line_index_build(struct line_index* index) {
+    char* end = index->text.ptr + index->text.length;
+    char* newline = index->text.ptr;
+
+    dynarray__u32_push(&index->starts, 0);
+
+    while ((newline = memchr(newline, '\n', end - newline)) != NULL) {
+        newline += 1;
+        dynarray__u32_push(&index->starts, newline - index->text.ptr);
+    }
+}
+
+struct file_location line_index_lookup(struct line_index* index, u32 offset) {
+    u32 low, high, mid;
+
+    if (index->starts.length == 0) line_index_build(index);
+
+    /* find the last line starting at or before offset */
+    low = 0;
+    high = index->starts.length;
+    while (high - low > 1) {
+        mid = low + (high - low) / 2;
+        if (index->starts.at[mid] <= offset) low = mid;
+        else high = mid;
+    }
+
+    return (struct file_location){ low + 1, offset - index->starts.at[low] + 1 };
+}
+
+void line_index_destroy(struct line_index* index) {
+    DYNARRAY_FREE(&index->starts);
+    index->starts = (struct dynarray(u32)){0};
+}
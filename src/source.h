@@ -0,0 +1,41 @@
+#ifndef __SOURCE_H
+#define __SOURCE_H
+
+#include "common.h"
+#include "expr.h"
+
+/*
+ * The text of a source file loaded for the reader.
+ *
+ * Regular files are mapped read-only straight into memory so nothing gets
+ * copied; everything else (pipes, character devices, etc.) falls back to being
+ * read into a heap buffer. Either way the text stays valid until the source is
+ * closed, which lets a borrowing reader slice symbols out of it directly.
+ * */
+struct source {
+    struct slice(char) text;
+    bool mapped;
+};
+
+/* Returns false and prints an error if the file could not be loaded */
+bool source_open(struct source* source, const char* path);
+
+void source_close(struct source* source);
+
+/*
+ * The offset every line of some text starts at, so byte offsets can be turned
+ * into a line and column. Nothing is scanned until the first lookup, which is
+ * usually never since only error reporting needs it.
+ * */
+struct line_index {
+    struct slice(char) text;
+    struct dynarray(u32) starts;
+};
+
+struct line_index line_index_create(struct slice(char) text);
+
+struct file_location line_index_lookup(struct line_index* index, u32 offset);
+
+void line_index_destroy(struct line_index* index);
+
+#endif  /*__SOURCE_H*/
@@ -0,0 +1,61 @@
+#include <stdio.h>
+
+#include "stream.h"
+#include "compiler.h"
+#include "reader.h"
+
+u8 stream_run(struct vm* vm, struct slice(char) src) {
+    struct dynarray(expr) syntax = {0};
+    struct dynarray(expr) heap;
+    struct module module = {0};
+    struct compiler compiler = {0};
+    struct slice(char) window;
+    struct file_location loc;
+    u8 ret = COMPILE_OK;
+    u32 ptr, start;
+
+    window = (struct slice(char)){src.ptr, src.length < READER_SRC_MAX ? src.length : READER_SRC_MAX};
+    compiler_init(&compiler, reader_create_borrowed(window), &module);
+
+    while (vm->running) {
+        if (src.length > READER_SRC_MAX) reader_slide(&compiler.reader, src.ptr + src.length);
+
+        /* whatever the last form left behind in the syntax heap is dead now */
+        heap = exprs;
+        exprs = syntax;
+        DYNARRAY_CLEAR(&exprs);
+        expr_new_nil();
+
+        start = compiler.reader.cursor;
+        ptr = read_expr(&compiler.reader);
+
+        if (ptr == READER_ERROR) {
+            ret = COMPILE_READER_ERROR;
+        } else if (ptr != 0) {
+            module_clear(&module);
+
+            ret = compile_form(&compiler, EXPR(ptr));
+        }
+
+        syntax = exprs;
+        exprs = heap;
+
+        if (ptr == 0 && compiler.reader.src.ptr + compiler.reader.src.length < src.ptr + src.length) {
+            loc = reader_location(&compiler.reader, start);
+            fprintf(stderr, "(%u:%u): error: more than 4 GiB of comments, a stream can't read past them\n",
+                    loc.line, loc.column);
+            ret = COMPILE_READER_ERROR;
+            break;
+        }
+
+        if (ptr == 0 || ret != COMPILE_OK) break;
+
+        vm_run(vm, &module);
+    }
+
+    DYNARRAY_FREE(&syntax);
+    module_destroy(&module);
+    compiler_destroy(&compiler);
+
+    return ret;
+}
@@ -0,0 +1,27 @@
+#ifndef __STREAM_H
+#define __STREAM_H
+
+#include "common.h"
+#include "vm.h"
+
+/*
+ * Reads, compiles, and runs the top-level forms of src one at a time, so
+ * output starts with the first form and the compiler's memory doesn't grow
+ * with the size of the program.
+ *
+ * Each form is read into a syntax heap that is swapped in for the thread's heap
+ * while the form is read and compiled, then cleared once its bytecode exists.
+ * Compiled code only holds on to atoms by value, so nothing the vm sees points
+ * into it. The code and constant buffers of the module are reused for every
+ * form.
+ *
+ * Sources past 4 GiB are read through a window that slides up to every form
+ * before it's read, so offsets still fit in a u32. A form, with whatever
+ * comments come before it, can't be longer than the window.
+ *
+ * Every form before a reader or compile error has already run by the time the
+ * error is reported. Returns COMPILE_OK or the error that stopped it.
+ * */
+u8 stream_run(struct vm* vm, struct slice(char) src);
+
+#endif  /*__STREAM_H*/
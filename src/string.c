@@ -16,21 +16,15 @@ bool string_equal(struct slice(char) a, struct slice(char) b) {
     return true;
 }
 
+/* 64 bit FNV-1a */
 u64 string_hash(struct slice(char) key) {
-    u64 P = 1571;
-    u64 hash = 0; 
-    u64 p = P;
-
-    for (u64 i = 0; i < key.length; ++i) {
-        for (u64 j = 0; j < i; ++j) {
-            p *= P;
-        }
-
-        hash = (hash*(key.length-i)*i + ((u64)*key.ptr+i)*i) << (i);
-        hash += key.length * i * p * (key.ptr[i] * key.ptr[i]);
-        hash *= P*p;
+    u64 hash = 14695981039346656037ull;
+    usize i;
+
+    for (i = 0; i < key.length; ++i) {
+        hash ^= (u8)key.ptr[i];
+        hash *= 1099511628211ull;
     }
 
     return hash;
 }
-
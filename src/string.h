@@ -19,6 +19,7 @@ struct slice(char) string_from_parts(char* ptr, usize length);
 
 bool string_equal(struct slice(char) a, struct slice(char) b);
 
+/* The one hash of text everything uses, smaps, reload's form table, the shared env and tables */
 u64 string_hash(struct slice(char) key);
 
 #endif  /*__STRING_H*/
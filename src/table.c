@@ -0,0 +1,278 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+
+#include "table.h"
+
+#define TABLE_MIN_CAPACITY 8
+
+static void table_free(struct owned* owned) {
+    struct table* table = (struct table*)owned;
+
+    free(table->hashes);
+    free(table->entries);
+    free(table);
+}
+
+struct table* table_create(void) {
+    struct table* table = calloc(1, sizeof(struct table));
+
+    assert(table);
+
+    owned_register(&table->owned, table_free);
+
+    return table;
+}
+
+/* The finalizer of splitmix64, every bit of the input ends up in every bit of the output */
+static inline u64 mix(u64 x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+
+    return x;
+}
+
+/* What a key that isn't a cons hashes to, a cons only counts for its type */
+static u64 hash_atom(struct expr key) {
+    struct slice(char) string;
+    u64 bits = 0;
+    f64 real;
+
+    switch (key.type) {
+        case EXPR_BOOLEAN:
+            bits = key.boolean;
+            break;
+        case EXPR_INTEGER:
+            bits = (u64)key.integer;
+            break;
+        case EXPR_FLOAT:
+            /* -0.0 and 0.0 are equal so they have to hash the same */
+            real = key.real == 0.0 ? 0.0 : key.real;
+            memcpy(&bits, &real, sizeof(bits));
+            break;
+        case EXPR_SYMBOL:
+            bits = string_hash((struct slice(char)){key.symbol, key.length});
+            break;
+        case EXPR_STRING:
+            string = expr_string(&key);
+            bits = string_hash(string);
+            break;
+        case EXPR_NATIVE:
+            memcpy(&bits, &key.native, sizeof(key.native));
+            break;
+        case EXPR_CHANNEL:
+        case EXPR_EXTERN:
+        case EXPR_VECTOR:
+        case EXPR_TABLE:
+        case EXPR_BUILDER:
+            /* the pointers all share the union */
+            bits = (u64)(uintptr_t)key.table;
+            break;
+    }
+
+    return mix(bits ^ ((u64)key.type << 56));
+}
+
+/*
+ * Conses hash every cell under them in preorder, which tells apart the shapes
+ * with the same atoms in the same order. The walk keeps its own stack so deep
+ * lists can't overflow the C one.
+ * */
+u32 table_hash(struct expr key) {
+    struct dynarray(u32) pending = {0};
+    struct expr cell;
+    u64 hash;
+
+    hash = hash_atom(key);
+
+    if (consp(key)) {
+        dynarray__u32_push(&pending, key.cdr);
+        dynarray__u32_push(&pending, key.car);
+
+        while (pending.length) {
+            cell = EXPR(DYNARRAY_POP(&pending));
+            hash = mix(hash ^ hash_atom(cell));
+
+            if (consp(cell)) {
+                dynarray__u32_push(&pending, cell.cdr);
+                dynarray__u32_push(&pending, cell.car);
+            }
+        }
+
+        DYNARRAY_FREE(&pending);
+    }
+
+    /* 0 marks an empty slot */
+    return (u32)(hash ^ (hash >> 32)) | 1;
+}
+
+static bool strings_equal(struct expr a, struct expr b) {
+    struct slice(char) x = expr_string(&a);
+    struct slice(char) y = expr_string(&b);
+
+    return x.length == y.length && memcmp(x.ptr, y.ptr, x.length) == 0;
+}
+
+static bool atoms_equal(struct expr a, struct expr b) {
+    if (a.type != b.type) return false;
+
+    switch (a.type) {
+        case EXPR_NIL:     return true;
+        case EXPR_BOOLEAN: return a.boolean == b.boolean;
+        case EXPR_INTEGER: return a.integer == b.integer;
+        case EXPR_FLOAT:   return a.real == b.real;
+        case EXPR_SYMBOL:  return a.length == b.length && memcmp(a.symbol, b.symbol, a.length) == 0;
+        case EXPR_NATIVE:  return a.native == b.native;
+        case EXPR_CHANNEL: return a.channel == b.channel;
+        case EXPR_EXTERN:  return a.ext == b.ext;
+        case EXPR_VECTOR:  return a.vector == b.vector;
+        case EXPR_TABLE:   return a.table == b.table;
+        case EXPR_STRING:  return strings_equal(a, b);
+        case EXPR_BUILDER: return a.builder == b.builder;
+        case EXPR_CONS:    return true; /* the cells under it get compared separately */
+    }
+
+    return false;
+}
+
+bool table_keys_equal(struct expr a, struct expr b) {
+    struct dynarray(u32) pending = {0};
+    bool equal = true;
+
+    if (!consp(a) || !consp(b)) return atoms_equal(a, b);
+
+    /* pairs of cells that still have to match */
+    dynarray__u32_push(&pending, a.car);
+    dynarray__u32_push(&pending, b.car);
+    dynarray__u32_push(&pending, a.cdr);
+    dynarray__u32_push(&pending, b.cdr);
+
+    while (equal && pending.length) {
+        b = EXPR(DYNARRAY_POP(&pending));
+        a = EXPR(DYNARRAY_POP(&pending));
+
+        equal = atoms_equal(a, b);
+
+        if (equal && consp(a)) {
+            dynarray__u32_push(&pending, a.car);
+            dynarray__u32_push(&pending, b.car);
+            dynarray__u32_push(&pending, a.cdr);
+            dynarray__u32_push(&pending, b.cdr);
+        }
+    }
+
+    DYNARRAY_FREE(&pending);
+
+    return equal;
+}
+
+/* The slot holding key, or the empty slot it would go in */
+static usize probe(const struct table* table, struct expr key, u32 hash) {
+    usize mask = table->capacity - 1;
+    usize slot = hash & mask;
+
+    while (table->hashes[slot] != 0) {
+        if (table->hashes[slot] == hash && table_keys_equal(table->entries[slot].key, key)) return slot;
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+static void grow(struct table* table) {
+    u32* hashes = table->hashes;
+    struct table_entry* entries = table->entries;
+    usize capacity = table->capacity;
+    usize mask, slot, i;
+
+    table->capacity = capacity ? capacity * 2 : TABLE_MIN_CAPACITY;
+    table->hashes = calloc(table->capacity, sizeof(u32));
+    table->entries = malloc(table->capacity * sizeof(struct table_entry));
+    assert(table->hashes && table->entries);
+
+    mask = table->capacity - 1;
+
+    /* every key is already known to be different, so only the hashes get looked at */
+    for (i = 0; i < capacity; ++i) {
+        if (hashes[i] == 0) continue;
+
+        for (slot = hashes[i] & mask; table->hashes[slot] != 0; slot = (slot + 1) & mask);
+
+        table->hashes[slot] = hashes[i];
+        table->entries[slot] = entries[i];
+    }
+
+    free(hashes);
+    free(entries);
+}
+
+bool table_find(const struct table* table, struct expr key, struct expr* value) {
+    usize slot;
+
+    if (table->count == 0) return false;
+
+    slot = probe(table, key, table_hash(key));
+    if (table->hashes[slot] == 0) return false;
+
+    *value = table->entries[slot].value;
+
+    return true;
+}
+
+struct expr table_get(const struct table* table, struct expr key) {
+    struct expr value;
+
+    if (!table_find(table, key, &value)) return expr_create_nil();
+
+    return value;
+}
+
+void table_put(struct table* table, struct expr key, struct expr value) {
+    u32 hash = table_hash(key);
+    usize slot;
+
+    if ((table->count + 1) * 4 > table->capacity * 3) grow(table);
+
+    slot = probe(table, key, hash);
+
+    if (table->hashes[slot] == 0) {
+        table->hashes[slot] = hash;
+        table->entries[slot].key = key;
+        table->count += 1;
+    }
+
+    table->entries[slot].value = value;
+}
+
+bool table_del(struct table* table, struct expr key) {
+    usize mask, hole, slot, home;
+
+    if (table->count == 0) return false;
+
+    mask = table->capacity - 1;
+    hole = probe(table, key, table_hash(key));
+    if (table->hashes[hole] == 0) return false;
+
+    /*
+     * Pulls back every entry after the hole that would still be found from
+     * there, which is any entry whose home slot isn't cyclically between the
+     * hole and where it sits now.
+     * */
+    for (slot = (hole + 1) & mask; table->hashes[slot] != 0; slot = (slot + 1) & mask) {
+        home = table->hashes[slot] & mask;
+
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            table->hashes[hole] = table->hashes[slot];
+            table->entries[hole] = table->entries[slot];
+            hole = slot;
+        }
+    }
+
+    table->hashes[hole] = 0;
+    table->count -= 1;
+
+    return true;
+}
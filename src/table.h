@@ -0,0 +1,66 @@
+#ifndef __TABLE_H
+#define __TABLE_H
+
+#include "common.h"
+#include "expr.h"
+
+/*
+ * Hash tables from any value to any value, for the lookups that would
+ * otherwise walk an association list.
+ *
+ *     (defvar ages (make-table))
+ *     (table-put! ages (quote alice) 31)
+ *     (table-get ages (quote alice))
+ *
+ * Keys are compared by value: integers, floats and booleans by what they
+ * hold, symbols and strings by their text, conses by their structure, and
+ * everything that points somewhere else (natives, channels, vectors, tables,
+ * builders) by identity. 1 and 1.0 are different keys, and so are a symbol and
+ * a string with the same text.
+ *
+ * The table is open addressed with linear probing. The hashes live in an array
+ * of their own, so a probe walks 4 bytes a slot and only looks at a key when
+ * its hash matches, and the keys and values sit next to each other in a
+ * second one. Deleting shifts the slots after it back instead of leaving a
+ * tombstone, so lookups never get slower as entries come and go. The table
+ * doubles once it is three quarters full.
+ *
+ * Like vectors, a table is shared by reference between the heaps its expr
+ * gets copied into and is only freed when the process exits. The conses and
+ * symbols stored in it still belong to the heap of whoever put them there, so
+ * a table holding them is only safe to use on that thread.
+ * */
+
+struct table_entry {
+    struct expr key;
+    struct expr value;
+};
+
+struct table {
+    struct owned owned; /* tables live until exit */
+    u32* hashes; /* 0 for an empty slot */
+    struct table_entry* entries;
+    usize capacity; /* always a power of two, or 0 until the first put */
+    usize count;
+};
+
+struct table* table_create(void);
+
+/* Sets value and returns true if key is in the table */
+bool table_find(const struct table* table, struct expr key, struct expr* value);
+
+/* Nil for keys that aren't in the table */
+struct expr table_get(const struct table* table, struct expr key);
+
+void table_put(struct table* table, struct expr key, struct expr value);
+
+/* Returns whether key was in the table */
+bool table_del(struct table* table, struct expr key);
+
+/* The hash a key is stored under, never 0 */
+u32 table_hash(struct expr key);
+
+/* Whether two keys are the same key, see above */
+bool table_keys_equal(struct expr a, struct expr b);
+
+#endif  /*__TABLE_H*/
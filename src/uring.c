@@ -0,0 +1,128 @@
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "uring.h"
+
+static i32 uring_setup(u32 entries, struct io_uring_params* params) {
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static i32 uring_enter_raw(i32 fd, u32 to_submit, u32 min_complete, u32 flags) {
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+bool uring_init(struct uring* ring, u32 entries) {
+    struct io_uring_params params = {0};
+    u8* sq;
+    u8* cq;
+
+    *ring = (struct uring){0};
+
+    ring->fd = uring_setup(entries, &params);
+    if (ring->fd < 0) return false;
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    /* newer kernels map both rings in one go */
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) ring->sq_ring_size = ring->cq_ring_size;
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) goto fail;
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) goto fail;
+    }
+
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) goto fail;
+
+    sq = ring->sq_ring;
+    ring->sq_head = (u32*)(sq + params.sq_off.head);
+    ring->sq_tail = (u32*)(sq + params.sq_off.tail);
+    ring->sq_array = (u32*)(sq + params.sq_off.array);
+    ring->sq_mask = *(u32*)(sq + params.sq_off.ring_mask);
+    ring->sq_entries = params.sq_entries;
+
+    cq = ring->cq_ring;
+    ring->cq_head = (u32*)(cq + params.cq_off.head);
+    ring->cq_tail = (u32*)(cq + params.cq_off.tail);
+    ring->cq_mask = *(u32*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    return true;
+
+fail:
+    if (ring->sq_ring && ring->sq_ring != MAP_FAILED) munmap(ring->sq_ring, ring->sq_ring_size);
+    if (ring->cq_ring && ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring)
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    close(ring->fd);
+    *ring = (struct uring){0};
+
+    return false;
+}
+
+void uring_destroy(struct uring* ring) {
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_ring_size);
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+}
+
+struct io_uring_sqe* uring_get_sqe(struct uring* ring) {
+    u32 head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    u32 tail = *ring->sq_tail;
+    struct io_uring_sqe* sqe;
+
+    if (tail - head >= ring->sq_entries) return NULL;
+
+    sqe = &ring->sqes[tail & ring->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+
+    ring->sq_array[tail & ring->sq_mask] = tail & ring->sq_mask;
+    ring->queued += 1;
+
+    /* the kernel only reads past the tail once we enter, so publish it right away */
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    return sqe;
+}
+
+i32 uring_enter(struct uring* ring, u32 min_complete) {
+    u32 flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    i32 ret;
+
+    do {
+        ret = uring_enter_raw(ring->fd, ring->queued, min_complete, flags);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret >= 0) ring->queued -= (u32)ret < ring->queued ? (u32)ret : ring->queued;
+
+    return ret;
+}
+
+struct io_uring_cqe* uring_peek(struct uring* ring) {
+    u32 head = *ring->cq_head;
+
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) return NULL;
+
+    return &ring->cqes[head & ring->cq_mask];
+}
+
+void uring_advance(struct uring* ring) {
+    __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,55 @@
+#ifndef __URING_H
+#define __URING_H
+
+#include <linux/io_uring.h>
+
+#include "common.h"
+
+/*
+ * Just enough of io_uring to queue up operations and reap their completions,
+ * talking to the kernel through the raw system calls so there is nothing
+ * extra to link against.
+ *
+ * Queued entries are only seen by the kernel once uring_enter is called, so a
+ * whole batch of them costs a single system call.
+ * */
+struct uring {
+    i32 fd;
+
+    /* the submission ring */
+    u32* sq_head;
+    u32* sq_tail;
+    u32* sq_array;
+    u32 sq_mask;
+    u32 sq_entries;
+    struct io_uring_sqe* sqes;
+    u32 queued; /* entries not handed to the kernel yet */
+
+    /* the completion ring */
+    u32* cq_head;
+    u32* cq_tail;
+    u32 cq_mask;
+    struct io_uring_cqe* cqes;
+
+    void* sq_ring;
+    usize sq_ring_size;
+    void* cq_ring;
+    usize cq_ring_size;
+    usize sqes_size;
+};
+
+/* Returns false if the kernel does not have io_uring or won't let us use it */
+bool uring_init(struct uring* ring, u32 entries);
+void uring_destroy(struct uring* ring);
+
+/* A zeroed entry to fill in, NULL if the ring is full until the next enter */
+struct io_uring_sqe* uring_get_sqe(struct uring* ring);
+
+/* Hands every queued entry to the kernel and waits for min_complete completions */
+i32 uring_enter(struct uring* ring, u32 min_complete);
+
+/* The oldest completion nobody has looked at, NULL if there is none */
+struct io_uring_cqe* uring_peek(struct uring* ring);
+void uring_advance(struct uring* ring);
+
+#endif  /*__URING_H*/
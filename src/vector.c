@@ -0,0 +1,669 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "vector.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VECTOR_X86
+#endif
+
+struct vector_impl {
+    i64 (*sum_i64)(const i64*, usize);
+    f64 (*sum_f64)(const f64*, usize);
+    i64 (*dot_i64)(const i64*, const i64*, usize);
+    f64 (*dot_f64)(const f64*, const f64*, usize);
+    void (*scale_i64)(i64*, const i64*, i64, usize);
+    void (*scale_f64)(f64*, const f64*, f64, usize);
+    void (*add_i64)(i64*, const i64*, const i64*, usize);
+    void (*add_f64)(f64*, const f64*, const f64*, usize);
+    void (*mul_i64)(i64*, const i64*, const i64*, usize);
+    void (*mul_f64)(f64*, const f64*, const f64*, usize);
+    /* these only ever get called with at least one element */
+    i64 (*min_i64)(const i64*, usize);
+    i64 (*max_i64)(const i64*, usize);
+    f64 (*min_f64)(const f64*, usize);
+    f64 (*max_f64)(const f64*, usize);
+};
+
+static enum vector_level vector_level;
+static struct vector_impl vector_impl;
+static pthread_once_t level_once = PTHREAD_ONCE_INIT;
+
+static void vector_free(struct owned* owned) {
+    struct vector* vector = (struct vector*)owned;
+
+    free(vector->data);
+    free(vector);
+}
+
+struct vector* vector_create(u8 kind, usize length) {
+    struct vector* vector = calloc(1, sizeof(struct vector));
+    usize size = length * sizeof(i64);
+
+    assert(vector);
+    assert(length <= SIZE_MAX / sizeof(i64) && "The vector is too long");
+
+    /* a zero sized allocation is allowed to come back NULL */
+    if (posix_memalign(&vector->data, VECTOR_ALIGNMENT, size ? size : sizeof(i64)) != 0) {
+        assert(0 && "Out of memory for the vector");
+    }
+
+    memset(vector->data, 0, size);
+    vector->length = length;
+    vector->kind = kind;
+
+    owned_register(&vector->owned, vector_free);
+
+    return vector;
+}
+
+static f64 real_of(struct expr value) {
+    assert((integerp(value) || floatp(value)) && "Vectors only hold integers and floats");
+
+    return floatp(value) ? value.real : (f64)value.integer;
+}
+
+struct vector* vector_make(usize length, struct expr value) {
+    struct vector* vector;
+    usize i;
+
+    assert((integerp(value) || floatp(value)) && "Vectors only hold integers and floats");
+
+    vector = vector_create(floatp(value) ? VECTOR_F64 : VECTOR_I64, length);
+
+    /* zero is what vector_create leaves behind already */
+    if (integerp(value) && value.integer != 0) {
+        for (i = 0; i < length; ++i) vector->integers[i] = value.integer;
+    } else if (floatp(value) && value.real != 0.0) {
+        for (i = 0; i < length; ++i) vector->reals[i] = value.real;
+    }
+
+    return vector;
+}
+
+struct expr vector_ref(const struct vector* vector, usize index) {
+    assert(index < vector->length && "The index is out of the vector's bounds");
+
+    if (vector->kind == VECTOR_I64) return expr_create_integer(vector->integers[index]);
+
+    return expr_create_float(vector->reals[index]);
+}
+
+void vector_set(struct vector* vector, usize index, struct expr value) {
+    assert(index < vector->length && "The index is out of the vector's bounds");
+
+    if (vector->kind == VECTOR_I64) {
+        assert(integerp(value) && "Vectors of integers only hold integers");
+        vector->integers[index] = value.integer;
+    } else {
+        vector->reals[index] = real_of(value);
+    }
+}
+
+/* Scalar, integers go through u64 so overflow wraps instead of being undefined */
+
+static i64 sum_i64_scalar(const i64* xs, usize n) {
+    u64 sum = 0;
+    usize i;
+
+    for (i = 0; i < n; ++i) sum += (u64)xs[i];
+
+    return (i64)sum;
+}
+
+static f64 sum_f64_scalar(const f64* xs, usize n) {
+    f64 sum = 0.0;
+    usize i;
+
+    for (i = 0; i < n; ++i) sum += xs[i];
+
+    return sum;
+}
+
+static i64 dot_i64_scalar(const i64* a, const i64* b, usize n) {
+    u64 sum = 0;
+    usize i;
+
+    for (i = 0; i < n; ++i) sum += (u64)a[i] * (u64)b[i];
+
+    return (i64)sum;
+}
+
+static f64 dot_f64_scalar(const f64* a, const f64* b, usize n) {
+    f64 sum = 0.0;
+    usize i;
+
+    for (i = 0; i < n; ++i) sum += a[i] * b[i];
+
+    return sum;
+}
+
+static void scale_i64_scalar(i64* out, const i64* xs, i64 k, usize n) {
+    usize i;
+
+    for (i = 0; i < n; ++i) out[i] = (i64)((u64)xs[i] * (u64)k);
+}
+
+static void scale_f64_scalar(f64* out, const f64* xs, f64 k, usize n) {
+    usize i;
+
+    for (i = 0; i < n; ++i) out[i] = xs[i] * k;
+}
+
+static void add_i64_scalar(i64* out, const i64* a, const i64* b, usize n) {
+    usize i;
+
+    for (i = 0; i < n; ++i) out[i] = (i64)((u64)a[i] + (u64)b[i]);
+}
+
+static void add_f64_scalar(f64* out, const f64* a, const f64* b, usize n) {
+    usize i;
+
+    for (i = 0; i < n; ++i) out[i] = a[i] + b[i];
+}
+
+static void mul_i64_scalar(i64* out, const i64* a, const i64* b, usize n) {
+    usize i;
+
+    for (i = 0; i < n; ++i) out[i] = (i64)((u64)a[i] * (u64)b[i]);
+}
+
+static void mul_f64_scalar(f64* out, const f64* a, const f64* b, usize n) {
+    usize i;
+
+    for (i = 0; i < n; ++i) out[i] = a[i] * b[i];
+}
+
+static i64 min_i64_scalar(const i64* xs, usize n) {
+    i64 min = xs[0];
+    usize i;
+
+    for (i = 1; i < n; ++i) min = xs[i] < min ? xs[i] : min;
+
+    return min;
+}
+
+static i64 max_i64_scalar(const i64* xs, usize n) {
+    i64 max = xs[0];
+    usize i;
+
+    for (i = 1; i < n; ++i) max = xs[i] > max ? xs[i] : max;
+
+    return max;
+}
+
+static f64 min_f64_scalar(const f64* xs, usize n) {
+    f64 min = xs[0];
+    usize i;
+
+    for (i = 1; i < n; ++i) min = xs[i] < min ? xs[i] : min;
+
+    return min;
+}
+
+static f64 max_f64_scalar(const f64* xs, usize n) {
+    f64 max = xs[0];
+    usize i;
+
+    for (i = 1; i < n; ++i) max = xs[i] > max ? xs[i] : max;
+
+    return max;
+}
+
+/*
+ * Vectorized. Every loop does whole registers and leaves the tail to the
+ * scalar kernel, reductions keep two accumulators going so an add doesn't
+ * wait on the one before it.
+ * */
+
+#ifdef VECTOR_X86
+
+#ifdef __SSE2__
+
+static i64 sum_i64_sse2(const i64* xs, usize n) {
+    __m128i sum0 = _mm_setzero_si128(), sum1 = _mm_setzero_si128();
+    i64 lanes[2];
+    usize i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        sum0 = _mm_add_epi64(sum0, _mm_loadu_si128((const __m128i*)(xs + i)));
+        sum1 = _mm_add_epi64(sum1, _mm_loadu_si128((const __m128i*)(xs + i + 2)));
+    }
+
+    _mm_storeu_si128((__m128i*)lanes, _mm_add_epi64(sum0, sum1));
+
+    return (i64)((u64)lanes[0] + (u64)lanes[1] + (u64)sum_i64_scalar(xs + i, n - i));
+}
+
+static f64 sum_f64_sse2(const f64* xs, usize n) {
+    __m128d sum0 = _mm_setzero_pd(), sum1 = _mm_setzero_pd();
+    f64 lanes[2];
+    usize i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        sum0 = _mm_add_pd(sum0, _mm_loadu_pd(xs + i));
+        sum1 = _mm_add_pd(sum1, _mm_loadu_pd(xs + i + 2));
+    }
+
+    _mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+
+    return lanes[0] + lanes[1] + sum_f64_scalar(xs + i, n - i);
+}
+
+static f64 dot_f64_sse2(const f64* a, const f64* b, usize n) {
+    __m128d sum0 = _mm_setzero_pd(), sum1 = _mm_setzero_pd();
+    f64 lanes[2];
+    usize i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        sum0 = _mm_add_pd(sum0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        sum1 = _mm_add_pd(sum1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+
+    _mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+
+    return lanes[0] + lanes[1] + dot_f64_scalar(a + i, b + i, n - i);
+}
+
+static void scale_f64_sse2(f64* out, const f64* xs, f64 k, usize n) {
+    const __m128d factor = _mm_set1_pd(k);
+    usize i;
+
+    for (i = 0; i + 2 <= n; i += 2) _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(xs + i), factor));
+
+    scale_f64_scalar(out + i, xs + i, k, n - i);
+}
+
+static void add_i64_sse2(i64* out, const i64* a, const i64* b, usize n) {
+    usize i;
+
+    for (i = 0; i + 2 <= n; i += 2) {
+        _mm_storeu_si128((__m128i*)(out + i), _mm_add_epi64(_mm_loadu_si128((const __m128i*)(a + i)),
+                                                            _mm_loadu_si128((const __m128i*)(b + i))));
+    }
+
+    add_i64_scalar(out + i, a + i, b + i, n - i);
+}
+
+static void add_f64_sse2(f64* out, const f64* a, const f64* b, usize n) {
+    usize i;
+
+    for (i = 0; i + 2 <= n; i += 2) _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+
+    add_f64_scalar(out + i, a + i, b + i, n - i);
+}
+
+static void mul_f64_sse2(f64* out, const f64* a, const f64* b, usize n) {
+    usize i;
+
+    for (i = 0; i + 2 <= n; i += 2) _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+
+    mul_f64_scalar(out + i, a + i, b + i, n - i);
+}
+
+static f64 min_f64_sse2(const f64* xs, usize n) {
+    __m128d min;
+    f64 lanes[2], tail;
+    usize i;
+
+    if (n < 2) return min_f64_scalar(xs, n);
+
+    min = _mm_loadu_pd(xs);
+    for (i = 2; i + 2 <= n; i += 2) min = _mm_min_pd(min, _mm_loadu_pd(xs + i));
+
+    _mm_storeu_pd(lanes, min);
+    lanes[0] = lanes[1] < lanes[0] ? lanes[1] : lanes[0];
+    if (i == n) return lanes[0];
+
+    tail = min_f64_scalar(xs + i, n - i);
+    return tail < lanes[0] ? tail : lanes[0];
+}
+
+static f64 max_f64_sse2(const f64* xs, usize n) {
+    __m128d max;
+    f64 lanes[2], tail;
+    usize i;
+
+    if (n < 2) return max_f64_scalar(xs, n);
+
+    max = _mm_loadu_pd(xs);
+    for (i = 2; i + 2 <= n; i += 2) max = _mm_max_pd(max, _mm_loadu_pd(xs + i));
+
+    _mm_storeu_pd(lanes, max);
+    lanes[0] = lanes[1] > lanes[0] ? lanes[1] : lanes[0];
+    if (i == n) return lanes[0];
+
+    tail = max_f64_scalar(xs + i, n - i);
+    return tail > lanes[0] ? tail : lanes[0];
+}
+
+#endif  /* __SSE2__ */
+
+__attribute__((target("avx2")))
+static i64 sum_i64_avx2(const i64* xs, usize n) {
+    __m256i sum0 = _mm256_setzero_si256(), sum1 = _mm256_setzero_si256();
+    i64 lanes[4];
+    usize i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        sum0 = _mm256_add_epi64(sum0, _mm256_loadu_si256((const __m256i*)(xs + i)));
+        sum1 = _mm256_add_epi64(sum1, _mm256_loadu_si256((const __m256i*)(xs + i + 4)));
+    }
+
+    _mm256_storeu_si256((__m256i*)lanes, _mm256_add_epi64(sum0, sum1));
+
+    return (i64)((u64)lanes[0] + (u64)lanes[1] + (u64)lanes[2] + (u64)lanes[3]
+                 + (u64)sum_i64_scalar(xs + i, n - i));
+}
+
+__attribute__((target("avx2")))
+static f64 sum_f64_avx2(const f64* xs, usize n) {
+    __m256d sum0 = _mm256_setzero_pd(), sum1 = _mm256_setzero_pd();
+    f64 lanes[4];
+    usize i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        sum0 = _mm256_add_pd(sum0, _mm256_loadu_pd(xs + i));
+        sum1 = _mm256_add_pd(sum1, _mm256_loadu_pd(xs + i + 4));
+    }
+
+    _mm256_storeu_pd(lanes, _mm256_add_pd(sum0, sum1));
+
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum_f64_scalar(xs + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static f64 dot_f64_avx2(const f64* a, const f64* b, usize n) {
+    __m256d sum0 = _mm256_setzero_pd(), sum1 = _mm256_setzero_pd();
+    f64 lanes[4];
+    usize i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        sum0 = _mm256_add_pd(sum0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        sum1 = _mm256_add_pd(sum1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+
+    _mm256_storeu_pd(lanes, _mm256_add_pd(sum0, sum1));
+
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + dot_f64_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void scale_f64_avx2(f64* out, const f64* xs, f64 k, usize n) {
+    const __m256d factor = _mm256_set1_pd(k);
+    usize i;
+
+    for (i = 0; i + 4 <= n; i += 4) _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(xs + i), factor));
+
+    scale_f64_scalar(out + i, xs + i, k, n - i);
+}
+
+__attribute__((target("avx2")))
+static void add_i64_avx2(i64* out, const i64* a, const i64* b, usize n) {
+    usize i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_add_epi64(_mm256_loadu_si256((const __m256i*)(a + i)),
+                                                                  _mm256_loadu_si256((const __m256i*)(b + i))));
+    }
+
+    add_i64_scalar(out + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void add_f64_avx2(f64* out, const f64* a, const f64* b, usize n) {
+    usize i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+
+    add_f64_scalar(out + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void mul_f64_avx2(f64* out, const f64* a, const f64* b, usize n) {
+    usize i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+
+    mul_f64_scalar(out + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static i64 min_i64_avx2(const i64* xs, usize n) {
+    __m256i min, block;
+    i64 lanes[4];
+    usize i;
+
+    if (n < 4) return min_i64_scalar(xs, n);
+
+    min = _mm256_loadu_si256((const __m256i*)xs);
+    for (i = 4; i + 4 <= n; i += 4) {
+        block = _mm256_loadu_si256((const __m256i*)(xs + i));
+        min = _mm256_blendv_epi8(min, block, _mm256_cmpgt_epi64(min, block));
+    }
+
+    /* the last four elements overlap what was already seen, which a min doesn't mind */
+    if (i < n) {
+        block = _mm256_loadu_si256((const __m256i*)(xs + n - 4));
+        min = _mm256_blendv_epi8(min, block, _mm256_cmpgt_epi64(min, block));
+    }
+
+    _mm256_storeu_si256((__m256i*)lanes, min);
+
+    return min_i64_scalar(lanes, 4);
+}
+
+__attribute__((target("avx2")))
+static i64 max_i64_avx2(const i64* xs, usize n) {
+    __m256i max, block;
+    i64 lanes[4];
+    usize i;
+
+    if (n < 4) return max_i64_scalar(xs, n);
+
+    max = _mm256_loadu_si256((const __m256i*)xs);
+    for (i = 4; i + 4 <= n; i += 4) {
+        block = _mm256_loadu_si256((const __m256i*)(xs + i));
+        max = _mm256_blendv_epi8(max, block, _mm256_cmpgt_epi64(block, max));
+    }
+
+    if (i < n) {
+        block = _mm256_loadu_si256((const __m256i*)(xs + n - 4));
+        max = _mm256_blendv_epi8(max, block, _mm256_cmpgt_epi64(block, max));
+    }
+
+    _mm256_storeu_si256((__m256i*)lanes, max);
+
+    return max_i64_scalar(lanes, 4);
+}
+
+__attribute__((target("avx2")))
+static f64 min_f64_avx2(const f64* xs, usize n) {
+    __m256d min;
+    f64 lanes[4];
+    usize i;
+
+    if (n < 4) return min_f64_scalar(xs, n);
+
+    min = _mm256_loadu_pd(xs);
+    for (i = 4; i + 4 <= n; i += 4) min = _mm256_min_pd(min, _mm256_loadu_pd(xs + i));
+
+    if (i < n) min = _mm256_min_pd(min, _mm256_loadu_pd(xs + n - 4));
+
+    _mm256_storeu_pd(lanes, min);
+
+    return min_f64_scalar(lanes, 4);
+}
+
+__attribute__((target("avx2")))
+static f64 max_f64_avx2(const f64* xs, usize n) {
+    __m256d max;
+    f64 lanes[4];
+    usize i;
+
+    if (n < 4) return max_f64_scalar(xs, n);
+
+    max = _mm256_loadu_pd(xs);
+    for (i = 4; i + 4 <= n; i += 4) max = _mm256_max_pd(max, _mm256_loadu_pd(xs + i));
+
+    if (i < n) max = _mm256_max_pd(max, _mm256_loadu_pd(xs + n - 4));
+
+    _mm256_storeu_pd(lanes, max);
+
+    return max_f64_scalar(lanes, 4);
+}
+
+#endif  /* VECTOR_X86 */
+
+enum vector_level vector_best_level(void) {
+#ifdef VECTOR_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return VECTOR_LEVEL_AVX2;
+#ifdef __SSE2__
+    return VECTOR_LEVEL_SSE2;
+#endif
+#endif
+    return VECTOR_LEVEL_SCALAR;
+}
+
+/* Fills in the kernels of a level, only ever called once the level is settled */
+static void use_level(enum vector_level level) {
+    vector_level = VECTOR_LEVEL_SCALAR;
+    vector_impl = (struct vector_impl){
+        sum_i64_scalar, sum_f64_scalar, dot_i64_scalar, dot_f64_scalar,
+        scale_i64_scalar, scale_f64_scalar, add_i64_scalar, add_f64_scalar,
+        mul_i64_scalar, mul_f64_scalar,
+        min_i64_scalar, max_i64_scalar, min_f64_scalar, max_f64_scalar,
+    };
+
+#ifdef VECTOR_X86
+    if (level == VECTOR_LEVEL_AVX2 && __builtin_cpu_supports("avx2")) {
+        vector_level = VECTOR_LEVEL_AVX2;
+        vector_impl = (struct vector_impl){
+            sum_i64_avx2, sum_f64_avx2, dot_i64_scalar, dot_f64_avx2,
+            scale_i64_scalar, scale_f64_avx2, add_i64_avx2, add_f64_avx2,
+            mul_i64_scalar, mul_f64_avx2,
+            min_i64_avx2, max_i64_avx2, min_f64_avx2, max_f64_avx2,
+        };
+        return;
+    }
+#ifdef __SSE2__
+    if (level >= VECTOR_LEVEL_SSE2) {
+        vector_level = VECTOR_LEVEL_SSE2;
+        vector_impl = (struct vector_impl){
+            sum_i64_sse2, sum_f64_sse2, dot_i64_scalar, dot_f64_sse2,
+            scale_i64_scalar, scale_f64_sse2, add_i64_sse2, add_f64_sse2,
+            mul_i64_scalar, mul_f64_sse2,
+            min_i64_scalar, max_i64_scalar, min_f64_sse2, max_f64_sse2,
+        };
+    }
+#endif
+#endif
+}
+
+/* #pmap workers can run kernels at the same time, so whoever's first picks for everyone */
+static void use_best_level(void) {
+    use_level(vector_best_level());
+}
+
+void vector_set_level(enum vector_level level) {
+    pthread_once(&level_once, use_best_level);
+    use_level(level);
+}
+
+enum vector_level vector_get_level(void) {
+    pthread_once(&level_once, use_best_level);
+    return vector_level;
+}
+
+static const struct vector_impl* kernels(void) {
+    pthread_once(&level_once, use_best_level);
+    return &vector_impl;
+}
+
+static void assert_same_shape(const struct vector* a, const struct vector* b) {
+    assert(a->kind == b->kind && "Both vectors must hold the same kind of numbers");
+    assert(a->length == b->length && "Both vectors must be the same length");
+}
+
+struct expr vector_sum(const struct vector* vector) {
+    if (vector->kind == VECTOR_I64) {
+        return expr_create_integer(kernels()->sum_i64(vector->integers, vector->length));
+    }
+
+    return expr_create_float(kernels()->sum_f64(vector->reals, vector->length));
+}
+
+struct expr vector_dot(const struct vector* a, const struct vector* b) {
+    assert_same_shape(a, b);
+
+    if (a->kind == VECTOR_I64) {
+        return expr_create_integer(kernels()->dot_i64(a->integers, b->integers, a->length));
+    }
+
+    return expr_create_float(kernels()->dot_f64(a->reals, b->reals, a->length));
+}
+
+struct vector* vector_scale(const struct vector* vector, struct expr factor) {
+    struct vector* out = vector_create(vector->kind, vector->length);
+
+    if (vector->kind == VECTOR_I64) {
+        assert(integerp(factor) && "Vectors of integers can only be scaled by an integer");
+        kernels()->scale_i64(out->integers, vector->integers, factor.integer, vector->length);
+    } else {
+        kernels()->scale_f64(out->reals, vector->reals, real_of(factor), vector->length);
+    }
+
+    return out;
+}
+
+struct vector* vector_add(const struct vector* a, const struct vector* b) {
+    struct vector* out;
+
+    assert_same_shape(a, b);
+    out = vector_create(a->kind, a->length);
+
+    if (a->kind == VECTOR_I64) kernels()->add_i64(out->integers, a->integers, b->integers, a->length);
+    else kernels()->add_f64(out->reals, a->reals, b->reals, a->length);
+
+    return out;
+}
+
+struct vector* vector_mul(const struct vector* a, const struct vector* b) {
+    struct vector* out;
+
+    assert_same_shape(a, b);
+    out = vector_create(a->kind, a->length);
+
+    if (a->kind == VECTOR_I64) kernels()->mul_i64(out->integers, a->integers, b->integers, a->length);
+    else kernels()->mul_f64(out->reals, a->reals, b->reals, a->length);
+
+    return out;
+}
+
+struct expr vector_min(const struct vector* vector) {
+    if (vector->length == 0) return expr_create_nil();
+
+    if (vector->kind == VECTOR_I64) {
+        return expr_create_integer(kernels()->min_i64(vector->integers, vector->length));
+    }
+
+    return expr_create_float(kernels()->min_f64(vector->reals, vector->length));
+}
+
+struct expr vector_max(const struct vector* vector) {
+    if (vector->length == 0) return expr_create_nil();
+
+    if (vector->kind == VECTOR_I64) {
+        return expr_create_integer(kernels()->max_i64(vector->integers, vector->length));
+    }
+
+    return expr_create_float(kernels()->max_f64(vector->reals, vector->length));
+}
@@ -0,0 +1,95 @@
+#ifndef __VECTOR_H
+#define __VECTOR_H
+
+#include "common.h"
+#include "expr.h"
+
+/*
+ * Fixed length arrays of unboxed numbers, indexed in constant time.
+ *
+ *     (defvar xs (make-vector 1000 0.0))
+ *     (vector-set! xs 3 2.5)
+ *     (#vector-sum xs)
+ *
+ * The kind of a vector is that of the value make-vector fills it with: an
+ * integer makes a vector of i64, a float one of f64. Elements take 8 bytes
+ * each instead of a 16 byte expr, and the data is aligned for the widest
+ * vector instructions we use.
+ *
+ * The bulk natives (#vector-sum, #vector-dot, #vector-scale, #vector-add,
+ * #vector-mul, #vector-min, #vector-max) run as kernels written against SSE2
+ * and AVX2, picked at runtime depending on what the CPU supports, with a
+ * scalar fallback everywhere else. x86 has no packed 64 bit integer multiply
+ * short of AVX-512 and no packed 64 bit compare before SSE4.2, so those
+ * integer kernels stay scalar at the levels that lack them. Wider levels add
+ * floats up in a different order, so sums and dot products of f64 can differ
+ * between levels in the last bits.
+ *
+ * Like channels, a vector is shared by every heap the expr gets copied into,
+ * sending one to another thread sends a reference and not a copy, and nothing
+ * tracks who can still reach it, so vectors are only freed when the process
+ * exits.
+ * */
+
+/* What the data of a vector is aligned to, a 256 bit register */
+#define VECTOR_ALIGNMENT 32
+
+enum vector_kind {
+    VECTOR_I64,
+    VECTOR_F64,
+};
+
+enum vector_level {
+    VECTOR_LEVEL_SCALAR,
+    VECTOR_LEVEL_SSE2,
+    VECTOR_LEVEL_AVX2,
+};
+
+struct vector {
+    struct owned owned; /* vectors live until exit */
+    union {
+        i64* integers;
+        f64* reals;
+        void* data;
+    };
+    usize length;
+    u8 kind;
+};
+
+/* Every element starts out zeroed */
+struct vector* vector_create(u8 kind, usize length);
+
+/* A vector of length elements set to value, an integer or a float */
+struct vector* vector_make(usize length, struct expr value);
+
+struct expr vector_ref(const struct vector* vector, usize index);
+
+/* f64 vectors take integers too, converted */
+void vector_set(struct vector* vector, usize index, struct expr value);
+
+/* Picks the widest level the CPU supports, used unless vector_set_level is called */
+enum vector_level vector_best_level(void);
+
+/*
+ * Forces a level, mostly so benchmarks can compare the kernels. Only call it
+ * while nothing else is running a kernel, the level is picked once otherwise.
+ * */
+void vector_set_level(enum vector_level level);
+enum vector_level vector_get_level(void);
+
+/*
+ * The kernels of the bulk natives. The ones taking two vectors want them to
+ * be of the same kind and length, and the ones making a vector return a new
+ * one of the same kind. Sums wrap around on overflow like + does.
+ * */
+struct expr vector_sum(const struct vector* vector);
+struct expr vector_dot(const struct vector* a, const struct vector* b);
+struct vector* vector_scale(const struct vector* vector, struct expr factor);
+struct vector* vector_add(const struct vector* a, const struct vector* b);
+struct vector* vector_mul(const struct vector* a, const struct vector* b);
+
+/* Nil for empty vectors */
+struct expr vector_min(const struct vector* vector);
+struct expr vector_max(const struct vector* vector);
+
+#endif  /*__VECTOR_H*/
@@ -2,16 +2,29 @@
 
 #include "vm.h"
 #include "module.h"
+#include "builtin.h"
+#include "extension.h"
+#include "extern.h"
+#include "table.h"
+#include "vector.h"
+
 void vm_init(struct vm* vm) {
-    vm_set_global(vm, STRING("#display"), expr_create_native(native_display, 1));
-    vm_set_global(vm, STRING("#hello"), expr_create_native(native_hello, 0));
-    vm_set_global(vm, STRING("#+"), expr_create_native(native_add, 2));
+    usize i;
+
+    for (i = 0; i < builtins_length; ++i) {
+        if (builtins[i].kind != BUILTIN_KIND_NATIVE) continue;
+
+        vm_set_global(vm, builtins[i].name, builtin_create_native(i));
+    }
 
     vm->running = true;
 }
 
 void vm_destroy(struct vm* vm) {
     SMAP_DESTROY(&vm->global_map);
+    reload_registry_destroy(&vm->reloads);
+    constant_registry_destroy(&vm->constants);
+    isolate_destroy(&vm->isolate);
 }
 
 u8 vm_fetch_u8(struct vm* vm) {
@@ -45,8 +58,13 @@ void vm_dump_globals(struct vm* vm) {
 
 // struct option(expr) -> struct option__expr
 
+/* The vm's own globals shadow the shared ones, natives live in there too */
 struct option(expr) __vm_get_global(struct vm* vm, struct slice(char) name) {
-    return smap__expr_get(&vm->global_map, name) ;
+    struct option(expr) expr = smap__expr_get(&vm->global_map, name);
+
+    if (!expr.is_some && vm->shared) return shared_env_get(vm->shared, name);
+
+    return expr;
 }
 
 struct expr vm_get_global(struct vm* vm, struct slice(char) name) {
@@ -60,6 +78,12 @@ struct expr vm_get_global(struct vm* vm, struct slice(char) name) {
 
 struct expr vm_set_global(struct vm* vm, struct slice(char) name, struct expr expr) {
     struct option(expr) expr_opt;
+
+    /* globals outlive the shared values read, see shared.h */
+    if (shared_pinned()) expr = shared_detach(expr);
+
+    constant_assigned(&vm->constants, name, expr);
+
     if ((expr_opt = smap__expr_put(&vm->global_map, name, expr)).is_some) {
         return expr_opt.item;
     } else {
@@ -83,11 +107,31 @@ struct expr vm_load_var(struct vm* vm, struct slice(char) name) {
 struct expr vm_store_var(struct vm* vm, struct slice(char) name) {
     struct expr expr = vm_pop(vm);
 
-    vm_set_global(vm, name, expr);
+    if (vm->shared) shared_env_set(vm->shared, name, expr);
+    else vm_set_global(vm, name, expr);
 
     return expr;
 }
 
+/* Natives only get nil where their signature names it, like the lists of 'l', '*' doesn't count */
+static inline bool takes_nil(const struct builtin* builtin, u8 n) {
+    type_set type;
+
+    if (!builtin) return false;
+
+    type = builtin_param_type(builtin, n);
+
+    return type != TYPE_ANY && (type & TYPE_OF(EXPR_NIL)) != 0;
+}
+
+/* #reload and #load-native take their path as either, *path has to outlive the slice */
+static struct slice(char) path_of(struct expr* path) {
+    if (symbolp(*path)) return (struct slice(char)){.ptr = path->symbol, .length = path->length};
+
+    assert(stringp(*path) && "paths are strings or symbols");
+    return expr_string(path);
+}
+
 /* 
  * @TODO: Figure out if there is a better way of passing arguments on the stack.
  *
@@ -95,37 +139,54 @@ struct expr vm_store_var(struct vm* vm, struct slice(char) name) {
  * expects multiple arguments and more were provided than needed.  With the way
  * it works now, the last arguments are on the ones passed into the function.
  * */
-struct expr vm_function_call(struct vm* vm, struct slice(char) name) {
+static struct expr vm_call(struct vm* vm, struct expr func, bool checked) {
+    const struct builtin* builtin = NULL;
     u8 arity;
-    struct expr arg, func;
+    struct expr arg;
     u32 args;
 
-
-    func = vm_load_var(vm, name);
-
     /* the function was not found */
     if (nilp(func)) {
         return expr_create_nil();
     }
 
+    /* externs take their arguments straight off the stack, nothing gets consed */
+    if (externp(func)) {
+        return extern_call(vm, func.ext);
+    }
+
     assert(nativep(func));
 
+    /* the natives of builtin.def leave checking their arguments to the caller */
+    if (checked) builtin = builtin_find_native(func);
+
     arity = func.arity;
 
     args = 0;
 
+    /* the last argument is on top, so consing them on as they come off puts them in order */
     while (arity) {
         arg = vm_pop(vm);
-        assert(!nilp(arg));
-        args = expr_cons_append(args, arg);
+        assert(!checked || !nilp(arg) || takes_nil(builtin, arity - 1));
+        assert((!builtin || builtin_accepts(builtin, arity - 1, arg)) && "The argument doesn't fit the native's signature");
+        args = expr_new_cons(expr_box(arg), args);
         arity--;
     }
 
-    args = expr_cons_reverse(args);
-
     return expr_native_call(func, EXPR(args));
 }
 
+struct expr vm_function_call(struct vm* vm, struct slice(char) name) {
+    return vm_call(vm, vm_load_var(vm, name), true);
+}
+
+struct expr vm_function_call_unchecked(struct vm* vm, struct slice(char) name, u8 index) {
+    struct expr func = vm_load_var(vm, name);
+
+    /* the global could have been bound to something else since the call was compiled */
+    return vm_call(vm, func, !nativep(func) || func.native != builtins[index].native);
+}
+
 struct expr vm_push(struct vm* vm, struct expr expr) {
     return vm->stack[vm->sp++] = expr;
 }
@@ -140,22 +201,59 @@ struct expr vm_peek(struct vm* vm) {
     return vm->stack[vm->sp - 1];
 }
 
+/* Copies what the stack keeps of the shared values read into the heap, so they can go */
+static void vm_settle(struct vm* vm) {
+    u32 i;
+
+    if (!shared_pinned()) return;
+
+    for (i = 0; i < vm->sp; ++i) vm->stack[i] = shared_detach(vm->stack[i]);
+
+    /* copying every result would grow the heap with each run, so it's held instead */
+    shared_release(shared_refers(vm->result));
+}
+
 struct expr vm_run(struct vm* vm, struct module* module) {
-    struct expr expr, a, b;
-    u32 a_ptr, b_ptr;
-    u8 inst;
-    u16 jump_offset;
+    /* runs can nest, #reload runs other modules in the middle of one */
+    u32 base = vm->base;
+
+    vm->runs += 1;
+
+    vm_load(vm, module);
+    vm_run_for(vm, VM_BUDGET_UNLIMITED);
 
+    vm->base = base;
+
+    if (--vm->runs == 0) vm_settle(vm);
+
+    return vm->result;
+}
+
+void vm_load(struct vm* vm, struct module* module) {
     vm->module = module; 
     vm->ip = module->code.at;
+    vm->base = vm->sp;
+}
+
+enum vm_status vm_run_for(struct vm* vm, u64 budget) {
+    struct expr expr, a, b, c;
+    u32 a_ptr, b_ptr;
+    u8 inst;
+    u16 jump_offset;
 
-    inst = vm_fetch_u8(vm);
     while (vm->running) {
+        if (budget == 0) return VM_YIELDED;
+        budget -= 1;
+
+        inst = vm_fetch_u8(vm);
         switch ((enum op_code)inst) {
             case OP_CONSTANT:
                 expr = vm_get_const(vm, vm_fetch_u8(vm));
                 vm_push(vm, expr);
                 break;
+            case OP_QUOTE:
+                vm_push(vm, expr_unpack(vm->module->quotes.at[vm_fetch_u8(vm)].packed));
+                break;
             case OP_LOAD_VAR:
                 expr = vm_pop(vm);
                 assert(symbolp(expr));
@@ -190,6 +288,21 @@ struct expr vm_run(struct vm* vm, struct module* module) {
                 assert(integerp(a) && integerp(b) && "Both operands must be integers for OP_MUL");
                 vm_push(vm, expr_create_integer(a.integer * b.integer));
                 break;
+            case OP_ADD_UNCHECKED:
+                a = vm_pop(vm);
+                b = vm_pop(vm);
+                vm_push(vm, expr_create_integer(a.integer + b.integer));
+                break;
+            case OP_SUB_UNCHECKED:
+                a = vm_pop(vm);
+                b = vm_pop(vm);
+                vm_push(vm, expr_create_integer(b.integer - a.integer));
+                break;
+            case OP_MUL_UNCHECKED:
+                a = vm_pop(vm);
+                b = vm_pop(vm);
+                vm_push(vm, expr_create_integer(a.integer * b.integer));
+                break;
             case OP_DIV:
                 UNIMPLEMENTED();
             case OP_TRUE:
@@ -216,6 +329,25 @@ struct expr vm_run(struct vm* vm, struct module* module) {
                     vm,
                     (struct slice(char)){.ptr = expr.symbol, .length = expr.length}
                 ));
+                if (vm->suspended) return VM_SUSPENDED;
+                break;
+            case OP_CALL_NATIVE:
+                vm_push(vm, vm_call(vm, vm_get_const(vm, vm_fetch_u8(vm)), true));
+                if (vm->suspended) return VM_SUSPENDED;
+                break;
+            case OP_CALL_NATIVE_UNCHECKED:
+                vm_push(vm, vm_call(vm, vm_get_const(vm, vm_fetch_u8(vm)), false));
+                if (vm->suspended) return VM_SUSPENDED;
+                break;
+            case OP_CALL_UNCHECKED:
+                inst = vm_fetch_u8(vm);
+                expr = vm_pop(vm);
+                vm_push(vm, vm_function_call_unchecked(
+                    vm,
+                    (struct slice(char)){.ptr = expr.symbol, .length = expr.length},
+                    inst
+                ));
+                if (vm->suspended) return VM_SUSPENDED;
                 break;
             case OP_NIL:
                 vm_push(vm, expr_create_nil());
@@ -235,21 +367,93 @@ struct expr vm_run(struct vm* vm, struct module* module) {
                 assert(consp(expr));
                 vm_push(vm, CDR(vm_peek(vm)));
                 break;
+            case OP_CAR_UNCHECKED:
+                vm_push(vm, CAR(vm_peek(vm)));
+                break;
+            case OP_CDR_UNCHECKED:
+                vm_push(vm, CDR(vm_peek(vm)));
+                break;
+            case OP_MAKE_VECTOR:
+                a = vm_pop(vm);
+                b = vm_pop(vm);
+                assert(integerp(b) && b.integer >= 0 && "The length of a vector must be a positive integer");
+                vm_push(vm, expr_create_vector(vector_make(b.integer, a)));
+                break;
+            case OP_VECTOR_REF:
+                a = vm_pop(vm);
+                b = vm_pop(vm);
+                assert(vectorp(b) && integerp(a) && "OP_VECTOR_REF takes a vector and an integer index");
+                vm_push(vm, vector_ref(b.vector, (usize)a.integer));
+                break;
+            case OP_VECTOR_SET:
+                c = vm_pop(vm);
+                a = vm_pop(vm);
+                b = vm_pop(vm);
+                assert(vectorp(b) && integerp(a) && "OP_VECTOR_SET takes a vector and an integer index");
+                vector_set(b.vector, (usize)a.integer, c);
+                vm_push(vm, vector_ref(b.vector, (usize)a.integer));
+                break;
+            case OP_VECTOR_LENGTH:
+                expr = vm_pop(vm);
+                assert(vectorp(expr) && "OP_VECTOR_LENGTH takes a vector");
+                vm_push(vm, expr_create_integer((i64)expr.vector->length));
+                break;
+            case OP_MAKE_TABLE:
+                vm_push(vm, expr_create_table(table_create()));
+                break;
+            case OP_TABLE_GET:
+                a = vm_pop(vm);
+                b = vm_pop(vm);
+                assert(tablep(b) && "OP_TABLE_GET takes a table");
+                vm_push(vm, table_get(b.table, a));
+                break;
+            case OP_TABLE_PUT:
+                c = vm_pop(vm);
+                a = vm_pop(vm);
+                b = vm_pop(vm);
+                assert(tablep(b) && "OP_TABLE_PUT takes a table");
+                table_put(b.table, a, c);
+                vm_push(vm, c);
+                break;
+            case OP_TABLE_DEL:
+                a = vm_pop(vm);
+                b = vm_pop(vm);
+                assert(tablep(b) && "OP_TABLE_DEL takes a table");
+                vm_push(vm, expr_create_boolean(table_del(b.table, a)));
+                break;
+            case OP_TABLE_COUNT:
+                expr = vm_pop(vm);
+                assert(tablep(expr) && "OP_TABLE_COUNT takes a table");
+                vm_push(vm, expr_create_integer((i64)expr.table->count));
+                break;
             case OP_TOGGLE_DEBUG:
                 vm->debug = !vm->debug;
                 break;
+            case OP_RELOAD:
+                expr = vm_pop(vm);
+                vm_push(vm, reload_file(vm, path_of(&expr)));
+                break;
+            case OP_LOAD_NATIVE:
+                expr = vm_pop(vm);
+                vm_push(vm, extension_load(vm, path_of(&expr)));
+                break;
+            case OP_POP:
+                vm_pop(vm);
+                break;
             case OP_HALT:
                 vm->running = false;
-                expr = vm_pop(vm);
-                return expr;
+                vm->result = vm_pop(vm);
+                vm->sp = vm->base;
+                return VM_HALTED;
             case OP_RETURN:
-                expr = vm_pop(vm);
-                return expr;
+                /* drop whatever the module's other top-level forms left behind */
+                vm->result = vm_pop(vm);
+                vm->sp = vm->base;
+                return VM_OK;
         }
-
-        inst = vm_fetch_u8(vm);
     }
 
-    return expr_create_nil();
+    vm->result = expr_create_nil();
+    return VM_HALTED;
 }
 
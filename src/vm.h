@@ -3,17 +3,40 @@
 
 #define STACK_MAX 128
 
+/* A budget vm_run_for never runs out of */
+#define VM_BUDGET_UNLIMITED UINT64_MAX
+
 #include "common.h"
 #include "expr.h"
 #include "module.h"
 #include "string.h"
+#include "reload.h"
+#include "constant.h"
+#include "isolate.h"
+#include "shared.h"
+
+enum vm_status {
+    VM_OK,      /* reached the end of the module, the result is in vm->result */
+    VM_YIELDED, /* ran out of budget, calling vm_run_for again picks up from here */
+    VM_HALTED,  /* the vm was stopped and won't run anything else */
+    VM_SUSPENDED, /* an async native is waiting on something, see loop.h */
+};
 
 struct vm {
     struct expr stack[STACK_MAX];
     struct module* module;
     struct smap(expr) global_map;
+    struct shared_env* shared; /* globals shared with other vms, NULL for none */
+    struct reload_registry reloads;
+    struct constant_registry constants; /* the globals compilers may inline, see constant.h */
+    struct isolate isolate; /* the heap everything this vm runs allocates from */
     u8* ip;
     u32 sp;
+    u32 base;           /* where the stack was when the running module was loaded */
+    u32 runs;           /* vm_runs in progress, #reload nests them */
+    struct expr result; /* what the last module to finish returned */
+    bool suspended;     /* set by an async native to stop the vm right after it returns */
+    bool stats;         /* report how many type checks each module compiled got rid of */
     u8 running : 4;
     u8 debug : 4;
 };
@@ -33,9 +56,29 @@ struct expr vm_set_global(struct vm* vm, struct slice(char) name, struct expr ex
 
 struct expr vm_function_call(struct vm* vm, struct slice(char) name);
 
+/*
+ * For calls the compiler proved fit the signature of builtins[index]. Falls
+ * back to the checked call if the global isn't that native anymore.
+ * */
+struct expr vm_function_call_unchecked(struct vm* vm, struct slice(char) name, u8 index);
+
 struct expr vm_push(struct vm* vm, struct expr expr);
 struct expr vm_pop(struct vm* vm);
 
+/*
+ * Runs module to the end and returns its result. The outermost run lets go
+ * of the shared values read meanwhile, see shared.h.
+ * */
 struct expr vm_run(struct vm* vm, struct module* module);
 
+/* Points the vm at the start of module without running anything */
+void vm_load(struct vm* vm, struct module* module);
+
+/*
+ * Runs at most budget instructions of the loaded module. Everything needed to
+ * carry on lives in the vm, so a yielded run resumes exactly where it stopped,
+ * whichever thread makes the next call.
+ * */
+enum vm_status vm_run_for(struct vm* vm, u64 budget);
+
 #endif  /* __VM_H */
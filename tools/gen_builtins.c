@@ -0,0 +1,107 @@
+/*
+ * Build step which reads the names out of src/builtin.def and searches for a
+ * seed that makes builtin_hash collision free over them. The result is written
+ * to stdout as a C header holding the seed, the table mask, and a table which
+ * maps each hash slot to its entry in the declarative table. Signatures which
+ * don't parse or don't match their arity fail the build here.
+ *
+ * Usage: gen_builtins > builtin_table.h
+ * */
+
+#include <stdio.h>
+
+#include "common.h"
+#include "builtin.h"
+
+#define BUILTIN_LITERAL(name, op, sig)           {name, 0, sig},
+#define BUILTIN_FUNCTION(name, arity, op, sig)   {name, arity, sig},
+#define BUILTIN_SPECIAL_FORM(name, fn)           {name, 0, NULL},
+#define BUILTIN_NATIVE(name, arity, fn, sig, op) {name, arity, sig},
+
+static const struct {
+    const char* name;
+    u8 arity;
+    const char* signature;
+} entries[] = {
+#include "builtin.def"
+};
+
+static bool valid_signature(const char* signature, u8 arity) {
+    const char* c = signature;
+    u8 params = 0;
+
+    for (; *c != ':'; ++c, ++params) {
+        if (*c == '\0' || !builtin_type_code(*c)) return false;
+    }
+
+    if (params != arity || *++c == '\0') return false;
+
+    for (; *c != '\0'; ++c) {
+        if (!builtin_type_code(*c)) return false;
+    }
+
+    return true;
+}
+
+#define MAX_SEED (1u << 24)
+#define MAX_TABLE_SIZE 256
+
+i32 main(void) {
+    u8 slots[MAX_TABLE_SIZE];
+    usize length = ARRAY_LENGTH(entries);
+    usize size, i;
+    u32 seed, slot;
+    bool found = false;
+
+    /* slot entries are stored off by one, zero is reserved for empty */
+    assert(length < 255 && "too many builtins for a u8 slot table");
+
+    for (i = 0; i < length; ++i) {
+        if (entries[i].signature && !valid_signature(entries[i].signature, entries[i].arity)) {
+            fprintf(stderr, "[gen_builtins] error: bad signature \"%s\" for %s\n",
+                    entries[i].signature, entries[i].name);
+            return 1;
+        }
+    }
+
+    /* start at twice the number of names so a seed is quick to find */
+    for (size = 4; size < length * 2; size *= 2);
+
+    for (; size <= MAX_TABLE_SIZE && !found; size *= 2) {
+        for (seed = 0; seed < MAX_SEED; ++seed) {
+            memset(slots, 0, sizeof(slots));
+
+            for (i = 0; i < length; ++i) {
+                slot = builtin_hash(entries[i].name, strlen(entries[i].name), seed) & (size - 1);
+                if (slots[slot] != 0) break;
+                slots[slot] = (u8)(i + 1);
+            }
+
+            if (i == length) {
+                found = true;
+                break;
+            }
+        }
+
+        if (found) break;
+    }
+
+    if (!found) {
+        fprintf(stderr, "[gen_builtins] error: no perfect hash found for %zu names\n", length);
+        return 1;
+    }
+
+    printf("/* Generated by tools/gen_builtins.c from src/builtin.def, do not edit */\n\n");
+    printf("#define BUILTIN_TABLE_SEED %uu\n", seed);
+    printf("#define BUILTIN_TABLE_MASK %zuu\n\n", size - 1);
+    printf("static const u8 builtin_slots[%zu] = {", size);
+
+    for (i = 0; i < size; ++i) {
+        if (i % 16 == 0) printf("\n   ");
+        printf(" %3u,", slots[i]);
+    }
+
+    printf("\n};\n");
+
+    return 0;
+}
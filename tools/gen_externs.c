@@ -0,0 +1,93 @@
+/*
+ * Build step which writes out a call stub for every signature class a
+ * defextern can have, up to EXTERN_INTS_MAX integer and EXTERN_DOUBLES_MAX
+ * double arguments for each kind of return, followed by the table extern.c
+ * picks them out of.
+ *
+ * Usage: gen_externs > extern_stubs.h
+ * */
+
+#include <stdio.h>
+
+#include "common.h"
+#include "extern.h"
+
+static const char* return_names[EXTERN_RETURN_COUNT] = {"void", "int", "long", "double"};
+static const char* return_types[EXTERN_RETURN_COUNT] = {"void", "i32", "i64", "f64"};
+
+static void print_params(u32 ints, u32 doubles) {
+    u32 i;
+
+    if (ints + doubles == 0) {
+        printf("void");
+        return;
+    }
+
+    for (i = 0; i < ints; ++i) printf("%si64", i > 0 ? ", " : "");
+    for (i = 0; i < doubles; ++i) printf("%sf64", ints + i > 0 ? ", " : "");
+}
+
+static void print_args(u32 ints, u32 doubles) {
+    u32 i;
+
+    for (i = 0; i < ints; ++i) printf("%si[%u]", i > 0 ? ", " : "", i);
+    for (i = 0; i < doubles; ++i) printf("%sd[%u]", ints + i > 0 ? ", " : "", i);
+}
+
+static void print_stub(u32 ret, u32 ints, u32 doubles) {
+    printf("static union extern_value extern_stub_%s_%u_%u(void* fn, const i64* i, const f64* d) {\n",
+           return_names[ret], ints, doubles);
+    printf("    union extern_value value = {0};\n");
+    printf("    UNUSED(i);\n");
+    printf("    UNUSED(d);\n");
+
+    switch (ret) {
+        case EXTERN_RETURN_VOID:   printf("    "); break;
+        case EXTERN_RETURN_DOUBLE: printf("    value.real = "); break;
+        default:                   printf("    value.integer = "); break;
+    }
+
+    printf("((%s (*)(", return_types[ret]);
+    print_params(ints, doubles);
+    printf("))fn)(");
+    print_args(ints, doubles);
+    printf(");\n");
+
+    printf("    return value;\n");
+    printf("}\n\n");
+}
+
+i32 main(void) {
+    u32 ret, ints, doubles;
+
+    printf("/* Generated by tools/gen_externs.c, do not edit */\n\n");
+
+    for (ret = 0; ret < EXTERN_RETURN_COUNT; ++ret) {
+        for (ints = 0; ints <= EXTERN_INTS_MAX; ++ints) {
+            for (doubles = 0; doubles <= EXTERN_DOUBLES_MAX; ++doubles) {
+                print_stub(ret, ints, doubles);
+            }
+        }
+    }
+
+    printf("static const extern_stub extern_stubs[%u][%u][%u] = {\n",
+           EXTERN_RETURN_COUNT, EXTERN_INTS_MAX + 1, EXTERN_DOUBLES_MAX + 1);
+
+    for (ret = 0; ret < EXTERN_RETURN_COUNT; ++ret) {
+        printf("    {\n");
+
+        for (ints = 0; ints <= EXTERN_INTS_MAX; ++ints) {
+            printf("        {");
+            for (doubles = 0; doubles <= EXTERN_DOUBLES_MAX; ++doubles) {
+                printf("%sextern_stub_%s_%u_%u", doubles > 0 ? ", " : "", return_names[ret], ints, doubles);
+            }
+            printf("},\n");
+        }
+
+        printf("    },\n");
+    }
+
+    printf("};\n");
+
+    return 0;
+}